@@ -0,0 +1,120 @@
+#include "FramePacer.hpp"
+#include "debug/CpuProfiler.hpp"
+#include <algorithm>
+#include <imgui.h>
+#include <thread>
+
+namespace stock {
+
+// Weight of the newest sample in the smoothed frame times.
+static constexpr double SMOOTHING = 0.1;
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+static double smooth(double average, double sample) { return average + (sample - average) * SMOOTHING; }
+
+static FramePacer::Clock::duration toDuration(double milliseconds) {
+  return std::chrono::duration_cast<FramePacer::Clock::duration>(Milliseconds(milliseconds));
+}
+
+FramePacer::FramePacer(Options options) : m_options(options) {}
+
+void FramePacer::setOptions(const Options& options) {
+  if (options.targetFrameRate != m_options.targetFrameRate) {
+    m_hasDeadline = false;
+  }
+  m_options = options;
+}
+
+void FramePacer::waitForNextFrame() {
+
+  auto now = Clock::now();
+
+  if (m_options.targetFrameRate > 0.) {
+    STOCK_PROFILE_SCOPE("Frame Pacing");
+
+    auto interval = toDuration(1000. / m_options.targetFrameRate);
+
+    // Time from the start of a frame to its deadline.
+    auto lead = interval;
+    if (m_options.lowLatency) {
+      lead = std::min(lead, toDuration(m_predictedMilliseconds + m_options.marginMilliseconds));
+    }
+
+    // Schedule the frame one interval after the last one, unless the last one finished late enough to miss that; then
+    // start over with a frame that begins now.
+    if (m_hasDeadline) {
+      m_deadline += interval;
+    }
+    if (!m_hasDeadline || m_deadline < now) {
+      m_deadline = now + lead;
+      m_hasDeadline = true;
+    }
+
+    waitUntil(m_deadline - lead, m_options.spinMilliseconds);
+  } else {
+    m_hasDeadline = false;
+  }
+
+  startFrame(now, true);
+}
+
+void FramePacer::beginFrame() {
+  // Frames after an idle period aren't on the schedule, so don't count the idle time.
+  m_hasDeadline = false;
+  startFrame(Clock::now(), false);
+}
+
+void FramePacer::startFrame(Clock::time_point waitStart, bool isConsecutive) {
+  auto frameStart = Clock::now();
+  if (m_hasFrameStart && isConsecutive) {
+    m_frameMilliseconds = smooth(m_frameMilliseconds, Milliseconds(frameStart - m_frameStart).count());
+    m_waitMilliseconds = smooth(m_waitMilliseconds, Milliseconds(frameStart - waitStart).count());
+  }
+  m_frameStart = frameStart;
+  m_hasFrameStart = true;
+}
+
+void FramePacer::endFrame(double gpuMilliseconds) {
+  if (!m_hasFrameStart) {
+    return;
+  }
+  double cpuMilliseconds = Milliseconds(Clock::now() - m_frameStart).count();
+  m_cpuMilliseconds = smooth(m_cpuMilliseconds, cpuMilliseconds);
+  m_gpuMilliseconds = smooth(m_gpuMilliseconds, gpuMilliseconds);
+
+  // The prediction rises immediately with a slow frame and falls gradually, so a single spike doesn't make the
+  // following frames miss their deadlines.
+  double sample = std::max(cpuMilliseconds, gpuMilliseconds);
+  m_predictedMilliseconds = std::max(sample, smooth(m_predictedMilliseconds, sample));
+}
+
+void FramePacer::waitUntil(Clock::time_point time, double spinMilliseconds) {
+  auto sleepUntil = time - toDuration(spinMilliseconds);
+  if (Clock::now() < sleepUntil) {
+    std::this_thread::sleep_until(sleepUntil);
+  }
+  while (Clock::now() < time) {
+    std::this_thread::yield();
+  }
+}
+
+void FramePacer::drawPanel() {
+  if (!ImGui::TreeNode("Frame Pacing")) {
+    return;
+  }
+  ImGui::Text("CPU: %.2f ms, GPU: %.2f ms", m_cpuMilliseconds, m_gpuMilliseconds);
+  ImGui::Text("Frame: %.2f ms, Wait: %.2f ms", m_frameMilliseconds, m_waitMilliseconds);
+
+  auto options = m_options;
+  float targetFrameRate = static_cast<float>(options.targetFrameRate);
+  if (ImGui::SliderFloat("Target FPS", &targetFrameRate, 0.f, 240.f, targetFrameRate > 0.f ? "%.0f" : "Unlimited")) {
+    options.targetFrameRate = targetFrameRate;
+  }
+  ImGui::Checkbox("Low latency", &options.lowLatency);
+  setOptions(options);
+
+  ImGui::TreePop();
+}
+
+} // namespace stock
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+
+namespace stock {
+
+// FramePacer limits the frame rate and measures how long frames take on the CPU and the GPU.
+//
+// Call waitForNextFrame() before sampling input for a frame, and endFrame() after submitting its draw calls but before
+// swapping buffers. With a target frame rate, frames start on a fixed schedule. In low-latency mode the start of each
+// frame is delayed until just enough time is left to finish it before its deadline, so input is sampled as late as
+// possible. Waits sleep until shortly before the deadline and then spin, because sleeps can overshoot by a millisecond
+// or more.
+
+class FramePacer {
+
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    // Frames per second to pace to, or zero to start frames as soon as possible.
+    double targetFrameRate = 0.;
+    // Delay the start of each frame to shortly before its predicted finish time, instead of starting it immediately.
+    bool lowLatency = true;
+    // Time before a deadline at which waits stop sleeping and start spinning.
+    double spinMilliseconds = 2.;
+    // Extra time allowed for a frame in low-latency mode, to absorb variation in frame times.
+    double marginMilliseconds = 1.;
+  };
+
+  FramePacer() = default;
+
+  explicit FramePacer(Options options);
+
+  // Wait until the next frame should start, then begin timing it.
+  void waitForNextFrame();
+
+  // Begin timing a frame without waiting, e.g. when the frame was started by an event after the loop was idle.
+  void beginFrame();
+
+  // Finish timing the CPU work of the current frame. The GPU time of a recent frame, e.g. from
+  // GpuProfiler::frameMilliseconds(), is used with the CPU time to predict the duration of the next frame.
+  void endFrame(double gpuMilliseconds = 0.);
+
+  // Wait until a time point, sleeping for as much of the wait as possible and spinning for the rest.
+  static void waitUntil(Clock::time_point time, double spinMilliseconds);
+
+  void setOptions(const Options& options);
+  const Options& options() const { return m_options; }
+
+  // Get the smoothed CPU time of a frame, in milliseconds.
+  double cpuMilliseconds() const { return m_cpuMilliseconds; }
+
+  // Get the smoothed GPU time of a frame, in milliseconds.
+  double gpuMilliseconds() const { return m_gpuMilliseconds; }
+
+  // Get the smoothed time between the starts of consecutive frames, in milliseconds.
+  double frameMilliseconds() const { return m_frameMilliseconds; }
+
+  // Get the smoothed time spent waiting before each frame, in milliseconds.
+  double waitMilliseconds() const { return m_waitMilliseconds; }
+
+  // Get the predicted time to finish a frame, in milliseconds.
+  double predictedMilliseconds() const { return m_predictedMilliseconds; }
+
+  // Draw the frame times and pacing controls with ImGui.
+  void drawPanel();
+
+private:
+  void startFrame(Clock::time_point waitStart, bool isConsecutive);
+
+  Options m_options;
+
+  // Time by which the current frame should finish; frames are scheduled one interval apart.
+  Clock::time_point m_deadline;
+  Clock::time_point m_frameStart;
+  bool m_hasDeadline = false;
+  bool m_hasFrameStart = false;
+
+  double m_cpuMilliseconds = 0.;
+  double m_gpuMilliseconds = 0.;
+  double m_frameMilliseconds = 0.;
+  double m_waitMilliseconds = 0.;
+  double m_predictedMilliseconds = 0.;
+};
+
+} // namespace stock
@@ -38,11 +38,16 @@
 
 #include "ImGuiImpl.hpp"
 
+#include "gl/Error.hpp"
+#include "gl/Framebuffer.hpp"
+#include "gl/FullscreenTriangle.hpp"
 #include "gl/GL.hpp"
 #include "gl/Mesh.hpp"
 #include "gl/ShaderProgram.hpp"
 #include "gl/Texture.hpp"
 #include "gl/VertexLayout.hpp"
+#include <cstdint>
+#include <memory>
 
 // GLFW
 #define GLFW_INCLUDE_NONE
@@ -73,27 +78,46 @@ static VertexLayout     g_VertexLayout({
   VertexAttribute("UV", 2, GL_FLOAT, false),
   VertexAttribute("Color", 4, GL_UNSIGNED_BYTE, true),
 });
-static Mesh<ImDrawVert> g_Mesh;
+static MeshBase         g_Mesh;
+
+static_assert(sizeof(ImDrawIdx) == sizeof(GLushort), "Mesh indices are 16 bits");
+
+// Cached rendering data
+static bool                         g_CachedRendering = false;
+static bool                         g_CacheIsValid = false;
+static uint64_t                     g_CacheHash = 0;
+static std::unique_ptr<Framebuffer> g_CacheFramebuffer;
+static FullscreenTriangle           g_CompositeTriangle;
+static ShaderProgram                g_CompositeShaderProgram(R"SHADER_END(
+    #ifdef GL_ES
+    precision mediump float;
+    #endif
+    uniform sampler2D Texture;
+    varying vec2 v_uv;
+    void main()
+    {
+      gl_FragColor = texture2D(Texture, v_uv);
+    }
+    )SHADER_END", FullscreenTriangle::vertexShaderSource());
+static UniformLocation              g_CompositeTexUniformLocation("Texture");
 
-// OpenGL3 Render function.
-// (this used to be set in io.RenderDrawListsFn and called by ImGui::Render(), but you can now call this directly from your main loop)
-// Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly, in order to be able to run within any OpenGL engine that doesn't do so.
-void RenderDrawData(RenderState& rs, ImDrawData* draw_data)
+// Draw the command lists into the bound framebuffer. When 'premultiply' is set, the alpha channel accumulates coverage
+// so that the result can later be composited with premultiplied alpha.
+static void RenderCommandLists(RenderState& rs, ImDrawData* draw_data, int fb_width, int fb_height, bool premultiply)
 {
-  // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
   ImGuiIO& io = ImGui::GetIO();
-  int fb_width = (int)(io.DisplaySize.x * io.DisplayFramebufferScale.x);
-  int fb_height = (int)(io.DisplaySize.y * io.DisplayFramebufferScale.y);
-  if (fb_width == 0 || fb_height == 0)
-  {
-    return;
-  }
-  draw_data->ScaleClipRects(io.DisplayFramebufferScale);
 
   // Setup render state: alpha-blending enabled, no face culling, no depth testing, scissor enabled, polygon fill
   rs.blending(true);
   rs.blendEquation(GL_FUNC_ADD);
-  rs.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  if (premultiply)
+  {
+    rs.blendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  }
+  else
+  {
+    rs.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  }
   rs.culling(false);
   rs.depthTest(false);
   rs.scissorTest(true);
@@ -110,23 +134,27 @@ void RenderDrawData(RenderState& rs, ImDrawData* draw_data)
   g_ShaderProgram.setUniformMatrix4f(rs, g_ProjMtxUniformLocation, ortho_projection);
   g_ShaderProgram.setUniformi(rs, g_TexUniformLocation, 0);
 
-  // Draw
+  // Upload all command lists into one buffer: a single respecification for the frame, then a write per list straight
+  // from ImGui's own arrays.
+  g_Mesh.reserve(rs, draw_data->TotalVtxCount, draw_data->TotalIdxCount, GL_STREAM_DRAW);
+  int vtx_offset = 0;
+  int idx_offset = 0;
   for (int n = 0; n < draw_data->CmdListsCount; n++)
   {
     const ImDrawList* cmd_list = draw_data->CmdLists[n];
-    const ImDrawIdx* idx_buffer_offset = 0;
-
-    g_Mesh.reset();
-
-    auto* vertices_start = cmd_list->VtxBuffer.Data;
-    auto* vertices_end = vertices_start + cmd_list->VtxBuffer.Size;
-    g_Mesh.vertices.assign(vertices_start, vertices_end);
-
-    auto* indices_start = cmd_list->IdxBuffer.Data;
-    auto* indices_end = indices_start + cmd_list->IdxBuffer.Size;
-    g_Mesh.indices.assign(indices_start, indices_end);
+    g_Mesh.writeVertices(rs, vtx_offset, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size);
+    g_Mesh.writeIndices(rs, idx_offset, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size);
+    vtx_offset += cmd_list->VtxBuffer.Size;
+    idx_offset += cmd_list->IdxBuffer.Size;
+  }
 
-    g_Mesh.upload(rs, GL_STREAM_DRAW);
+  // Draw each list from its base vertex, since its indices start from zero.
+  vtx_offset = 0;
+  idx_offset = 0;
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    const ImDrawIdx* idx_buffer_offset = (const ImDrawIdx*)(intptr_t)(idx_offset * sizeof(ImDrawIdx));
 
     for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
     {
@@ -139,16 +167,131 @@ void RenderDrawData(RenderState& rs, ImDrawData* draw_data)
       {
         rs.texture(GL_TEXTURE_2D, 0, (GLuint)(intptr_t)pcmd->TextureId);
         rs.scissor((int)pcmd->ClipRect.x, (int)(fb_height - pcmd->ClipRect.w), (int)(pcmd->ClipRect.z - pcmd->ClipRect.x), (int)(pcmd->ClipRect.w - pcmd->ClipRect.y));
-        g_Mesh.draw(rs, g_ShaderProgram, pcmd->ElemCount, idx_buffer_offset);
+        g_Mesh.draw(rs, g_ShaderProgram, pcmd->ElemCount, idx_buffer_offset, vtx_offset);
       }
       idx_buffer_offset += pcmd->ElemCount;
     }
+    vtx_offset += cmd_list->VtxBuffer.Size;
+    idx_offset += cmd_list->IdxBuffer.Size;
   }
 
   // Restore modified GL state. Might need to restore viewport??
   // glViewport(last_viewport[0], last_viewport[1], (GLsizei)last_viewport[2], (GLsizei)last_viewport[3]);
 }
 
+// Hash everything that affects the rendered UI, using FNV-1a.
+static uint64_t HashDrawData(const ImDrawData* draw_data, int fb_width, int fb_height)
+{
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&hash](const void* data, size_t size)
+  {
+    auto bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+  };
+  add(&fb_width, sizeof(fb_width));
+  add(&fb_height, sizeof(fb_height));
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    add(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
+    add(cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
+    for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+    {
+      const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+      add(&pcmd->ElemCount, sizeof(pcmd->ElemCount));
+      add(&pcmd->ClipRect, sizeof(pcmd->ClipRect));
+      add(&pcmd->TextureId, sizeof(pcmd->TextureId));
+    }
+  }
+  return hash;
+}
+
+static bool HasUserCallbacks(const ImDrawData* draw_data)
+{
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+    {
+      if (cmd_list->CmdBuffer[cmd_i].UserCallback)
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// OpenGL3 Render function.
+// (this used to be set in io.RenderDrawListsFn and called by ImGui::Render(), but you can now call this directly from your main loop)
+// Note that this implementation is little overcomplicated because we are saving/setting up/restoring every OpenGL state explicitly, in order to be able to run within any OpenGL engine that doesn't do so.
+void RenderDrawData(RenderState& rs, ImDrawData* draw_data)
+{
+  // Avoid rendering when minimized, scale coordinates for retina displays (screen coordinates != framebuffer coordinates)
+  ImGuiIO& io = ImGui::GetIO();
+  int fb_width = (int)(io.DisplaySize.x * io.DisplayFramebufferScale.x);
+  int fb_height = (int)(io.DisplaySize.y * io.DisplayFramebufferScale.y);
+  if (fb_width == 0 || fb_height == 0)
+  {
+    return;
+  }
+  draw_data->ScaleClipRects(io.DisplayFramebufferScale);
+
+  // User callbacks may draw anything, so UI that uses them is never cached.
+  if (!g_CachedRendering || HasUserCallbacks(draw_data))
+  {
+    RenderCommandLists(rs, draw_data, fb_width, fb_height, false);
+    return;
+  }
+
+  if (!g_CacheFramebuffer || (int)g_CacheFramebuffer->width() != fb_width || (int)g_CacheFramebuffer->height() != fb_height)
+  {
+    if (g_CacheFramebuffer)
+    {
+      g_CacheFramebuffer->dispose(rs);
+    }
+    g_CacheFramebuffer.reset(new Framebuffer(fb_width, fb_height, Framebuffer::Options()));
+    g_CacheIsValid = false;
+  }
+
+  // Redraw the cached UI only if it changed, then restore the caller's framebuffer.
+  uint64_t hash = HashDrawData(draw_data, fb_width, fb_height);
+  if (!g_CacheIsValid || hash != g_CacheHash)
+  {
+    GLint last_framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &last_framebuffer);
+    g_CacheFramebuffer->bind(rs, 0);
+    rs.scissorTest(false);
+    rs.clearColor(0.f, 0.f, 0.f, 0.f);
+    CHECK_GL(glClear(GL_COLOR_BUFFER_BIT));
+    RenderCommandLists(rs, draw_data, fb_width, fb_height, true);
+    CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, last_framebuffer));
+    g_CacheHash = hash;
+    g_CacheIsValid = true;
+  }
+
+  // Composite the cached UI, whose colors are premultiplied by alpha.
+  glViewport(0, 0, (GLsizei)fb_width, (GLsizei)fb_height);
+  rs.blending(true);
+  rs.blendEquation(GL_FUNC_ADD);
+  rs.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  rs.culling(false);
+  rs.depthTest(false);
+  rs.scissorTest(false);
+  g_CacheFramebuffer->colorTexture().bind(rs, 0);
+  g_CompositeShaderProgram.setUniformi(rs, g_CompositeTexUniformLocation, 0);
+  g_CompositeTriangle.draw(rs, g_CompositeShaderProgram);
+}
+
+void SetCachedRendering(bool enabled)
+{
+  g_CachedRendering = enabled;
+  g_CacheIsValid = false;
+}
+
 static const char* GetClipboardText(void* user_data)
 {
   return glfwGetClipboardString((GLFWwindow*)user_data);
@@ -214,6 +357,7 @@ bool CreateFontsTexture(RenderState& rs)
   Texture::Options fontTexOptions;
   g_FontTexture.dispose(rs);
   g_FontTexture = Texture(Pixmap(width, height, pixels, Pixmap::PixelFormat::RGBA), fontTexOptions);
+  io.Fonts->TexPixelsRGBA32 = NULL; // The texture's Pixmap owns the pixels now and frees them on dispose.
   g_FontTexture.prepare(rs, 0);
 
   // Store our identifier
@@ -240,6 +384,9 @@ bool CreateDeviceObjects(RenderState& rs)
     )SHADER_END";
 
   const GLchar* fragment_shader = R"SHADER_END(
+    #ifdef GL_ES
+    precision mediump float;
+    #endif
     uniform sampler2D Texture;
     varying vec2 Frag_UV;
     varying vec4 Frag_Color;
@@ -264,6 +411,13 @@ void InvalidateDeviceObjects(RenderState& rs)
 {
   g_Mesh.dispose(rs);
   g_ShaderProgram.dispose(rs);
+  if (g_CacheFramebuffer)
+  {
+    g_CacheFramebuffer->dispose(rs);
+    g_CacheFramebuffer.reset();
+  }
+  g_CompositeTriangle.dispose(rs);
+  g_CompositeShaderProgram.dispose(rs);
   if (g_FontTexture.glHandle())
   {
     g_FontTexture.dispose(rs);
@@ -26,6 +26,10 @@ void Shutdown(RenderState& rs);
 void NewFrame(RenderState& rs);
 void RenderDrawData(RenderState& rs, ImDrawData* draw_data);
 
+// Render the UI into an offscreen texture that is redrawn only when the draw data changes, and otherwise composite the
+// texture from an earlier frame with a single triangle. Disabled by default.
+void SetCachedRendering(bool enabled);
+
 // Use if you want to reset your rendering device without losing ImGui state.
 void InvalidateDeviceObjects(RenderState& rs);
 bool CreateDeviceObjects(RenderState& rs);
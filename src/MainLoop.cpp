@@ -0,0 +1,175 @@
+#include "MainLoop.hpp"
+#include "FramePacer.hpp"
+#include "debug/CpuProfiler.hpp"
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <algorithm>
+
+namespace stock {
+
+constexpr int MainLoop::FRAMES_PER_REDRAW;
+
+MainLoop::MainLoop(GLFWwindow* window, Options options) : m_window(window), m_options(options) {
+  glfwSetWindowUserPointer(m_window, this);
+  m_previousCursorPos = glfwSetCursorPosCallback(m_window, cursorPosCallback);
+  m_previousMouseButton = glfwSetMouseButtonCallback(m_window, mouseButtonCallback);
+  m_previousScroll = glfwSetScrollCallback(m_window, scrollCallback);
+  m_previousKey = glfwSetKeyCallback(m_window, keyCallback);
+  m_previousChar = glfwSetCharCallback(m_window, charCallback);
+  m_previousFramebufferSize = glfwSetFramebufferSizeCallback(m_window, framebufferSizeCallback);
+  m_previousWindowRefresh = glfwSetWindowRefreshCallback(m_window, windowRefreshCallback);
+  m_previousWindowFocus = glfwSetWindowFocusCallback(m_window, windowFocusCallback);
+}
+
+MainLoop::~MainLoop() {
+  glfwSetCursorPosCallback(m_window, m_previousCursorPos);
+  glfwSetMouseButtonCallback(m_window, m_previousMouseButton);
+  glfwSetScrollCallback(m_window, m_previousScroll);
+  glfwSetKeyCallback(m_window, m_previousKey);
+  glfwSetCharCallback(m_window, m_previousChar);
+  glfwSetFramebufferSizeCallback(m_window, m_previousFramebufferSize);
+  glfwSetWindowRefreshCallback(m_window, m_previousWindowRefresh);
+  glfwSetWindowFocusCallback(m_window, m_previousWindowFocus);
+  glfwSetWindowUserPointer(m_window, nullptr);
+}
+
+void MainLoop::run(const FrameCallback& frame) {
+  while (!glfwWindowShouldClose(m_window)) {
+
+    if (m_options.continuous || m_pendingFrames > 0) {
+      if (m_framePacer) {
+        m_framePacer->waitForNextFrame();
+      }
+      STOCK_PROFILE_SCOPE("Events");
+      glfwPollEvents();
+    } else {
+      waitEvents();
+      if (m_framePacer) {
+        m_framePacer->beginFrame();
+      }
+    }
+
+    if (updatePendingFrames() || m_options.continuous) {
+      m_pendingFrames = std::max(m_pendingFrames - 1, 0);
+      m_frameCount++;
+      frame();
+    }
+  }
+}
+
+void MainLoop::requestRedraw() {
+  m_redrawRequested = true;
+  glfwPostEmptyEvent();
+}
+
+void MainLoop::requestRedraw(double delay) {
+  if (delay <= 0.) {
+    requestRedraw();
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_scheduleMutex);
+  double time = glfwGetTime() + delay;
+  if (m_scheduledRedraw < 0. || time < m_scheduledRedraw) {
+    m_scheduledRedraw = time;
+    // Wake the loop so that it waits for the new deadline.
+    glfwPostEmptyEvent();
+  }
+}
+
+bool MainLoop::updatePendingFrames() {
+  bool requested = m_redrawRequested.exchange(false);
+  {
+    std::lock_guard<std::mutex> lock(m_scheduleMutex);
+    if (m_scheduledRedraw >= 0. && glfwGetTime() >= m_scheduledRedraw) {
+      m_scheduledRedraw = -1.;
+      requested = true;
+    }
+  }
+  if (requested) {
+    m_pendingFrames = std::max(m_pendingFrames, FRAMES_PER_REDRAW);
+  }
+  return m_pendingFrames > 0;
+}
+
+void MainLoop::waitEvents() {
+  double scheduledRedraw;
+  {
+    std::lock_guard<std::mutex> lock(m_scheduleMutex);
+    scheduledRedraw = m_scheduledRedraw;
+  }
+  if (scheduledRedraw < 0.) {
+    glfwWaitEvents();
+  } else {
+    glfwWaitEventsTimeout(std::max(scheduledRedraw - glfwGetTime(), 0.));
+  }
+}
+
+MainLoop* MainLoop::fromWindow(GLFWwindow* window) {
+  return static_cast<MainLoop*>(glfwGetWindowUserPointer(window));
+}
+
+void MainLoop::cursorPosCallback(GLFWwindow* window, double x, double y) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousCursorPos) {
+    loop->m_previousCursorPos(window, x, y);
+  }
+  loop->m_redrawRequested = true;
+}
+
+void MainLoop::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousMouseButton) {
+    loop->m_previousMouseButton(window, button, action, mods);
+  }
+  loop->m_redrawRequested = true;
+}
+
+void MainLoop::scrollCallback(GLFWwindow* window, double x, double y) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousScroll) {
+    loop->m_previousScroll(window, x, y);
+  }
+  loop->m_redrawRequested = true;
+}
+
+void MainLoop::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousKey) {
+    loop->m_previousKey(window, key, scancode, action, mods);
+  }
+  loop->m_redrawRequested = true;
+}
+
+void MainLoop::charCallback(GLFWwindow* window, unsigned int codepoint) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousChar) {
+    loop->m_previousChar(window, codepoint);
+  }
+  loop->m_redrawRequested = true;
+}
+
+void MainLoop::framebufferSizeCallback(GLFWwindow* window, int width, int height) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousFramebufferSize) {
+    loop->m_previousFramebufferSize(window, width, height);
+  }
+  loop->m_redrawRequested = true;
+}
+
+void MainLoop::windowRefreshCallback(GLFWwindow* window) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousWindowRefresh) {
+    loop->m_previousWindowRefresh(window);
+  }
+  loop->m_redrawRequested = true;
+}
+
+void MainLoop::windowFocusCallback(GLFWwindow* window, int focused) {
+  auto loop = fromWindow(window);
+  if (loop->m_previousWindowFocus) {
+    loop->m_previousWindowFocus(window, focused);
+  }
+  loop->m_redrawRequested = true;
+}
+
+} // namespace stock
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+struct GLFWwindow;
+
+namespace stock {
+
+class FramePacer;
+
+// MainLoop runs the frames of a GLFW window and only draws when something has changed. Between frames it sleeps in
+// the GLFW event queue, and wakes up for input events, window changes, and calls to requestRedraw(), which can come
+// from any thread. Animations keep drawing by requesting a redraw in every frame that they change something.
+//
+// MainLoop forwards input events to the GLFW callbacks that were installed before it was created, so create it after
+// ImGuiImpl::Init().
+//
+// With a FramePacer, frames drawn back to back wait for the pacer before polling events, so that input is sampled as
+// close as possible to the time the frame is drawn.
+
+class MainLoop {
+
+public:
+  struct Options {
+    // Draw frames back to back, whether or not a redraw was requested.
+    bool continuous = false;
+  };
+
+  using FrameCallback = std::function<void()>;
+
+  // Number of frames drawn for each redraw request; immediate-mode UI can take a frame to settle after input.
+  static constexpr int FRAMES_PER_REDRAW = 2;
+
+  MainLoop(GLFWwindow* window, Options options);
+
+  ~MainLoop();
+
+  // Draw frames with the callback until the window should close.
+  void run(const FrameCallback& frame);
+
+  // Request a new frame as soon as possible; this may be called from any thread.
+  void requestRedraw();
+
+  // Request a new frame after a delay in seconds, e.g. when a timed effect ends; this may be called from any thread.
+  void requestRedraw(double delay);
+
+  void setContinuous(bool continuous) { m_options.continuous = continuous; }
+  bool isContinuous() const { return m_options.continuous; }
+
+  // Set a FramePacer to schedule the start of each frame, or null to start frames immediately.
+  void setFramePacer(FramePacer* pacer) { m_framePacer = pacer; }
+
+  // Get the number of frames drawn so far.
+  uint64_t frameCount() const { return m_frameCount; }
+
+private:
+  static MainLoop* fromWindow(GLFWwindow* window);
+
+  static void cursorPosCallback(GLFWwindow* window, double x, double y);
+  static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+  static void scrollCallback(GLFWwindow* window, double x, double y);
+  static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+  static void charCallback(GLFWwindow* window, unsigned int codepoint);
+  static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+  static void windowRefreshCallback(GLFWwindow* window);
+  static void windowFocusCallback(GLFWwindow* window, int focused);
+
+  // Take pending redraw requests into account; returns true if a frame should be drawn now.
+  bool updatePendingFrames();
+
+  // Wait for events until the next scheduled redraw, or indefinitely if there is none.
+  void waitEvents();
+
+  using CursorPosFunction = void (*)(GLFWwindow*, double, double);
+  using MouseButtonFunction = void (*)(GLFWwindow*, int, int, int);
+  using ScrollFunction = void (*)(GLFWwindow*, double, double);
+  using KeyFunction = void (*)(GLFWwindow*, int, int, int, int);
+  using CharFunction = void (*)(GLFWwindow*, unsigned int);
+  using FramebufferSizeFunction = void (*)(GLFWwindow*, int, int);
+  using WindowRefreshFunction = void (*)(GLFWwindow*);
+  using WindowFocusFunction = void (*)(GLFWwindow*, int);
+
+  CursorPosFunction m_previousCursorPos = nullptr;
+  MouseButtonFunction m_previousMouseButton = nullptr;
+  ScrollFunction m_previousScroll = nullptr;
+  KeyFunction m_previousKey = nullptr;
+  CharFunction m_previousChar = nullptr;
+  FramebufferSizeFunction m_previousFramebufferSize = nullptr;
+  WindowRefreshFunction m_previousWindowRefresh = nullptr;
+  WindowFocusFunction m_previousWindowFocus = nullptr;
+
+  GLFWwindow* m_window = nullptr;
+  FramePacer* m_framePacer = nullptr;
+  Options m_options;
+  std::atomic<bool> m_redrawRequested{true};
+  // Time of the earliest scheduled redraw in seconds on the GLFW clock, or a negative value if there is none.
+  double m_scheduledRedraw = -1.;
+  std::mutex m_scheduleMutex;
+  int m_pendingFrames = 0;
+  uint64_t m_frameCount = 0;
+};
+
+} // namespace stock
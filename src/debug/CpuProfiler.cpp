@@ -0,0 +1,199 @@
+#include "debug/CpuProfiler.hpp"
+#include "io/Log.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <imgui.h>
+#include <memory>
+#include <mutex>
+
+namespace stock {
+
+// Each thread writes only to its own buffer; readers copy the buffer and then discard any events that the writer may
+// have overwritten while the copy was made.
+struct ThreadBuffer {
+  std::array<CpuProfiler::Event, CpuProfiler::EVENTS_PER_THREAD> events;
+  std::atomic<uint64_t> count{0};
+  std::string name;
+  uint32_t id = 0;
+  uint32_t depth = 0;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+static Registry& registry() {
+  static Registry instance;
+  return instance;
+}
+
+static thread_local ThreadBuffer* t_buffer = nullptr;
+
+static ThreadBuffer& threadBuffer() {
+  if (t_buffer == nullptr) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.buffers.emplace_back(new ThreadBuffer());
+    t_buffer = reg.buffers.back().get();
+    t_buffer->id = static_cast<uint32_t>(reg.buffers.size());
+    t_buffer->name = "Thread " + std::to_string(t_buffer->id);
+  }
+  return *t_buffer;
+}
+
+CpuProfiler::Zone::Zone(const char* name) : m_name(name) {
+  threadBuffer().depth++;
+  m_start = now();
+}
+
+CpuProfiler::Zone::~Zone() {
+  auto end = now();
+  auto& buffer = threadBuffer();
+  buffer.depth--;
+  record(m_name, m_start, end, buffer.depth);
+}
+
+uint64_t CpuProfiler::now() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::now() - epoch;
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void CpuProfiler::setThreadName(const std::string& name) {
+  auto& buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  buffer.name = name;
+}
+
+void CpuProfiler::record(const char* name, uint64_t start, uint64_t end, uint32_t depth) {
+  auto& buffer = threadBuffer();
+  auto count = buffer.count.load(std::memory_order_relaxed);
+  // Keep the write below from becoming visible before the count that a reader checks it against.
+  std::atomic_thread_fence(std::memory_order_release);
+  buffer.events[count % EVENTS_PER_THREAD] = {name, start, end, depth};
+  buffer.count.store(count + 1, std::memory_order_release);
+}
+
+std::vector<CpuProfiler::Thread> CpuProfiler::snapshot() {
+  std::vector<Thread> threads;
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (const auto& buffer : reg.buffers) {
+    Thread thread;
+    thread.id = buffer->id;
+    thread.name = buffer->name;
+    // Skip the oldest slot, which the writer may already be overwriting with event 'end'.
+    uint64_t end = buffer->count.load(std::memory_order_acquire);
+    uint64_t begin = end + 1 > EVENTS_PER_THREAD ? end + 1 - EVENTS_PER_THREAD : 0;
+    thread.events.reserve(end - begin);
+    for (uint64_t i = begin; i < end; i++) {
+      thread.events.push_back(buffer->events[i % EVENTS_PER_THREAD]);
+    }
+    // Drop events from the front that were overwritten during the copy, in the same way.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t written = buffer->count.load(std::memory_order_relaxed);
+    uint64_t overwritten = written + 1 > EVENTS_PER_THREAD ? written + 1 - EVENTS_PER_THREAD : 0;
+    if (overwritten > begin) {
+      auto drop = std::min<uint64_t>(overwritten - begin, thread.events.size());
+      thread.events.erase(thread.events.begin(), thread.events.begin() + drop);
+    }
+    threads.push_back(std::move(thread));
+  }
+  return threads;
+}
+
+static void writeJsonString(std::FILE* file, const char* string) {
+  std::fputc('"', file);
+  for (const char* c = string; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(*c, file);
+  }
+  std::fputc('"', file);
+}
+
+bool CpuProfiler::writeChromeTrace(const std::string& path) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    Log::ef("Unable to open trace file: %s\n", path.c_str());
+    return false;
+  }
+  auto threads = snapshot();
+  bool first = true;
+  std::fputs("{\"traceEvents\":[\n", file);
+  for (const auto& thread : threads) {
+    std::fprintf(file, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":",
+                 first ? "" : ",\n", thread.id);
+    writeJsonString(file, thread.name.c_str());
+    std::fputs("}}", file);
+    first = false;
+    for (const auto& event : thread.events) {
+      std::fputs(",\n{\"ph\":\"X\",\"pid\":1,\"name\":", file);
+      writeJsonString(file, event.name);
+      // Trace event timestamps are in microseconds.
+      std::fprintf(file, ",\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread.id, event.start * 1e-3,
+                   (event.end - event.start) * 1e-3);
+    }
+  }
+  std::fputs("\n]}\n", file);
+  bool success = std::ferror(file) == 0;
+  std::fclose(file);
+  return success;
+}
+
+void CpuProfiler::drawFlameView(float milliseconds) {
+  if (!ImGui::TreeNode("CPU Timing")) {
+    return;
+  }
+#if !defined(STOCK_PROFILING)
+  ImGui::Text("Profiling zones are compiled out; build with STOCK_PROFILING to enable them.");
+#endif
+  static const float rowHeight = ImGui::GetTextLineHeight() + 2.f;
+  uint64_t windowEnd = now();
+  uint64_t span = static_cast<uint64_t>(milliseconds * 1e6f);
+  uint64_t windowStart = windowEnd > span ? windowEnd - span : 0;
+  float width = ImGui::GetContentRegionAvailWidth();
+  float scale = width / std::max<uint64_t>(windowEnd - windowStart, 1);
+  auto* drawList = ImGui::GetWindowDrawList();
+
+  for (const auto& thread : snapshot()) {
+    uint32_t maxDepth = 0;
+    for (const auto& event : thread.events) {
+      maxDepth = std::max(maxDepth, event.depth);
+    }
+    ImGui::Text("%s", thread.name.c_str());
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImVec2 size(width, rowHeight * (maxDepth + 1));
+    ImGui::PushClipRect(origin, ImVec2(origin.x + size.x, origin.y + size.y), true);
+    for (const auto& event : thread.events) {
+      if (event.end < windowStart) {
+        continue;
+      }
+      float x0 = origin.x + (event.start > windowStart ? (event.start - windowStart) * scale : 0.f);
+      float x1 = origin.x + (event.end - windowStart) * scale;
+      if (x1 - x0 < 1.f) {
+        x1 = x0 + 1.f;
+      }
+      ImVec2 min(x0, origin.y + event.depth * rowHeight), max(x1, min.y + rowHeight - 1.f);
+      float hue = (std::hash<const void*>()(event.name) % 360) / 360.f;
+      drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.6f));
+      if (ImGui::CalcTextSize(event.name).x < x1 - x0) {
+        drawList->AddText(ImVec2(x0 + 1.f, min.y), ImGui::GetColorU32(ImGuiCol_Text), event.name);
+      }
+      if (ImGui::IsMouseHoveringRect(min, max)) {
+        ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end - event.start) * 1e-6);
+      }
+    }
+    ImGui::PopClipRect();
+    ImGui::Dummy(size);
+  }
+  ImGui::TreePop();
+}
+
+} // namespace stock
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stock {
+
+// CpuProfiler records timed zones from any thread into a fixed-size ring buffer owned by that thread, so recording
+// never takes a lock. Zones are usually marked with STOCK_PROFILE_SCOPE, which compiles to nothing unless
+// STOCK_PROFILING is defined.
+
+class CpuProfiler {
+
+public:
+  // Number of most recent zones kept for each thread.
+  static constexpr size_t EVENTS_PER_THREAD = 1 << 14;
+
+  struct Event {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t depth;
+  };
+
+  struct Thread {
+    uint32_t id;
+    std::string name;
+    std::vector<Event> events;
+  };
+
+  // Marks a zone on the current thread for the lifetime of the object.
+  class Zone {
+  public:
+    Zone(const char* name);
+    ~Zone();
+
+  private:
+    const char* m_name;
+    uint64_t m_start;
+  };
+
+  // Get a monotonic timestamp in nanoseconds.
+  static uint64_t now();
+
+  // Set the name displayed for the current thread.
+  static void setThreadName(const std::string& name);
+
+  // Record a completed zone on the current thread; 'name' must outlive the profiler (e.g. a string literal).
+  static void record(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+
+  // Copy the recorded zones of all threads, ordered by completion time within each thread.
+  static std::vector<Thread> snapshot();
+
+  // Write the recorded zones of all threads to a file in the Chrome trace event JSON format, which can be opened
+  // in chrome://tracing or Perfetto; returns true if the file was written.
+  static bool writeChromeTrace(const std::string& path);
+
+  // Show the zones from the last 'milliseconds' as a flame graph per thread in the current ImGui window.
+  static void drawFlameView(float milliseconds = 50.f);
+};
+
+} // namespace stock
+
+#if defined(STOCK_PROFILING)
+#define STOCK_PROFILE_CONCAT_INNER(a, b) a##b
+#define STOCK_PROFILE_CONCAT(a, b) STOCK_PROFILE_CONCAT_INNER(a, b)
+#define STOCK_PROFILE_SCOPE(name) ::stock::CpuProfiler::Zone STOCK_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define STOCK_PROFILE_THREAD(name) ::stock::CpuProfiler::setThreadName(name)
+#else
+#define STOCK_PROFILE_SCOPE(name)
+#define STOCK_PROFILE_THREAD(name)
+#endif
@@ -3,10 +3,18 @@
 //
 
 #include "debug/DebugDraw.hpp"
+#include "gl/Extensions.hpp"
 #include "gl/Mesh.hpp"
 #include "gl/ShaderProgram.hpp"
 #include "gl/ShaderUniform.hpp"
 #include "gl/VertexLayout.hpp"
+#include "transform/BoundingBox.hpp"
+#include "view/Camera.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 
 namespace stock {
 
@@ -17,6 +25,11 @@ struct PosColVert {
   unsigned int color;
 };
 
+struct InstanceVert {
+  glm::mat4 transform;
+  unsigned int color;
+};
+
 // Declare static resources for rendering.
 static const std::string vs_src = R"SHADER_END(
 attribute vec3 a_position;
@@ -28,7 +41,26 @@ void main() {
     gl_Position = u_mvp * vec4(a_position, 1.);
 }
 )SHADER_END";
+static const std::string instanced_vs_src = R"SHADER_END(
+attribute vec3 a_position;
+attribute vec4 a_color;
+attribute vec4 a_transform0;
+attribute vec4 a_transform1;
+attribute vec4 a_transform2;
+attribute vec4 a_transform3;
+attribute vec4 a_instanceColor;
+varying vec4 v_color;
+uniform mat4 u_mvp;
+void main() {
+    mat4 transform = mat4(a_transform0, a_transform1, a_transform2, a_transform3);
+    v_color = a_color * a_instanceColor;
+    gl_Position = u_mvp * transform * vec4(a_position, 1.);
+}
+)SHADER_END";
 static const std::string fs_src = R"SHADER_END(
+#ifdef GL_ES
+precision mediump float;
+#endif
 varying vec4 v_color;
 void main() {
     gl_FragColor = v_color;
@@ -37,56 +69,324 @@ void main() {
 constexpr unsigned int X_AXIS_COLOR = 0xff0000ff;
 constexpr unsigned int Y_AXIS_COLOR = 0xff00ff00;
 constexpr unsigned int Z_AXIS_COLOR = 0xffff0000;
+constexpr unsigned int WHITE = 0xffffffff;
+constexpr int CIRCLE_SEGMENTS = 32;
 static glm::mat4 g_modelViewProjectionMatrix;
 static ShaderProgram g_shaderProgram(fs_src, vs_src);
+static ShaderProgram g_instancedShaderProgram(fs_src, instanced_vs_src);
 static UniformLocation g_mvpMatrixLocation("u_mvp");
-static Mesh<PosColVert> g_mesh;
+static UniformLocation g_instancedMvpMatrixLocation("u_mvp");
 static VertexLayout g_vertexLayout({
   VertexAttribute("a_position", 3, GL_FLOAT, GL_FALSE),
   VertexAttribute("a_color", 4, GL_UNSIGNED_BYTE, GL_TRUE),
 });
+static VertexLayout g_instanceLayout({
+  VertexAttribute("a_transform0", 4, GL_FLOAT, GL_FALSE, 1),
+  VertexAttribute("a_transform1", 4, GL_FLOAT, GL_FALSE, 1),
+  VertexAttribute("a_transform2", 4, GL_FLOAT, GL_FALSE, 1),
+  VertexAttribute("a_transform3", 4, GL_FLOAT, GL_FALSE, 1),
+  VertexAttribute("a_instanceColor", 4, GL_UNSIGNED_BYTE, GL_TRUE, 1),
+});
+
+enum ShapeType {
+  POINT,
+  SEGMENT,
+  BOX,
+  SPHERE,
+  ARROW,
+  GRID,
+  SHAPE_TYPE_COUNT,
+};
+
+struct Instance {
+  glm::mat4 transform;
+  unsigned int color;
+  // Value of g_flushCount at and after which the shape may be removed.
+  uint64_t expireFlush;
+  Clock::time_point expireTime;
+};
+
+struct Shape {
+  // Line list of the shape in its unit space; the vertices are kept for drawing without instancing.
+  Mesh<PosColVert> mesh;
+  std::vector<Instance> instances;
+};
+
+static std::array<Shape, SHAPE_TYPE_COUNT> g_shapes;
+static bool g_hasShapeMeshes = false;
+static uint64_t g_flushCount = 0;
+
+// Per-instance data for all shapes, and the line list used when instancing is not supported.
+static MeshBase g_instanceMesh;
+static std::vector<InstanceVert> g_instanceVertices;
+static MeshBase g_lineMesh;
+static std::vector<PosColVert> g_lineVertices;
+
+static void addLine(std::vector<PosColVert>& vertices, const glm::vec3& a, const glm::vec3& b,
+                    unsigned int color = WHITE) {
+  vertices.push_back({a.x, a.y, a.z, color});
+  vertices.push_back({b.x, b.y, b.z, color});
+}
+
+static void addCircle(std::vector<PosColVert>& vertices, int axisA, int axisB) {
+  for (int i = 0; i < CIRCLE_SEGMENTS; i++) {
+    glm::vec3 a(0.f), b(0.f);
+    float angleA = 2.f * 3.14159265f * i / CIRCLE_SEGMENTS;
+    float angleB = 2.f * 3.14159265f * (i + 1) / CIRCLE_SEGMENTS;
+    a[axisA] = std::cos(angleA);
+    a[axisB] = std::sin(angleA);
+    b[axisA] = std::cos(angleB);
+    b[axisB] = std::sin(angleB);
+    addLine(vertices, a, b);
+  }
+}
+
+static void buildShapeMeshes() {
+  for (auto& shape : g_shapes) {
+    shape.mesh.setVertexLayout(g_vertexLayout);
+    shape.mesh.setDrawMode(GL_LINES);
+    shape.mesh.retainData = true;
+  }
+
+  auto& point = g_shapes[POINT].mesh.vertices;
+  addLine(point, {-.5f, 0.f, 0.f}, {.5f, 0.f, 0.f}, X_AXIS_COLOR);
+  addLine(point, {0.f, -.5f, 0.f}, {0.f, .5f, 0.f}, Y_AXIS_COLOR);
+  addLine(point, {0.f, 0.f, -.5f}, {0.f, 0.f, .5f}, Z_AXIS_COLOR);
+
+  addLine(g_shapes[SEGMENT].mesh.vertices, {0.f, 0.f, 0.f}, {0.f, 0.f, 1.f});
+
+  auto& box = g_shapes[BOX].mesh.vertices;
+  for (int axis = 0; axis < 3; axis++) {
+    for (float u : {-1.f, 1.f}) {
+      for (float v : {-1.f, 1.f}) {
+        glm::vec3 a, b;
+        a[axis] = -1.f;
+        b[axis] = 1.f;
+        a[(axis + 1) % 3] = b[(axis + 1) % 3] = u;
+        a[(axis + 2) % 3] = b[(axis + 2) % 3] = v;
+        addLine(box, a, b);
+      }
+    }
+  }
+
+  auto& sphere = g_shapes[SPHERE].mesh.vertices;
+  addCircle(sphere, 0, 1);
+  addCircle(sphere, 1, 2);
+  addCircle(sphere, 2, 0);
+
+  auto& arrow = g_shapes[ARROW].mesh.vertices;
+  addLine(arrow, {0.f, 0.f, 0.f}, {0.f, 0.f, 1.f});
+  addLine(arrow, {0.f, 0.f, 1.f}, {.1f, 0.f, .8f});
+  addLine(arrow, {0.f, 0.f, 1.f}, {-.1f, 0.f, .8f});
+  addLine(arrow, {0.f, 0.f, 1.f}, {0.f, .1f, .8f});
+  addLine(arrow, {0.f, 0.f, 1.f}, {0.f, -.1f, .8f});
+
+  auto& grid = g_shapes[GRID].mesh.vertices;
+  for (int i = 0; i <= GRID_DIVISIONS; i++) {
+    float t = -1.f + 2.f * i / GRID_DIVISIONS;
+    addLine(grid, {t, 0.f, -1.f}, {t, 0.f, 1.f});
+    addLine(grid, {-1.f, 0.f, t}, {1.f, 0.f, t});
+  }
+
+  g_hasShapeMeshes = true;
+}
+
+static void addInstance(ShapeType type, const glm::mat4& transform, unsigned int color, const Lifetime& lifetime) {
+  auto expireTime = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<float>(std::max(lifetime.duration, 0.f)));
+  uint64_t expireFlush = g_flushCount + std::max<uint32_t>(lifetime.frameCount, 1);
+  g_shapes[type].instances.push_back({transform, color, expireFlush, expireTime});
+}
+
+// Multiply two colors component-wise, as the instanced shader does.
+static unsigned int modulate(unsigned int a, unsigned int b) {
+  unsigned int result = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    unsigned int product = ((a >> shift) & 0xff) * ((b >> shift) & 0xff) / 255;
+    result |= product << shift;
+  }
+  return result;
+}
+
+Lifetime Lifetime::frames(uint32_t count) {
+  Lifetime lifetime;
+  lifetime.frameCount = count;
+  return lifetime;
+}
+
+Lifetime Lifetime::seconds(float duration) {
+  Lifetime lifetime;
+  lifetime.duration = duration;
+  return lifetime;
+}
 
 void dispose(RenderState& rs) {
   g_shaderProgram.dispose(rs);
-  g_mesh.dispose(rs);
+  g_instancedShaderProgram.dispose(rs);
+  for (auto& shape : g_shapes) {
+    shape.mesh.dispose(rs);
+    shape.mesh.reset();
+  }
+  g_hasShapeMeshes = false;
+  g_instanceMesh.dispose(rs);
+  g_lineMesh.dispose(rs);
+  clear();
 }
 
 void cameraMatrix(const glm::mat4& matrix) {
   g_modelViewProjectionMatrix = matrix;
 }
 
-// Render the current mesh contents immediately and then reset it.
-void render(RenderState& rs) {
+void point(const glm::vec3& pos, Lifetime lifetime) {
+  addInstance(POINT, glm::translate(glm::mat4(1.f), pos), WHITE, lifetime);
+}
+
+void line(const glm::vec3& start, const glm::vec3& end, unsigned int color, Lifetime lifetime) {
+  // Map the unit segment along Z onto the line; the other axes are unused.
+  glm::mat4 transform(0.f);
+  transform[2] = glm::vec4(end - start, 0.f);
+  transform[3] = glm::vec4(start, 1.f);
+  addInstance(SEGMENT, transform, color, lifetime);
+}
+
+void linestring(const std::vector<glm::vec3>& positions, unsigned int color, Lifetime lifetime) {
+  for (size_t i = 1; i < positions.size(); i++) {
+    line(positions[i - 1], positions[i], color, lifetime);
+  }
+}
+
+void box(const BoundingBox& bounds, unsigned int color, Lifetime lifetime) {
+  if (bounds.isEmpty()) {
+    return;
+  }
+  auto transform = glm::scale(glm::translate(glm::mat4(1.f), bounds.center()), bounds.extents());
+  addInstance(BOX, transform, color, lifetime);
+}
+
+void box(const glm::mat4& transform, unsigned int color, Lifetime lifetime) {
+  addInstance(BOX, transform, color, lifetime);
+}
+
+void sphere(const glm::vec3& center, float radius, unsigned int color, Lifetime lifetime) {
+  auto transform = glm::scale(glm::translate(glm::mat4(1.f), center), glm::vec3(radius));
+  addInstance(SPHERE, transform, color, lifetime);
+}
+
+void frustum(const Camera& camera, unsigned int color, Lifetime lifetime) {
+  // The frustum is the clip space cube mapped back into world space by the inverse view-projection.
+  addInstance(BOX, glm::inverse(camera.viewProjectionMatrix()), color, lifetime);
+}
+
+void arrow(const glm::vec3& start, const glm::vec3& end, unsigned int color, Lifetime lifetime) {
+  glm::vec3 direction = end - start;
+  float length = glm::length(direction);
+  if (length <= 0.f) {
+    return;
+  }
+  glm::vec3 z = direction / length;
+  glm::vec3 up = std::abs(z.y) < .99f ? glm::vec3(0.f, 1.f, 0.f) : glm::vec3(1.f, 0.f, 0.f);
+  glm::vec3 x = glm::normalize(glm::cross(up, z));
+  glm::vec3 y = glm::cross(z, x);
+  glm::mat4 transform(glm::vec4(x * length, 0.f), glm::vec4(y * length, 0.f), glm::vec4(direction, 0.f),
+                      glm::vec4(start, 1.f));
+  addInstance(ARROW, transform, color, lifetime);
+}
+
+void grid(const glm::vec3& center, float size, unsigned int color, Lifetime lifetime) {
+  auto transform = glm::scale(glm::translate(glm::mat4(1.f), center), glm::vec3(size * .5f, 1.f, size * .5f));
+  addInstance(GRID, transform, color, lifetime);
+}
+
+static void drawInstanced(RenderState& rs) {
+  g_instanceVertices.clear();
+  for (const auto& shape : g_shapes) {
+    for (const auto& instance : shape.instances) {
+      g_instanceVertices.push_back({instance.transform, instance.color});
+    }
+  }
+  g_instanceMesh.setVertexLayout(g_instanceLayout);
+  g_instanceMesh.uploadVertices(rs, g_instanceVertices.data(), g_instanceVertices.size(), GL_STREAM_DRAW);
+
+  g_instancedShaderProgram.setUniformMatrix4f(rs, g_instancedMvpMatrixLocation, g_modelViewProjectionMatrix);
+  size_t firstInstance = 0;
+  for (auto& shape : g_shapes) {
+    if (!shape.instances.empty()) {
+      shape.mesh.drawInstanced(rs, g_instancedShaderProgram, g_instanceMesh, firstInstance, shape.instances.size());
+      firstInstance += shape.instances.size();
+    }
+  }
+}
+
+static void drawLines(RenderState& rs) {
+  g_lineVertices.clear();
+  for (const auto& shape : g_shapes) {
+    for (const auto& instance : shape.instances) {
+      for (const auto& v : shape.mesh.vertices) {
+        auto p = instance.transform * glm::vec4(v.x, v.y, v.z, 1.f);
+        // Divide by w to bring projective transforms like frustums back into world space.
+        p /= p.w != 0.f ? p.w : 1.f;
+        g_lineVertices.push_back({p.x, p.y, p.z, modulate(v.color, instance.color)});
+      }
+    }
+  }
+  g_shaderProgram.setUniformMatrix4f(rs, g_mvpMatrixLocation, g_modelViewProjectionMatrix);
+  g_lineMesh.setVertexLayout(g_vertexLayout);
+  g_lineMesh.setDrawMode(GL_LINES);
+  g_lineMesh.uploadVertices(rs, g_lineVertices.data(), g_lineVertices.size(), GL_STREAM_DRAW);
+  g_lineMesh.draw(rs, g_shaderProgram);
+}
+
+void flush(RenderState& rs) {
+  bool hasInstances = false;
+  for (const auto& shape : g_shapes) {
+    hasInstances = hasInstances || !shape.instances.empty();
+  }
+  if (!hasInstances) {
+    removeExpired(Clock::now());
+    return;
+  }
+
+  if (!g_hasShapeMeshes) {
+    buildShapeMeshes();
+  }
+
   rs.culling(false);
   rs.blending(false);
   rs.depthTest(false);
-  g_shaderProgram.setUniformMatrix4f(rs, g_mvpMatrixLocation, g_modelViewProjectionMatrix);
-  g_mesh.setVertexLayout(g_vertexLayout);
-  g_mesh.upload(rs, GL_STREAM_DRAW);
-  g_mesh.draw(rs, g_shaderProgram);
-  g_mesh.reset();
-}
-
-void point(RenderState& rs, const glm::vec3& pos) {
-  g_mesh.vertices = {
-     {pos.x - 0.5f, pos.y, pos.z, X_AXIS_COLOR},
-     {pos.x + 0.5f, pos.y, pos.z, X_AXIS_COLOR},
-     {pos.x, pos.y - 0.5f, pos.z, Y_AXIS_COLOR},
-     {pos.x, pos.y + 0.5f, pos.z, Y_AXIS_COLOR},
-     {pos.x, pos.y, pos.z - 0.5f, Z_AXIS_COLOR},
-     {pos.x, pos.y, pos.z + 0.5f, Z_AXIS_COLOR},
-  };
-  g_mesh.setDrawMode(GL_LINES);
-  render(rs);
-}
-
-void linestring(RenderState& rs, const std::vector<glm::vec3>& positions) {
-  g_mesh.vertices.reserve(positions.size());
-  for (const auto& pos : positions) {
-    g_mesh.vertices.push_back({pos.x, pos.y, pos.z, 0xff00ffff});
-  }
-  g_mesh.setDrawMode(GL_LINE_STRIP);
-  render(rs);
+  if (Extensions::instancedArrays) {
+    drawInstanced(rs);
+  } else {
+    drawLines(rs);
+  }
+
+  removeExpired(Clock::now());
+}
+
+void removeExpired(Clock::time_point time) {
+  // Remove the shapes that have used up both their frames and their time.
+  uint64_t flushCount = ++g_flushCount;
+  for (auto& shape : g_shapes) {
+    auto& instances = shape.instances;
+    instances.erase(std::remove_if(instances.begin(), instances.end(),
+                                   [=](const Instance& instance) {
+                                     return instance.expireFlush <= flushCount && instance.expireTime <= time;
+                                   }),
+                    instances.end());
+  }
+}
+
+size_t shapeCount() {
+  size_t count = 0;
+  for (const auto& shape : g_shapes) {
+    count += shape.instances.size();
+  }
+  return count;
+}
+
+void clear() {
+  for (auto& shape : g_shapes) {
+    shape.instances.clear();
+  }
 }
 
 } // namespace DebugDraw
@@ -6,19 +6,86 @@
 #include "gl/RenderState.hpp"
 #include "glm/mat4x4.hpp"
 #include "glm/vec3.hpp"
+#include <chrono>
+#include <cstdint>
 #include <vector>
 
 namespace stock {
 
+class BoundingBox;
+class Camera;
+
+// DebugDraw collects debug shapes and draws them all at once in flush(). Each kind of shape is a unit mesh that is
+// drawn with one instanced draw call, using a transform and color per shape. Without instancing support the shapes
+// are expanded into a single line list instead.
+//
+// Shapes are drawn in the next flush() only, unless they are given a longer Lifetime.
+
 namespace DebugDraw {
 
+using Clock = std::chrono::steady_clock;
+
+// How long a shape stays visible after it is added.
+struct Lifetime {
+  Lifetime() = default;
+
+  // Keep the shape for the given number of calls to flush().
+  static Lifetime frames(uint32_t count);
+
+  // Keep the shape for the given time, and for at least one call to flush().
+  static Lifetime seconds(float duration);
+
+  uint32_t frameCount = 1;
+  float duration = 0.f;
+};
+
+constexpr unsigned int DEFAULT_COLOR = 0xff00ffff;
+
+// Number of cells along each side of a grid.
+constexpr int GRID_DIVISIONS = 10;
+
+// Set the matrix used to draw the shapes in the next flush().
 void cameraMatrix(const glm::mat4& matrix);
 
 void dispose(RenderState& rs);
 
-void point(RenderState& rs, const glm::vec3& position);
+// Draw a set of axes, one unit long, centered on a point.
+void point(const glm::vec3& position, Lifetime lifetime = Lifetime());
+
+void line(const glm::vec3& start, const glm::vec3& end, unsigned int color = DEFAULT_COLOR,
+          Lifetime lifetime = Lifetime());
+
+void linestring(const std::vector<glm::vec3>& positions, unsigned int color = DEFAULT_COLOR,
+                Lifetime lifetime = Lifetime());
+
+void box(const BoundingBox& box, unsigned int color = DEFAULT_COLOR, Lifetime lifetime = Lifetime());
+
+// Draw the cube from (-1, -1, -1) to (1, 1, 1) transformed by a matrix.
+void box(const glm::mat4& transform, unsigned int color = DEFAULT_COLOR, Lifetime lifetime = Lifetime());
+
+// Draw a sphere as three circles around its axes.
+void sphere(const glm::vec3& center, float radius, unsigned int color = DEFAULT_COLOR, Lifetime lifetime = Lifetime());
+
+// Draw the volume visible to a camera, from its near plane to its far plane.
+void frustum(const Camera& camera, unsigned int color = DEFAULT_COLOR, Lifetime lifetime = Lifetime());
+
+void arrow(const glm::vec3& start, const glm::vec3& end, unsigned int color = DEFAULT_COLOR,
+           Lifetime lifetime = Lifetime());
+
+// Draw a square grid in the XZ plane, 'size' units wide.
+void grid(const glm::vec3& center, float size, unsigned int color = DEFAULT_COLOR, Lifetime lifetime = Lifetime());
+
+// Draw all current shapes, then remove the shapes whose lifetime has ended.
+void flush(RenderState& rs);
+
+// Count a flush and remove the shapes whose lifetime has ended at 'time'; flush() calls this after drawing.
+void removeExpired(Clock::time_point time);
+
+// Get the number of shapes to draw in the next flush().
+size_t shapeCount();
 
-void linestring(RenderState& rs, const std::vector<glm::vec3>& positions);
+// Remove all shapes, including those with a lifetime that hasn't ended.
+void clear();
 
 } // namespace DebugDraw
 
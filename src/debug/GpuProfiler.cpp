@@ -0,0 +1,168 @@
+#include "debug/GpuProfiler.hpp"
+#include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
+#include <cassert>
+#include <imgui.h>
+
+namespace stock {
+
+// Number of query objects to generate whenever a frame's pool runs out.
+static constexpr size_t QUERY_POOL_GROWTH = 32;
+
+GpuProfiler::~GpuProfiler() {
+  for (const auto& frame : m_frames) {
+    assert(frame.queries.empty());
+  }
+}
+
+bool GpuProfiler::isSupported() const {
+  return Extensions::timerQuery;
+}
+
+GLuint GpuProfiler::nextQuery(Frame& frame) {
+  if (frame.queryCount == frame.queries.size()) {
+    frame.queries.resize(frame.queries.size() + QUERY_POOL_GROWTH);
+    CHECK_GL(glGenQueriesEXT(QUERY_POOL_GROWTH, &frame.queries[frame.queryCount]));
+  }
+  return frame.queryCount++;
+}
+
+void GpuProfiler::beginFrame() {
+  if (!isSupported()) {
+    return;
+  }
+  // If this frame's previous results never became available, drop them instead of waiting.
+  auto& frame = m_frames[m_frameIndex];
+  frame.markers.clear();
+  frame.queryCount = 0;
+  frame.pending = false;
+  m_stack.clear();
+  pushScope("Frame");
+}
+
+void GpuProfiler::endFrame() {
+  if (!isSupported()) {
+    return;
+  }
+  while (!m_stack.empty()) {
+    popScope();
+  }
+  m_frames[m_frameIndex].pending = true;
+  m_frameIndex = (m_frameIndex + 1) % FRAMES_IN_FLIGHT;
+
+  // On ES a disjoint operation (e.g. a frequency change) invalidates all timer queries in flight.
+  GLint disjoint = 0;
+  if (Extensions::isEs()) {
+    CHECK_GL(glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint));
+  }
+
+  // Frames complete in order, so visit them from oldest to newest and stop at the first one still in flight.
+  for (size_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
+    auto& frame = m_frames[(m_frameIndex + i) % FRAMES_IN_FLIGHT];
+    if (!frame.pending) {
+      continue;
+    }
+    if (disjoint) {
+      frame.pending = false;
+      continue;
+    }
+    GLuint available = 0;
+    CHECK_GL(glGetQueryObjectuivEXT(frame.queries[frame.markers.front().endQuery], GL_QUERY_RESULT_AVAILABLE_EXT,
+                                    &available));
+    if (!available) {
+      break;
+    }
+    collect(frame);
+  }
+}
+
+void GpuProfiler::collect(Frame& frame) {
+  std::vector<uint64_t> timestamps(frame.queryCount);
+  for (uint32_t i = 0; i < frame.queryCount; i++) {
+    CHECK_GL(glGetQueryObjectui64vEXT(frame.queries[i], GL_QUERY_RESULT_EXT, &timestamps[i]));
+  }
+  m_results.clear();
+  for (const auto& marker : frame.markers) {
+    auto nanoseconds = timestamps[marker.endQuery] - timestamps[marker.beginQuery];
+    m_results.push_back({marker.name, marker.depth, nanoseconds * 1e-6});
+  }
+  frame.pending = false;
+}
+
+void GpuProfiler::pushScope(const char* name) {
+  if (!isSupported()) {
+    return;
+  }
+  auto& frame = m_frames[m_frameIndex];
+  Marker marker;
+  marker.name = name;
+  marker.depth = static_cast<uint32_t>(m_stack.size());
+  marker.beginQuery = nextQuery(frame);
+  marker.endQuery = marker.beginQuery;
+  CHECK_GL(glQueryCounterEXT(frame.queries[marker.beginQuery], GL_TIMESTAMP_EXT));
+  m_stack.push_back(static_cast<uint32_t>(frame.markers.size()));
+  frame.markers.push_back(marker);
+}
+
+void GpuProfiler::popScope() {
+  if (!isSupported() || m_stack.empty()) {
+    return;
+  }
+  auto& frame = m_frames[m_frameIndex];
+  auto& marker = frame.markers[m_stack.back()];
+  marker.endQuery = nextQuery(frame);
+  CHECK_GL(glQueryCounterEXT(frame.queries[marker.endQuery], GL_TIMESTAMP_EXT));
+  m_stack.pop_back();
+}
+
+double GpuProfiler::frameMilliseconds() const {
+  return m_results.empty() ? 0. : m_results.front().milliseconds;
+}
+
+// Draw the result at 'index' and its children, returning the index after the last child.
+static size_t drawResultTree(const std::vector<GpuProfiler::Result>& results, size_t index) {
+  const auto& result = results[index];
+  bool hasChildren = index + 1 < results.size() && results[index + 1].depth > result.depth;
+  ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | (hasChildren ? 0 : ImGuiTreeNodeFlags_Leaf);
+  bool open = ImGui::TreeNodeEx(reinterpret_cast<void*>(index), flags, "%s: %.3f ms", result.name, result.milliseconds);
+  index++;
+  while (index < results.size() && results[index].depth > result.depth) {
+    if (open) {
+      index = drawResultTree(results, index);
+    } else {
+      index++;
+    }
+  }
+  if (open) {
+    ImGui::TreePop();
+  }
+  return index;
+}
+
+void GpuProfiler::drawPanel() const {
+  if (!ImGui::TreeNode("GPU Timing")) {
+    return;
+  }
+  if (!isSupported()) {
+    ImGui::Text("Timer queries are not supported by this context.");
+  }
+  for (size_t index = 0; index < m_results.size();) {
+    index = drawResultTree(m_results, index);
+  }
+  ImGui::TreePop();
+}
+
+void GpuProfiler::dispose(RenderState&) {
+  for (auto& frame : m_frames) {
+    if (!frame.queries.empty()) {
+      CHECK_GL(glDeleteQueriesEXT(static_cast<GLsizei>(frame.queries.size()), frame.queries.data()));
+    }
+    frame.queries.clear();
+    frame.markers.clear();
+    frame.queryCount = 0;
+    frame.pending = false;
+  }
+  m_stack.clear();
+}
+
+} // namespace stock
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace stock {
+
+class RenderState;
+
+// GpuProfiler measures GPU time spent in named, nested scopes using timestamp queries. Queries for each frame are
+// read back a few frames later, only once the GPU reports them as available, so profiling never stalls the pipeline.
+
+class GpuProfiler {
+
+public:
+  // Number of frames whose queries can be in flight at once; results that are not available after this many frames
+  // are dropped rather than waited on.
+  static constexpr size_t FRAMES_IN_FLIGHT = 4;
+
+  struct Result {
+    const char* name;
+    uint32_t depth;
+    double milliseconds;
+  };
+
+  // Marks a scope for the lifetime of the object.
+  class Scope {
+  public:
+    Scope(GpuProfiler& profiler, const char* name) : m_profiler(profiler) { m_profiler.pushScope(name); }
+    ~Scope() { m_profiler.popScope(); }
+
+  private:
+    GpuProfiler& m_profiler;
+  };
+
+  GpuProfiler() = default;
+
+  ~GpuProfiler();
+
+  // Returns true if the current context supports timestamp queries; if not, all other methods do nothing.
+  bool isSupported() const;
+
+  // Begin a frame; this opens a root scope containing all other scopes of the frame.
+  void beginFrame();
+
+  // End the frame and collect results from earlier frames that are available.
+  void endFrame();
+
+  // Open a named scope nested in the current scope; 'name' must outlive the profiler (e.g. a string literal).
+  void pushScope(const char* name);
+
+  // Close the current scope.
+  void popScope();
+
+  // Get the scopes of the most recently completed frame in the order they were opened, starting with the root.
+  const std::vector<Result>& results() const { return m_results; }
+
+  // Get the total GPU time of the most recently completed frame, in milliseconds.
+  double frameMilliseconds() const;
+
+  // Show the most recent results as a tree of ImGui widgets in the current window.
+  void drawPanel() const;
+
+  // Delete the OpenGL query objects.
+  void dispose(RenderState& rs);
+
+private:
+  struct Marker {
+    const char* name;
+    uint32_t depth;
+    uint32_t beginQuery;
+    uint32_t endQuery;
+  };
+
+  struct Frame {
+    std::vector<GLuint> queries;
+    std::vector<Marker> markers;
+    uint32_t queryCount = 0;
+    bool pending = false;
+  };
+
+  GLuint nextQuery(Frame& frame);
+
+  void collect(Frame& frame);
+
+  std::array<Frame, FRAMES_IN_FLIGHT> m_frames;
+  std::vector<uint32_t> m_stack;
+  std::vector<Result> m_results;
+  size_t m_frameIndex = 0;
+};
+
+} // namespace stock
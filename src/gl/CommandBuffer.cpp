@@ -0,0 +1,245 @@
+#include "gl/CommandBuffer.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "gl/Error.hpp"
+#include "gl/Mesh.hpp"
+#include "gl/RenderState.hpp"
+#include "gl/ShaderProgram.hpp"
+#include "gl/Texture.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace stock {
+
+void CommandBuffer::pushValues(Type type, GLenum v0, GLenum v1, GLenum v2, GLenum v3) {
+  Command command;
+  command.type = type;
+  command.values[0] = v0;
+  command.values[1] = v1;
+  command.values[2] = v2;
+  command.values[3] = v3;
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::pushUniform(Type type, ShaderProgram& program, const UniformLocation& loc, const float* values,
+                                size_t count) {
+  Command command;
+  command.type = type;
+  command.uniform.program = &program;
+  command.uniform.location = &loc;
+  command.uniform.offset = m_floats.size();
+  m_floats.insert(m_floats.end(), values, values + count);
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::blending(GLboolean enable) {
+  pushValues(Type::BLENDING, enable);
+}
+
+void CommandBuffer::blendEquation(GLenum mode) {
+  pushValues(Type::BLEND_EQUATION, mode);
+}
+
+void CommandBuffer::blendFunc(GLenum sfactor, GLenum dfactor) {
+  pushValues(Type::BLEND_FUNC, sfactor, dfactor);
+}
+
+void CommandBuffer::clearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a) {
+  Command command;
+  command.type = Type::CLEAR_COLOR;
+  command.color[0] = r;
+  command.color[1] = g;
+  command.color[2] = b;
+  command.color[3] = a;
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
+  pushValues(Type::COLOR_MASK, r, g, b, a);
+}
+
+void CommandBuffer::cullFace(GLenum face) {
+  pushValues(Type::CULL_FACE, face);
+}
+
+void CommandBuffer::culling(GLboolean enable) {
+  pushValues(Type::CULLING, enable);
+}
+
+void CommandBuffer::depthTest(GLboolean enable) {
+  pushValues(Type::DEPTH_TEST, enable);
+}
+
+void CommandBuffer::depthFunc(GLenum func) {
+  pushValues(Type::DEPTH_FUNC, func);
+}
+
+void CommandBuffer::depthMask(GLboolean enable) {
+  pushValues(Type::DEPTH_MASK, enable);
+}
+
+void CommandBuffer::frontFace(GLenum face) {
+  pushValues(Type::FRONT_FACE, face);
+}
+
+void CommandBuffer::scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  Command command;
+  command.type = Type::SCISSOR;
+  command.rect = {x, y, width, height};
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::scissorTest(GLboolean enable) {
+  pushValues(Type::SCISSOR_TEST, enable);
+}
+
+void CommandBuffer::clear(GLbitfield mask) {
+  pushValues(Type::CLEAR, mask);
+}
+
+void CommandBuffer::texture(Texture& texture, GLuint unit) {
+  Command command;
+  command.type = Type::TEXTURE;
+  command.texture.texture = &texture;
+  command.texture.unit = unit;
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, int v0) {
+  Command command;
+  command.type = Type::UNIFORM_INT;
+  command.uniform.program = &program;
+  command.uniform.location = &loc;
+  command.uniform.offset = m_ints.size();
+  m_ints.push_back(v0);
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, float v0) {
+  pushUniform(Type::UNIFORM_FLOAT, program, loc, &v0, 1);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, const glm::vec2& v0) {
+  pushUniform(Type::UNIFORM_VEC2, program, loc, glm::value_ptr(v0), 2);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, const glm::vec3& v0) {
+  pushUniform(Type::UNIFORM_VEC3, program, loc, glm::value_ptr(v0), 3);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, const glm::vec4& v0) {
+  pushUniform(Type::UNIFORM_VEC4, program, loc, glm::value_ptr(v0), 4);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, const glm::mat2& v0) {
+  pushUniform(Type::UNIFORM_MAT2, program, loc, glm::value_ptr(v0), 4);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, const glm::mat3& v0) {
+  pushUniform(Type::UNIFORM_MAT3, program, loc, glm::value_ptr(v0), 9);
+}
+
+void CommandBuffer::uniform(ShaderProgram& program, const UniformLocation& loc, const glm::mat4& v0) {
+  pushUniform(Type::UNIFORM_MAT4, program, loc, glm::value_ptr(v0), 16);
+}
+
+void CommandBuffer::draw(MeshBase& mesh, ShaderProgram& program) {
+  Command command;
+  command.type = Type::DRAW;
+  command.draw = {&mesh, &program, 0, 0};
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::draw(MeshBase& mesh, ShaderProgram& program, size_t indexCount, size_t indexOffset) {
+  Command command;
+  command.type = Type::DRAW_RANGE;
+  command.draw = {&mesh, &program, indexCount, indexOffset};
+  m_commands.push_back(command);
+}
+
+void CommandBuffer::execute(RenderState& rs) const {
+
+  STOCK_PROFILE_SCOPE("CommandBuffer::execute");
+
+  for (const auto& command : m_commands) {
+    const auto& v = command.values;
+    switch (command.type) {
+    case Type::BLENDING: rs.blending(v[0]); break;
+    case Type::BLEND_EQUATION: rs.blendEquation(v[0]); break;
+    case Type::BLEND_FUNC: rs.blendFunc(v[0], v[1]); break;
+    case Type::CLEAR_COLOR: rs.clearColor(command.color[0], command.color[1], command.color[2], command.color[3]); break;
+    case Type::COLOR_MASK: rs.colorMask(v[0], v[1], v[2], v[3]); break;
+    case Type::CULL_FACE: rs.cullFace(v[0]); break;
+    case Type::CULLING: rs.culling(v[0]); break;
+    case Type::DEPTH_TEST: rs.depthTest(v[0]); break;
+    case Type::DEPTH_FUNC: rs.depthFunc(v[0]); break;
+    case Type::DEPTH_MASK: rs.depthMask(v[0]); break;
+    case Type::FRONT_FACE: rs.frontFace(v[0]); break;
+    case Type::SCISSOR:
+      rs.scissor(command.rect.x, command.rect.y, command.rect.width, command.rect.height);
+      break;
+    case Type::SCISSOR_TEST: rs.scissorTest(v[0]); break;
+    case Type::CLEAR: CHECK_GL(glClear(v[0])); break;
+    case Type::TEXTURE:
+      command.texture.texture->prepare(rs, command.texture.unit);
+      command.texture.texture->bind(rs, command.texture.unit);
+      break;
+    case Type::UNIFORM_INT: {
+      const auto& u = command.uniform;
+      u.program->setUniformi(rs, *u.location, m_ints[u.offset]);
+      break;
+    }
+    case Type::UNIFORM_FLOAT:
+    case Type::UNIFORM_VEC2:
+    case Type::UNIFORM_VEC3:
+    case Type::UNIFORM_VEC4:
+    case Type::UNIFORM_MAT2:
+    case Type::UNIFORM_MAT3:
+    case Type::UNIFORM_MAT4: {
+      const auto& u = command.uniform;
+      const float* f = &m_floats[u.offset];
+      switch (command.type) {
+      case Type::UNIFORM_FLOAT: u.program->setUniformf(rs, *u.location, f[0]); break;
+      case Type::UNIFORM_VEC2: u.program->setUniformf(rs, *u.location, glm::make_vec2(f)); break;
+      case Type::UNIFORM_VEC3: u.program->setUniformf(rs, *u.location, glm::make_vec3(f)); break;
+      case Type::UNIFORM_VEC4: u.program->setUniformf(rs, *u.location, glm::make_vec4(f)); break;
+      case Type::UNIFORM_MAT2: u.program->setUniformMatrix2f(rs, *u.location, glm::make_mat2(f)); break;
+      case Type::UNIFORM_MAT3: u.program->setUniformMatrix3f(rs, *u.location, glm::make_mat3(f)); break;
+      case Type::UNIFORM_MAT4: u.program->setUniformMatrix4f(rs, *u.location, glm::make_mat4(f)); break;
+      default: break;
+      }
+      break;
+    }
+    case Type::DRAW: command.draw.mesh->draw(rs, *command.draw.program); break;
+    case Type::DRAW_RANGE: {
+      const auto& d = command.draw;
+      auto indexOffset = reinterpret_cast<const void*>(d.indexOffset * sizeof(GLushort));
+      d.mesh->draw(rs, *d.program, d.indexCount, indexOffset);
+      break;
+    }
+    }
+  }
+}
+
+void CommandBuffer::reset() {
+  m_commands.clear();
+  m_floats.clear();
+  m_ints.clear();
+}
+
+void CommandQueue::submit(CommandBuffer&& buffer) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_buffers.push_back(std::move(buffer));
+}
+
+void CommandQueue::execute(RenderState& rs) {
+  // Take the submitted buffers first so that workers can keep submitting while these execute.
+  std::deque<CommandBuffer> buffers;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffers.swap(m_buffers);
+  }
+  for (const auto& buffer : buffers) {
+    buffer.execute(rs);
+  }
+}
+
+} // namespace stock
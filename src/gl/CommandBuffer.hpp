@@ -0,0 +1,167 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include "glm/mat2x2.hpp"
+#include "glm/mat3x3.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace stock {
+
+class MeshBase;
+class RenderState;
+class ShaderProgram;
+class Texture;
+class UniformLocation;
+
+// CommandBuffer records state changes, uniform values, and draws without making any OpenGL calls, so it can be
+// filled on any thread. The recorded commands are later replayed through a RenderState on the thread that owns the
+// GL context. Meshes, programs, textures, and uniform locations are referenced, not copied, so they must outlive
+// the execution of the buffer.
+
+class CommandBuffer {
+
+public:
+  CommandBuffer() = default;
+
+  CommandBuffer(CommandBuffer&&) = default;
+  CommandBuffer& operator=(CommandBuffer&&) = default;
+
+  // Disallow copying by construction and assignment.
+  CommandBuffer(const CommandBuffer&) = delete;
+  CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+  // Record render state changes; these have the same meaning as the RenderState methods of the same names.
+  void blending(GLboolean enable);
+  void blendEquation(GLenum mode);
+  void blendFunc(GLenum sfactor, GLenum dfactor);
+  void clearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a);
+  void colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a);
+  void cullFace(GLenum face);
+  void culling(GLboolean enable);
+  void depthTest(GLboolean enable);
+  void depthFunc(GLenum func);
+  void depthMask(GLboolean enable);
+  void frontFace(GLenum face);
+  void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+  void scissorTest(GLboolean enable);
+
+  // Record a clear of the current framebuffer.
+  void clear(GLbitfield mask);
+
+  // Record binding a texture to a texture unit; the texture is prepared first if needed.
+  void texture(Texture& texture, GLuint unit);
+
+  // Record setting a uniform value on a shader program.
+  void uniform(ShaderProgram& program, const UniformLocation& loc, int v0);
+  void uniform(ShaderProgram& program, const UniformLocation& loc, float v0);
+  void uniform(ShaderProgram& program, const UniformLocation& loc, const glm::vec2& v0);
+  void uniform(ShaderProgram& program, const UniformLocation& loc, const glm::vec3& v0);
+  void uniform(ShaderProgram& program, const UniformLocation& loc, const glm::vec4& v0);
+  void uniform(ShaderProgram& program, const UniformLocation& loc, const glm::mat2& v0);
+  void uniform(ShaderProgram& program, const UniformLocation& loc, const glm::mat3& v0);
+  void uniform(ShaderProgram& program, const UniformLocation& loc, const glm::mat4& v0);
+
+  // Record drawing all of a mesh, or a range of its indices, with a shader program.
+  void draw(MeshBase& mesh, ShaderProgram& program);
+  void draw(MeshBase& mesh, ShaderProgram& program, size_t indexCount, size_t indexOffset);
+
+  // Replay all recorded commands in order; this must be called on the GL thread.
+  void execute(RenderState& rs) const;
+
+  // Remove all recorded commands, keeping the allocated storage.
+  void reset();
+
+  // Get the number of recorded commands.
+  size_t size() const { return m_commands.size(); }
+
+  bool empty() const { return m_commands.empty(); }
+
+private:
+  enum class Type : uint8_t {
+    BLENDING,
+    BLEND_EQUATION,
+    BLEND_FUNC,
+    CLEAR_COLOR,
+    COLOR_MASK,
+    CULL_FACE,
+    CULLING,
+    DEPTH_TEST,
+    DEPTH_FUNC,
+    DEPTH_MASK,
+    FRONT_FACE,
+    SCISSOR,
+    SCISSOR_TEST,
+    CLEAR,
+    TEXTURE,
+    UNIFORM_INT,
+    UNIFORM_FLOAT,
+    UNIFORM_VEC2,
+    UNIFORM_VEC3,
+    UNIFORM_VEC4,
+    UNIFORM_MAT2,
+    UNIFORM_MAT3,
+    UNIFORM_MAT4,
+    DRAW,
+    DRAW_RANGE,
+  };
+
+  struct Command {
+    Type type;
+    union {
+      GLenum values[4];
+      GLclampf color[4];
+      struct {
+        GLint x, y;
+        GLsizei width, height;
+      } rect;
+      struct {
+        Texture* texture;
+        GLuint unit;
+      } texture;
+      struct {
+        ShaderProgram* program;
+        const UniformLocation* location;
+        // Offset of the value in the int or float arrays.
+        size_t offset;
+      } uniform;
+      struct {
+        MeshBase* mesh;
+        ShaderProgram* program;
+        size_t indexCount;
+        size_t indexOffset;
+      } draw;
+    };
+  };
+
+  void pushValues(Type type, GLenum v0, GLenum v1 = 0, GLenum v2 = 0, GLenum v3 = 0);
+  void pushUniform(Type type, ShaderProgram& program, const UniformLocation& loc, const float* values, size_t count);
+
+  std::vector<Command> m_commands;
+  std::vector<float> m_floats;
+  std::vector<int> m_ints;
+};
+
+// CommandQueue collects command buffers submitted from any thread and executes them on the GL thread in the order
+// they were submitted.
+
+class CommandQueue {
+
+public:
+  // Add a command buffer to the end of the queue; this may be called from any thread.
+  void submit(CommandBuffer&& buffer);
+
+  // Execute and remove all command buffers submitted so far; this must be called on the GL thread.
+  void execute(RenderState& rs);
+
+private:
+  std::deque<CommandBuffer> m_buffers;
+  std::mutex m_mutex;
+};
+
+} // namespace stock
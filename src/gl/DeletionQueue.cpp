@@ -0,0 +1,116 @@
+#include "gl/DeletionQueue.hpp"
+#include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
+#include "gl/RenderState.hpp"
+#include <cassert>
+
+namespace stock {
+
+constexpr uint64_t DeletionQueue::FRAME_DELAY;
+
+DeletionQueue::~DeletionQueue() {
+  assert(m_incoming.empty());
+  assert(m_batches.empty());
+}
+
+void DeletionQueue::enqueue(HandleType type, GLuint handle) {
+  if (handle == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_incoming.push_back({type, handle});
+}
+
+void DeletionQueue::endFrame(RenderState& rs) {
+  m_frame++;
+
+  // Handles enqueued so far may be used by any command submitted so far, so they are guarded by a fence placed after
+  // all of those commands.
+  Batch batch;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    batch.entries.swap(m_incoming);
+  }
+  if (!batch.entries.empty()) {
+    if (Extensions::sync) {
+      batch.fence = glFenceSyncAPPLE(GL_SYNC_GPU_COMMANDS_COMPLETE_APPLE, 0);
+      CHECK_GL();
+    }
+    batch.frame = m_frame;
+    m_batches.push_back(std::move(batch));
+  }
+
+  // Batches retire in order, so stop at the first one that the GPU may still be using.
+  while (!m_batches.empty()) {
+    auto& front = m_batches.front();
+    if (front.fence) {
+      GLenum status = glClientWaitSyncAPPLE(front.fence, 0, 0);
+      CHECK_GL();
+      if (status == GL_TIMEOUT_EXPIRED_APPLE) {
+        break;
+      }
+    } else if (m_frame - front.frame < FRAME_DELAY) {
+      break;
+    }
+    deleteBatch(rs, front);
+    m_batches.pop_front();
+  }
+}
+
+void DeletionQueue::dispose(RenderState& rs) {
+  for (auto& batch : m_batches) {
+    deleteBatch(rs, batch);
+  }
+  m_batches.clear();
+  std::vector<Entry> entries;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    entries.swap(m_incoming);
+  }
+  deleteEntries(rs, entries);
+}
+
+void DeletionQueue::deleteBatch(RenderState& rs, Batch& batch) {
+  if (batch.fence) {
+    CHECK_GL(glDeleteSyncAPPLE(batch.fence));
+    batch.fence = nullptr;
+  }
+  deleteEntries(rs, batch.entries);
+  batch.entries.clear();
+}
+
+void DeletionQueue::deleteEntries(RenderState& rs, const std::vector<Entry>& entries) {
+  // Clear any bindings cached by the render state, since the GL may reuse the deleted names.
+  for (const auto& entry : entries) {
+    GLuint handle = entry.handle;
+    switch (entry.type) {
+    case HandleType::BUFFER:
+      rs.vertexBufferUnset(handle);
+      rs.indexBufferUnset(handle);
+      CHECK_GL(glDeleteBuffers(1, &handle));
+      break;
+    case HandleType::FRAMEBUFFER:
+      CHECK_GL(glDeleteFramebuffers(1, &handle));
+      break;
+    case HandleType::PROGRAM:
+      rs.shaderProgramUnset(handle);
+      CHECK_GL(glDeleteProgram(handle));
+      break;
+    case HandleType::QUERY:
+      CHECK_GL(glDeleteQueriesEXT(1, &handle));
+      break;
+    case HandleType::RENDERBUFFER:
+      CHECK_GL(glDeleteRenderbuffers(1, &handle));
+      break;
+    case HandleType::SHADER:
+      CHECK_GL(glDeleteShader(handle));
+      break;
+    case HandleType::TEXTURE:
+      rs.textureUnset(GL_TEXTURE_2D, handle);
+      CHECK_GL(glDeleteTextures(1, &handle));
+      break;
+    }
+  }
+}
+
+} // namespace stock
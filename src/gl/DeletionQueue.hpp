@@ -0,0 +1,70 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace stock {
+
+class RenderState;
+
+// DeletionQueue collects OpenGL objects to delete once the GPU has finished the commands that may use them. Handles
+// can be enqueued from any thread, either directly or with the dispose(DeletionQueue&) method of a resource. The GL
+// thread deletes them in endFrame() after the frame that enqueued them has retired, which is detected with a fence
+// where supported and otherwise assumed after a fixed number of frames.
+
+class DeletionQueue {
+
+public:
+  enum class HandleType : uint8_t {
+    BUFFER,
+    FRAMEBUFFER,
+    PROGRAM,
+    QUERY,
+    RENDERBUFFER,
+    SHADER,
+    TEXTURE,
+  };
+
+  // Number of frames to wait before deleting handles when fences are not supported.
+  static constexpr uint64_t FRAME_DELAY = 3;
+
+  DeletionQueue() = default;
+
+  ~DeletionQueue();
+
+  // Add a handle to delete; this may be called from any thread.
+  void enqueue(HandleType type, GLuint handle);
+
+  // Delete handles from earlier frames that have retired and start tracking the handles enqueued since the last call;
+  // call this on the GL thread once per frame after submitting the frame's commands.
+  void endFrame(RenderState& rs);
+
+  // Delete all enqueued handles immediately, whether or not the GPU is done with them.
+  void dispose(RenderState& rs);
+
+private:
+  struct Entry {
+    HandleType type;
+    GLuint handle;
+  };
+
+  struct Batch {
+    std::vector<Entry> entries;
+    GLsync fence = nullptr;
+    uint64_t frame = 0;
+  };
+
+  void deleteEntries(RenderState& rs, const std::vector<Entry>& entries);
+
+  void deleteBatch(RenderState& rs, Batch& batch);
+
+  std::mutex m_mutex;
+  std::vector<Entry> m_incoming;
+  std::deque<Batch> m_batches;
+  uint64_t m_frame = 0;
+};
+
+} // namespace stock
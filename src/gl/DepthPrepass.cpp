@@ -0,0 +1,77 @@
+#include "gl/DepthPrepass.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "gl/RenderState.hpp"
+#include "gl/ShaderProgram.hpp"
+
+namespace stock {
+
+// Color writes are masked in the depth pass, so the fragment shader only has to exist.
+static const std::string fs_src = R"SHADER_END(
+#ifdef GL_ES
+precision mediump float;
+#endif
+void main() {
+    gl_FragColor = vec4(0.);
+}
+)SHADER_END";
+
+DepthPrepass::DepthPrepass() : DepthPrepass(Options()) {}
+
+DepthPrepass::DepthPrepass(Options options) : m_options(options) {}
+
+DepthPrepass::~DepthPrepass() = default;
+
+void DepthPrepass::render(RenderState& rs, const DrawFunction& draw) {
+  if (!m_isEnabled) {
+    draw(rs, *this);
+    return;
+  }
+
+  {
+    STOCK_PROFILE_SCOPE("Depth Prepass");
+    m_isDepthPass = true;
+    rs.colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    rs.blending(GL_FALSE);
+    rs.depthTest(GL_TRUE);
+    rs.depthMask(GL_TRUE);
+    rs.depthFunc(GL_LESS);
+    draw(rs, *this);
+    m_isDepthPass = false;
+  }
+
+  rs.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  rs.depthMask(GL_FALSE);
+  rs.depthFunc(m_options.shadingDepthFunc);
+  draw(rs, *this);
+
+  rs.depthMask(GL_TRUE);
+  rs.depthFunc(GL_LESS);
+}
+
+ShaderProgram& DepthPrepass::program(ShaderProgram& shader) {
+  return m_isDepthPass ? depthOnlyProgram(shader) : shader;
+}
+
+ShaderProgram& DepthPrepass::depthOnlyProgram(ShaderProgram& shader) {
+  auto& variant = m_variants[shader.getId()];
+  if (!variant) {
+    variant.reset(new ShaderProgram(fs_src, shader.getVertexShaderSource()));
+  }
+  return *variant;
+}
+
+void DepthPrepass::dispose(RenderState& rs) {
+  for (auto& entry : m_variants) {
+    entry.second->dispose(rs);
+  }
+  m_variants.clear();
+}
+
+void DepthPrepass::dispose(DeletionQueue& queue) {
+  for (auto& entry : m_variants) {
+    entry.second->dispose(queue);
+  }
+  m_variants.clear();
+}
+
+} // namespace stock
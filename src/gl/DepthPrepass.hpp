@@ -0,0 +1,69 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+namespace stock {
+
+class DeletionQueue;
+class RenderState;
+class ShaderProgram;
+
+// DepthPrepass draws a scene twice: first into the depth buffer only, then with full shading against that depth with
+// depth writes off. Each pixel is then shaded once for the nearest surface, however much the scene overdraws.
+//
+// The depth pass draws with a variant of each shader program that has the same vertex shader and an empty fragment
+// shader, so the GL only fetches the attributes that the position depends on. Both passes run the same draw function,
+// which picks its shaders with program().
+
+class DepthPrepass {
+
+public:
+  using DrawFunction = std::function<void(RenderState& rs, DepthPrepass& prepass)>;
+
+  struct Options {
+    // Depth function of the shading pass. GL_EQUAL rejects the most fragments but needs both passes to produce
+    // identical depths, which vertex shaders guarantee by declaring 'invariant gl_Position;'.
+    GLenum shadingDepthFunc = GL_LEQUAL;
+  };
+
+  DepthPrepass();
+
+  explicit DepthPrepass(Options options);
+
+  ~DepthPrepass();
+
+  // Run 'draw' for the depth pass and then for the shading pass, or only once with the current state when disabled.
+  // 'draw' shouldn't change the color mask, the depth mask, or the depth function.
+  void render(RenderState& rs, const DrawFunction& draw);
+
+  // Get the program to draw with: the depth-only variant of 'shader' during the depth pass, and otherwise 'shader'.
+  ShaderProgram& program(ShaderProgram& shader);
+
+  // Get the depth-only variant of a program, creating it on first use. Variants are keyed by ShaderProgram::getId()
+  // and kept until dispose().
+  ShaderProgram& depthOnlyProgram(ShaderProgram& shader);
+
+  bool isDepthPass() const { return m_isDepthPass; }
+
+  void setEnabled(bool enabled) { m_isEnabled = enabled; }
+  bool isEnabled() const { return m_isEnabled; }
+
+  void setOptions(const Options& options) { m_options = options; }
+  const Options& options() const { return m_options; }
+
+  void dispose(RenderState& rs);
+
+  // Hand all OpenGL resources to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
+private:
+  Options m_options;
+  std::unordered_map<uint32_t, std::unique_ptr<ShaderProgram>> m_variants;
+  bool m_isEnabled = true;
+  bool m_isDepthPass = false;
+};
+
+} // namespace stock
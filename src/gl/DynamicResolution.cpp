@@ -0,0 +1,159 @@
+#include "gl/DynamicResolution.hpp"
+#include "gl/Error.hpp"
+#include "gl/RenderState.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace stock {
+
+// The scene is drawn into the lower-left corner of the texture, so texture coordinates are scaled to that corner and
+// clamped half a texel inside it to keep linear filtering from reading the unused part.
+static const std::string fs_src = R"SHADER_END(
+#ifdef GL_ES
+precision mediump float;
+#endif
+varying vec2 v_uv;
+uniform sampler2D u_texture;
+uniform vec2 u_uvScale;
+uniform vec2 u_uvMax;
+void main() {
+    gl_FragColor = texture2D(u_texture, min(v_uv * u_uvScale, u_uvMax));
+}
+)SHADER_END";
+static UniformLocation g_textureLocation("u_texture");
+static UniformLocation g_uvScaleLocation("u_uvScale");
+static UniformLocation g_uvMaxLocation("u_uvMax");
+
+DynamicResolution::DynamicResolution() : DynamicResolution(Options()) {}
+
+DynamicResolution::DynamicResolution(Options options)
+    : m_options(options), m_shader(fs_src, FullscreenTriangle::vertexShaderSource()), m_scale(options.maxScale) {}
+
+void DynamicResolution::setOptions(const Options& options) {
+  m_options = options;
+  setScale(m_scale);
+}
+
+void DynamicResolution::setScale(float scale) {
+  m_scale = std::min(std::max(scale, m_options.minScale), m_options.maxScale);
+  m_framesOver = 0;
+  m_framesUnder = 0;
+}
+
+float DynamicResolution::quantize(float scale) const {
+  if (m_options.scaleStep <= 0.f) {
+    return scale;
+  }
+  return std::round(scale / m_options.scaleStep) * m_options.scaleStep;
+}
+
+bool DynamicResolution::update(double gpuMilliseconds) {
+  if (gpuMilliseconds <= 0.) {
+    return false;
+  }
+  if (m_framesToSettle > 0) {
+    m_framesToSettle--;
+    return false;
+  }
+
+  double target = m_options.targetMilliseconds;
+  if (gpuMilliseconds > target * m_options.upperThreshold) {
+    m_framesOver++;
+    m_framesUnder = 0;
+  } else if (gpuMilliseconds < target * m_options.lowerThreshold) {
+    m_framesUnder++;
+    m_framesOver = 0;
+  } else {
+    m_framesOver = 0;
+    m_framesUnder = 0;
+  }
+
+  float scale;
+  if (m_framesOver >= m_options.framesToDecrease) {
+    // GPU time is roughly proportional to the pixel count, which is the square of the scale. Drop straight to the
+    // scale that should land in the middle of the thresholds, and at least one step.
+    double middle = target * (m_options.lowerThreshold + m_options.upperThreshold) * .5;
+    auto estimate = static_cast<float>(m_scale * std::sqrt(middle / gpuMilliseconds));
+    scale = std::min(quantize(estimate), m_scale - m_options.scaleStep);
+  } else if (m_framesUnder >= m_options.framesToIncrease) {
+    // Rise one step at a time, since an overestimate would cost dropped frames.
+    scale = quantize(m_scale + m_options.scaleStep);
+  } else {
+    return false;
+  }
+
+  float previous = m_scale;
+  setScale(scale);
+  if (m_scale == previous) {
+    return false;
+  }
+  m_framesToSettle = m_options.settleFrames;
+  return true;
+}
+
+void DynamicResolution::bind(RenderState& rs, uint32_t windowWidth, uint32_t windowHeight) {
+
+  if (!m_framebuffer || windowWidth != m_windowWidth || windowHeight != m_windowHeight) {
+    if (m_framebuffer && m_deletionQueue) {
+      m_framebuffer->dispose(*m_deletionQueue);
+    } else if (m_framebuffer) {
+      m_framebuffer->dispose(rs);
+    }
+    Framebuffer::Options framebufferOptions;
+    framebufferOptions.hasDepth = m_options.hasDepth;
+    auto width = static_cast<uint32_t>(std::ceil(windowWidth * m_options.maxScale));
+    auto height = static_cast<uint32_t>(std::ceil(windowHeight * m_options.maxScale));
+    m_framebuffer.reset(new Framebuffer(std::max(width, 1u), std::max(height, 1u), framebufferOptions));
+    m_windowWidth = windowWidth;
+    m_windowHeight = windowHeight;
+  }
+
+  m_renderWidth = std::min(std::max(static_cast<uint32_t>(std::lround(windowWidth * m_scale)), 1u),
+                           m_framebuffer->width());
+  m_renderHeight = std::min(std::max(static_cast<uint32_t>(std::lround(windowHeight * m_scale)), 1u),
+                            m_framebuffer->height());
+
+  m_framebuffer->bind(rs, 0);
+  CHECK_GL(glViewport(0, 0, m_renderWidth, m_renderHeight));
+}
+
+void DynamicResolution::present(RenderState& rs) {
+  if (!m_framebuffer) {
+    return;
+  }
+
+  m_framebuffer->unbind(rs);
+  CHECK_GL(glViewport(0, 0, m_windowWidth, m_windowHeight));
+
+  rs.blending(false);
+  rs.culling(false);
+  rs.depthTest(false);
+  rs.scissorTest(false);
+
+  float width = m_framebuffer->width(), height = m_framebuffer->height();
+  m_framebuffer->colorTexture().bind(rs, 0);
+  m_shader.setUniformi(rs, g_textureLocation, 0);
+  m_shader.setUniformf(rs, g_uvScaleLocation, m_renderWidth / width, m_renderHeight / height);
+  m_shader.setUniformf(rs, g_uvMaxLocation, (m_renderWidth - .5f) / width, (m_renderHeight - .5f) / height);
+  m_triangle.draw(rs, m_shader);
+}
+
+void DynamicResolution::dispose(RenderState& rs) {
+  if (m_framebuffer) {
+    m_framebuffer->dispose(rs);
+    m_framebuffer.reset();
+  }
+  m_shader.dispose(rs);
+  m_triangle.dispose(rs);
+}
+
+void DynamicResolution::dispose(DeletionQueue& queue) {
+  if (m_framebuffer) {
+    m_framebuffer->dispose(queue);
+    m_framebuffer.reset();
+  }
+  m_shader.dispose(queue);
+  m_triangle.dispose(queue);
+}
+
+} // namespace stock
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "gl/Framebuffer.hpp"
+#include "gl/FullscreenTriangle.hpp"
+#include "gl/ShaderProgram.hpp"
+#include <memory>
+
+namespace stock {
+
+class DeletionQueue;
+class RenderState;
+
+// DynamicResolution renders a scene at a fraction of the window resolution and upscales it to the window, adjusting
+// the fraction to keep the GPU frame time under a target.
+//
+// The scale moves between a minimum and maximum with hysteresis: it drops after a few frames over budget, and rises
+// one step at a time after many frames well under budget, so that it doesn't oscillate. The Framebuffer is allocated
+// at the maximum scale and the scene is drawn into a corner of it, so changing the scale never reallocates.
+//
+// Draw the scene between bind() and present(); anything drawn after present(), like UI, is at native resolution.
+
+class DynamicResolution {
+
+public:
+  struct Options {
+    // Limits of the fraction of the window width and height that the scene is rendered at.
+    float minScale = .5f;
+    float maxScale = 1.f;
+    // Scale changes are rounded to multiples of this step.
+    float scaleStep = .05f;
+    // GPU frame time to stay under, in milliseconds.
+    double targetMilliseconds = 1000. / 60.;
+    // The scale rises when GPU time is below this fraction of the target, and drops when it is above the upper one.
+    double lowerThreshold = .7;
+    double upperThreshold = .9;
+    // Number of consecutive frames outside of the thresholds needed to change the scale.
+    int framesToDecrease = 3;
+    int framesToIncrease = 60;
+    // Number of frames to ignore after a change, while GPU timings from before the change arrive.
+    int settleFrames = 4;
+    bool hasDepth = true;
+  };
+
+  DynamicResolution();
+
+  explicit DynamicResolution(Options options);
+
+  // Update the scale with the GPU time of a recent frame, e.g. from GpuProfiler::frameMilliseconds(); returns true if
+  // the scale changed. Times of zero or less are ignored.
+  bool update(double gpuMilliseconds);
+
+  // Bind the Framebuffer and set the viewport to the scaled size of a window with the given size in pixels.
+  void bind(RenderState& rs, uint32_t windowWidth, uint32_t windowHeight);
+
+  // Upscale the scene to the whole viewport of the default framebuffer.
+  void present(RenderState& rs);
+
+  void dispose(RenderState& rs);
+
+  // Hand all OpenGL resources to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
+  // Hand the Framebuffer replaced when the window is resized to a deletion queue, so that it is deleted after the GPU
+  // has finished the frames that drew into it; null deletes it right away.
+  void setDeletionQueue(DeletionQueue* queue) { m_deletionQueue = queue; }
+
+  void setOptions(const Options& options);
+  const Options& options() const { return m_options; }
+
+  float scale() const { return m_scale; }
+  void setScale(float scale);
+
+  // Get the size in pixels that the scene was rendered at in the last call to bind().
+  uint32_t renderWidth() const { return m_renderWidth; }
+  uint32_t renderHeight() const { return m_renderHeight; }
+
+private:
+  float quantize(float scale) const;
+
+  Options m_options;
+  std::unique_ptr<Framebuffer> m_framebuffer;
+  DeletionQueue* m_deletionQueue = nullptr;
+  ShaderProgram m_shader;
+  FullscreenTriangle m_triangle;
+  float m_scale = 1.f;
+  int m_framesOver = 0;
+  int m_framesUnder = 0;
+  int m_framesToSettle = 0;
+  uint32_t m_windowWidth = 0;
+  uint32_t m_windowHeight = 0;
+  uint32_t m_renderWidth = 0;
+  uint32_t m_renderHeight = 0;
+};
+
+} // namespace stock
@@ -0,0 +1,193 @@
+#include "gl/Extensions.hpp"
+#include "gl/Error.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+PFNSTOCKGLGENQUERIESPROC stock_glGenQueriesEXT = nullptr;
+PFNSTOCKGLDELETEQUERIESPROC stock_glDeleteQueriesEXT = nullptr;
+PFNSTOCKGLBEGINQUERYPROC stock_glBeginQueryEXT = nullptr;
+PFNSTOCKGLENDQUERYPROC stock_glEndQueryEXT = nullptr;
+PFNSTOCKGLQUERYCOUNTERPROC stock_glQueryCounterEXT = nullptr;
+PFNSTOCKGLGETQUERYIVPROC stock_glGetQueryivEXT = nullptr;
+PFNSTOCKGLGETQUERYOBJECTUIVPROC stock_glGetQueryObjectuivEXT = nullptr;
+PFNSTOCKGLGETQUERYOBJECTUI64VPROC stock_glGetQueryObjectui64vEXT = nullptr;
+PFNSTOCKGLFENCESYNCPROC stock_glFenceSyncAPPLE = nullptr;
+PFNSTOCKGLCLIENTWAITSYNCPROC stock_glClientWaitSyncAPPLE = nullptr;
+PFNSTOCKGLDELETESYNCPROC stock_glDeleteSyncAPPLE = nullptr;
+PFNSTOCKGLRENDERBUFFERSTORAGEMULTISAMPLEPROC stock_glRenderbufferStorageMultisampleEXT = nullptr;
+PFNSTOCKGLFRAMEBUFFERTEXTURE2DMULTISAMPLEPROC stock_glFramebufferTexture2DMultisampleEXT = nullptr;
+PFNSTOCKGLRENDERBUFFERSTORAGEMULTISAMPLEPROC stock_glRenderbufferStorageMultisampleANGLE = nullptr;
+PFNSTOCKGLBLITFRAMEBUFFERPROC stock_glBlitFramebufferANGLE = nullptr;
+PFNSTOCKGLRENDERBUFFERSTORAGEMULTISAMPLEPROC stock_glRenderbufferStorageMultisampleAPPLE = nullptr;
+PFNSTOCKGLRESOLVEMULTISAMPLEFRAMEBUFFERPROC stock_glResolveMultisampleFramebufferAPPLE = nullptr;
+PFNSTOCKGLDISCARDFRAMEBUFFERPROC stock_glDiscardFramebufferEXT = nullptr;
+PFNSTOCKGLMAPBUFFERRANGEPROC stock_glMapBufferRangeEXT = nullptr;
+PFNSTOCKGLUNMAPBUFFERPROC stock_glUnmapBufferOES = nullptr;
+PFNSTOCKGLDRAWARRAYSINSTANCEDPROC stock_glDrawArraysInstancedANGLE = nullptr;
+PFNSTOCKGLDRAWELEMENTSINSTANCEDPROC stock_glDrawElementsInstancedANGLE = nullptr;
+PFNSTOCKGLVERTEXATTRIBDIVISORPROC stock_glVertexAttribDivisorANGLE = nullptr;
+
+namespace stock {
+
+bool Extensions::timerQuery = false;
+bool Extensions::occlusionQuery = false;
+bool Extensions::sync = false;
+bool Extensions::multisampledRenderToTexture = false;
+bool Extensions::framebufferBlit = false;
+bool Extensions::appleFramebufferMultisample = false;
+int Extensions::maxSamples = 0;
+bool Extensions::packedDepthStencil = false;
+bool Extensions::depthTexture = false;
+bool Extensions::discardFramebuffer = false;
+bool Extensions::pixelBufferObject = false;
+bool Extensions::instancedArrays = false;
+bool Extensions::s_isEs = false;
+int Extensions::s_majorVersion = 0;
+
+// Load a function pointer by name; on desktop GL extension entry points are usually exposed with core names, so
+// 'suffix' is only appended for ES contexts.
+template <typename T> static bool loadProc(GLADloadproc loader, T& proc, const char* name, const char* suffix) {
+  char buffer[128];
+  std::snprintf(buffer, sizeof(buffer), "%s%s", name, Extensions::isEs() ? suffix : "");
+  proc = reinterpret_cast<T>(loader(buffer));
+  return proc != nullptr;
+}
+
+bool Extensions::isSupported(const char* extension) {
+  auto extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+  if (extensions == nullptr || extension == nullptr) {
+    return false;
+  }
+  size_t length = std::strlen(extension);
+  for (const char* start = extensions; (start = std::strstr(start, extension)) != nullptr; start += length) {
+    // Match whole names only, so that e.g. "GL_EXT_foo" does not match "GL_EXT_foo_bar".
+    bool startsWord = (start == extensions || start[-1] == ' ');
+    bool endsWord = (start[length] == ' ' || start[length] == '\0');
+    if (startsWord && endsWord) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Extensions::load(GLADloadproc loader) {
+
+  auto version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  CHECK_GL();
+  if (version != nullptr) {
+    static const char* esPrefix = "OpenGL ES";
+    s_isEs = std::strncmp(version, esPrefix, std::strlen(esPrefix)) == 0;
+    const char* number = s_isEs ? std::strpbrk(version, "0123456789") : version;
+    s_majorVersion = number ? std::atoi(number) : 0;
+  }
+
+  // Timer and occlusion queries share their entry points for query objects.
+  bool esTimer = s_isEs && isSupported("GL_EXT_disjoint_timer_query");
+  bool esOcclusion = s_isEs && (isSupported("GL_EXT_occlusion_query_boolean") || s_majorVersion >= 3);
+  bool desktopTimer = !s_isEs && (s_majorVersion >= 4 || isSupported("GL_ARB_timer_query"));
+  bool desktopOcclusion = !s_isEs && (s_majorVersion >= 4 || isSupported("GL_ARB_occlusion_query2"));
+
+  timerQuery = false;
+  occlusionQuery = false;
+  if (esTimer || esOcclusion || desktopTimer || desktopOcclusion) {
+    // ES 3.0 has query objects in core, but the timer query functions are only available from the extension.
+    const char* suffix = (esTimer || isSupported("GL_EXT_occlusion_query_boolean")) ? "EXT" : "";
+    bool queries = loadProc(loader, stock_glGenQueriesEXT, "glGenQueries", suffix) &&
+                   loadProc(loader, stock_glDeleteQueriesEXT, "glDeleteQueries", suffix) &&
+                   loadProc(loader, stock_glBeginQueryEXT, "glBeginQuery", suffix) &&
+                   loadProc(loader, stock_glEndQueryEXT, "glEndQuery", suffix) &&
+                   loadProc(loader, stock_glGetQueryivEXT, "glGetQueryiv", suffix) &&
+                   loadProc(loader, stock_glGetQueryObjectuivEXT, "glGetQueryObjectuiv", suffix);
+    timerQuery = queries && (esTimer || desktopTimer) &&
+                 loadProc(loader, stock_glQueryCounterEXT, "glQueryCounter", suffix) &&
+                 loadProc(loader, stock_glGetQueryObjectui64vEXT, "glGetQueryObjectui64v", suffix);
+    occlusionQuery = queries && (esOcclusion || desktopOcclusion);
+  }
+
+  sync = false;
+  bool appleSync = s_isEs && isSupported("GL_APPLE_sync");
+  bool coreSync = s_isEs ? s_majorVersion >= 3 : (s_majorVersion >= 4 || isSupported("GL_ARB_sync"));
+  if (appleSync || coreSync) {
+    const char* suffix = appleSync ? "APPLE" : "";
+    sync = loadProc(loader, stock_glFenceSyncAPPLE, "glFenceSync", suffix) &&
+           loadProc(loader, stock_glClientWaitSyncAPPLE, "glClientWaitSync", suffix) &&
+           loadProc(loader, stock_glDeleteSyncAPPLE, "glDeleteSync", suffix);
+  }
+
+  multisampledRenderToTexture = s_isEs && isSupported("GL_EXT_multisampled_render_to_texture") &&
+      loadProc(loader, stock_glRenderbufferStorageMultisampleEXT, "glRenderbufferStorageMultisample", "EXT") &&
+      loadProc(loader, stock_glFramebufferTexture2DMultisampleEXT, "glFramebufferTexture2DMultisample", "EXT");
+
+  // Blits are core in ES 3.0 and desktop GL 3.0; ES 2.0 has equivalent ANGLE and NV extensions.
+  const char* blitSuffix = nullptr;
+  if (s_majorVersion >= 3 || (!s_isEs && isSupported("GL_ARB_framebuffer_object"))) {
+    blitSuffix = "";
+  } else if (isSupported("GL_ANGLE_framebuffer_blit") && isSupported("GL_ANGLE_framebuffer_multisample")) {
+    blitSuffix = "ANGLE";
+  } else if (isSupported("GL_NV_framebuffer_blit") && isSupported("GL_NV_framebuffer_multisample")) {
+    blitSuffix = "NV";
+  }
+  framebufferBlit = blitSuffix != nullptr &&
+      loadProc(loader, stock_glRenderbufferStorageMultisampleANGLE, "glRenderbufferStorageMultisample", blitSuffix) &&
+      loadProc(loader, stock_glBlitFramebufferANGLE, "glBlitFramebuffer", blitSuffix);
+
+  appleFramebufferMultisample = s_isEs && isSupported("GL_APPLE_framebuffer_multisample") &&
+      loadProc(loader, stock_glRenderbufferStorageMultisampleAPPLE, "glRenderbufferStorageMultisample", "APPLE") &&
+      loadProc(loader, stock_glResolveMultisampleFramebufferAPPLE, "glResolveMultisampleFramebuffer", "APPLE");
+
+  maxSamples = 0;
+  if (multisampledRenderToTexture || framebufferBlit || appleFramebufferMultisample) {
+    CHECK_GL(glGetIntegerv(GL_MAX_SAMPLES_EXT, &maxSamples));
+  }
+
+  packedDepthStencil = s_majorVersion >= 3 ||
+      (s_isEs ? isSupported("GL_OES_packed_depth_stencil") : isSupported("GL_EXT_packed_depth_stencil"));
+
+  depthTexture = !s_isEs || s_majorVersion >= 3 || isSupported("GL_OES_depth_texture") ||
+      isSupported("GL_ANGLE_depth_texture");
+
+  // The ES 3.0 and ARB functions have the same signature as the extension, so they share an entry point.
+  discardFramebuffer = false;
+  if (s_isEs ? s_majorVersion >= 3 : isSupported("GL_ARB_invalidate_subdata")) {
+    discardFramebuffer = loadProc(loader, stock_glDiscardFramebufferEXT, "glInvalidateFramebuffer", "");
+  } else if (s_isEs && isSupported("GL_EXT_discard_framebuffer")) {
+    discardFramebuffer = loadProc(loader, stock_glDiscardFramebufferEXT, "glDiscardFramebuffer", "EXT");
+  }
+
+  // ES 2.0 can only map buffers for reading with EXT_map_buffer_range, and unmaps them with OES_mapbuffer.
+  pixelBufferObject = false;
+  if (s_majorVersion >= 3 || (!s_isEs && isSupported("GL_ARB_map_buffer_range"))) {
+    pixelBufferObject = loadProc(loader, stock_glMapBufferRangeEXT, "glMapBufferRange", "") &&
+                        loadProc(loader, stock_glUnmapBufferOES, "glUnmapBuffer", "");
+  } else if (s_isEs && isSupported("GL_NV_pixel_buffer_object") && isSupported("GL_EXT_map_buffer_range")) {
+    pixelBufferObject = loadProc(loader, stock_glMapBufferRangeEXT, "glMapBufferRange", "EXT") &&
+                        loadProc(loader, stock_glUnmapBufferOES, "glUnmapBuffer", "OES");
+  }
+
+  const char* instancingSuffix = nullptr;
+  if (s_isEs ? s_majorVersion >= 3 : (s_majorVersion >= 4 || isSupported("GL_ARB_instanced_arrays"))) {
+    instancingSuffix = "";
+  } else if (s_isEs && isSupported("GL_ANGLE_instanced_arrays")) {
+    instancingSuffix = "ANGLE";
+  } else if (s_isEs && isSupported("GL_EXT_instanced_arrays")) {
+    instancingSuffix = "EXT";
+  }
+  instancedArrays = instancingSuffix != nullptr &&
+      loadProc(loader, stock_glDrawArraysInstancedANGLE, "glDrawArraysInstanced", instancingSuffix) &&
+      loadProc(loader, stock_glDrawElementsInstancedANGLE, "glDrawElementsInstanced", instancingSuffix) &&
+      loadProc(loader, stock_glVertexAttribDivisorANGLE, "glVertexAttribDivisor", instancingSuffix);
+
+  Log::df("GL version: %s\n", version ? version : "unknown");
+  Log::df("Timer queries supported: %d\n", timerQuery);
+  Log::df("Occlusion queries supported: %d\n", occlusionQuery);
+  Log::df("Fence sync supported: %d\n", sync);
+  Log::df("Max multisample samples: %d\n", maxSamples);
+  Log::df("Packed depth-stencil supported: %d\n", packedDepthStencil);
+  Log::df("Depth textures supported: %d\n", depthTexture);
+  Log::df("Framebuffer discard supported: %d\n", discardFramebuffer);
+  Log::df("Pixel buffer objects supported: %d\n", pixelBufferObject);
+  Log::df("Instanced arrays supported: %d\n", instancedArrays);
+}
+
+} // namespace stock
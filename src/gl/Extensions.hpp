@@ -0,0 +1,198 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include <cstdint>
+
+// The glad loader in deps/ is generated for core GLES 2.0 only, so entry points and tokens for the extensions we use
+// are declared here. Functions follow the glad convention of a prefixed pointer and a macro with the GL name.
+
+#ifndef APIENTRYP
+#define APIENTRYP APIENTRY*
+#endif
+
+// GL_EXT_disjoint_timer_query
+#define GL_QUERY_COUNTER_BITS_EXT 0x8864
+#define GL_CURRENT_QUERY_EXT 0x8865
+#define GL_QUERY_RESULT_EXT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE_EXT 0x8867
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#define GL_TIMESTAMP_EXT 0x8E28
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+
+// GL_EXT_occlusion_query_boolean
+#define GL_ANY_SAMPLES_PASSED_EXT 0x8C2F
+#define GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT 0x8D6A
+
+// GL_APPLE_sync
+#define GL_SYNC_GPU_COMMANDS_COMPLETE_APPLE 0x9117
+#define GL_ALREADY_SIGNALED_APPLE 0x911A
+#define GL_TIMEOUT_EXPIRED_APPLE 0x911B
+#define GL_CONDITION_SATISFIED_APPLE 0x911C
+#define GL_WAIT_FAILED_APPLE 0x911D
+#define GL_SYNC_FLUSH_COMMANDS_BIT_APPLE 0x00000001
+
+// GL_OES_rgb8_rgba8
+#define GL_RGB8_OES 0x8051
+#define GL_RGBA8_OES 0x8058
+
+// GL_EXT_multisampled_render_to_texture, GL_ANGLE_framebuffer_blit, GL_APPLE_framebuffer_multisample
+#define GL_READ_FRAMEBUFFER_EXT 0x8CA8
+#define GL_DRAW_FRAMEBUFFER_EXT 0x8CA9
+#define GL_MAX_SAMPLES_EXT 0x8D57
+
+// GL_OES_packed_depth_stencil
+#define GL_DEPTH_STENCIL_OES 0x84F9
+#define GL_UNSIGNED_INT_24_8_OES 0x84FA
+#define GL_DEPTH24_STENCIL8_OES 0x88F0
+
+// GL_NV_pixel_buffer_object, GL_EXT_map_buffer_range
+#define GL_PIXEL_PACK_BUFFER_NV 0x88EB
+#define GL_MAP_READ_BIT_EXT 0x0001
+
+// OpenGL ES 3.0 buffer usage
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+
+typedef void(APIENTRYP PFNSTOCKGLGENQUERIESPROC)(GLsizei n, GLuint* ids);
+typedef void(APIENTRYP PFNSTOCKGLDELETEQUERIESPROC)(GLsizei n, const GLuint* ids);
+typedef void(APIENTRYP PFNSTOCKGLBEGINQUERYPROC)(GLenum target, GLuint id);
+typedef void(APIENTRYP PFNSTOCKGLENDQUERYPROC)(GLenum target);
+typedef void(APIENTRYP PFNSTOCKGLQUERYCOUNTERPROC)(GLuint id, GLenum target);
+typedef void(APIENTRYP PFNSTOCKGLGETQUERYIVPROC)(GLenum target, GLenum pname, GLint* params);
+typedef void(APIENTRYP PFNSTOCKGLGETQUERYOBJECTUIVPROC)(GLuint id, GLenum pname, GLuint* params);
+typedef void(APIENTRYP PFNSTOCKGLGETQUERYOBJECTUI64VPROC)(GLuint id, GLenum pname, uint64_t* params);
+typedef GLsync(APIENTRYP PFNSTOCKGLFENCESYNCPROC)(GLenum condition, GLbitfield flags);
+typedef GLenum(APIENTRYP PFNSTOCKGLCLIENTWAITSYNCPROC)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void(APIENTRYP PFNSTOCKGLDELETESYNCPROC)(GLsync sync);
+typedef void(APIENTRYP PFNSTOCKGLRENDERBUFFERSTORAGEMULTISAMPLEPROC)(GLenum target, GLsizei samples,
+                                                                    GLenum internalformat, GLsizei width,
+                                                                    GLsizei height);
+typedef void(APIENTRYP PFNSTOCKGLFRAMEBUFFERTEXTURE2DMULTISAMPLEPROC)(GLenum target, GLenum attachment,
+                                                                     GLenum textarget, GLuint texture, GLint level,
+                                                                     GLsizei samples);
+typedef void(APIENTRYP PFNSTOCKGLBLITFRAMEBUFFERPROC)(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0,
+                                                      GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask,
+                                                      GLenum filter);
+typedef void(APIENTRYP PFNSTOCKGLRESOLVEMULTISAMPLEFRAMEBUFFERPROC)();
+typedef void(APIENTRYP PFNSTOCKGLDISCARDFRAMEBUFFERPROC)(GLenum target, GLsizei numAttachments,
+                                                         const GLenum* attachments);
+typedef void*(APIENTRYP PFNSTOCKGLMAPBUFFERRANGEPROC)(GLenum target, GLintptr offset, GLsizeiptr length,
+                                                      GLbitfield access);
+typedef GLboolean(APIENTRYP PFNSTOCKGLUNMAPBUFFERPROC)(GLenum target);
+typedef void(APIENTRYP PFNSTOCKGLDRAWARRAYSINSTANCEDPROC)(GLenum mode, GLint first, GLsizei count, GLsizei primcount);
+typedef void(APIENTRYP PFNSTOCKGLDRAWELEMENTSINSTANCEDPROC)(GLenum mode, GLsizei count, GLenum type,
+                                                            const void* indices, GLsizei primcount);
+typedef void(APIENTRYP PFNSTOCKGLVERTEXATTRIBDIVISORPROC)(GLuint index, GLuint divisor);
+
+extern PFNSTOCKGLGENQUERIESPROC stock_glGenQueriesEXT;
+extern PFNSTOCKGLDELETEQUERIESPROC stock_glDeleteQueriesEXT;
+extern PFNSTOCKGLBEGINQUERYPROC stock_glBeginQueryEXT;
+extern PFNSTOCKGLENDQUERYPROC stock_glEndQueryEXT;
+extern PFNSTOCKGLQUERYCOUNTERPROC stock_glQueryCounterEXT;
+extern PFNSTOCKGLGETQUERYIVPROC stock_glGetQueryivEXT;
+extern PFNSTOCKGLGETQUERYOBJECTUIVPROC stock_glGetQueryObjectuivEXT;
+extern PFNSTOCKGLGETQUERYOBJECTUI64VPROC stock_glGetQueryObjectui64vEXT;
+extern PFNSTOCKGLFENCESYNCPROC stock_glFenceSyncAPPLE;
+extern PFNSTOCKGLCLIENTWAITSYNCPROC stock_glClientWaitSyncAPPLE;
+extern PFNSTOCKGLDELETESYNCPROC stock_glDeleteSyncAPPLE;
+extern PFNSTOCKGLRENDERBUFFERSTORAGEMULTISAMPLEPROC stock_glRenderbufferStorageMultisampleEXT;
+extern PFNSTOCKGLFRAMEBUFFERTEXTURE2DMULTISAMPLEPROC stock_glFramebufferTexture2DMultisampleEXT;
+extern PFNSTOCKGLRENDERBUFFERSTORAGEMULTISAMPLEPROC stock_glRenderbufferStorageMultisampleANGLE;
+extern PFNSTOCKGLBLITFRAMEBUFFERPROC stock_glBlitFramebufferANGLE;
+extern PFNSTOCKGLRENDERBUFFERSTORAGEMULTISAMPLEPROC stock_glRenderbufferStorageMultisampleAPPLE;
+extern PFNSTOCKGLRESOLVEMULTISAMPLEFRAMEBUFFERPROC stock_glResolveMultisampleFramebufferAPPLE;
+extern PFNSTOCKGLDISCARDFRAMEBUFFERPROC stock_glDiscardFramebufferEXT;
+extern PFNSTOCKGLMAPBUFFERRANGEPROC stock_glMapBufferRangeEXT;
+extern PFNSTOCKGLUNMAPBUFFERPROC stock_glUnmapBufferOES;
+extern PFNSTOCKGLDRAWARRAYSINSTANCEDPROC stock_glDrawArraysInstancedANGLE;
+extern PFNSTOCKGLDRAWELEMENTSINSTANCEDPROC stock_glDrawElementsInstancedANGLE;
+extern PFNSTOCKGLVERTEXATTRIBDIVISORPROC stock_glVertexAttribDivisorANGLE;
+
+#define glGenQueriesEXT stock_glGenQueriesEXT
+#define glDeleteQueriesEXT stock_glDeleteQueriesEXT
+#define glBeginQueryEXT stock_glBeginQueryEXT
+#define glEndQueryEXT stock_glEndQueryEXT
+#define glQueryCounterEXT stock_glQueryCounterEXT
+#define glGetQueryivEXT stock_glGetQueryivEXT
+#define glGetQueryObjectuivEXT stock_glGetQueryObjectuivEXT
+#define glGetQueryObjectui64vEXT stock_glGetQueryObjectui64vEXT
+#define glFenceSyncAPPLE stock_glFenceSyncAPPLE
+#define glClientWaitSyncAPPLE stock_glClientWaitSyncAPPLE
+#define glDeleteSyncAPPLE stock_glDeleteSyncAPPLE
+#define glRenderbufferStorageMultisampleEXT stock_glRenderbufferStorageMultisampleEXT
+#define glFramebufferTexture2DMultisampleEXT stock_glFramebufferTexture2DMultisampleEXT
+#define glRenderbufferStorageMultisampleANGLE stock_glRenderbufferStorageMultisampleANGLE
+#define glBlitFramebufferANGLE stock_glBlitFramebufferANGLE
+#define glRenderbufferStorageMultisampleAPPLE stock_glRenderbufferStorageMultisampleAPPLE
+#define glResolveMultisampleFramebufferAPPLE stock_glResolveMultisampleFramebufferAPPLE
+#define glDiscardFramebufferEXT stock_glDiscardFramebufferEXT
+#define glMapBufferRangeEXT stock_glMapBufferRangeEXT
+#define glUnmapBufferOES stock_glUnmapBufferOES
+#define glDrawArraysInstancedANGLE stock_glDrawArraysInstancedANGLE
+#define glDrawElementsInstancedANGLE stock_glDrawElementsInstancedANGLE
+#define glVertexAttribDivisorANGLE stock_glVertexAttribDivisorANGLE
+
+namespace stock {
+
+class Extensions {
+
+public:
+  // Load entry points for supported extensions from the current context; call this once after loading glad.
+  static void load(GLADloadproc loader);
+
+  // Returns true if the extension string of the current context contains the given extension name.
+  static bool isSupported(const char* extension);
+
+  // Returns true if the current context is an OpenGL ES context.
+  static bool isEs() { return s_isEs; }
+
+  // Get the major version number of the current context.
+  static int majorVersion() { return s_majorVersion; }
+
+  // Timer queries with timestamps, from EXT_disjoint_timer_query or ARB_timer_query.
+  static bool timerQuery;
+
+  // Boolean occlusion queries, from EXT_occlusion_query_boolean, ES 3.0, or ARB_occlusion_query2.
+  static bool occlusionQuery;
+
+  // Fence sync objects, from APPLE_sync, ES 3.0, or ARB_sync.
+  static bool sync;
+
+  // Multisampled rendering with an implicit resolve into a texture, from EXT_multisampled_render_to_texture.
+  static bool multisampledRenderToTexture;
+
+  // Multisampled renderbuffers resolved with a framebuffer blit, from ES 3.0, ANGLE_framebuffer_blit and
+  // ANGLE_framebuffer_multisample, or ARB_framebuffer_object.
+  static bool framebufferBlit;
+
+  // Multisampled renderbuffers resolved with APPLE_framebuffer_multisample.
+  static bool appleFramebufferMultisample;
+
+  // Maximum number of samples for multisampled rendering, or 0 if not supported.
+  static int maxSamples;
+
+  // Combined 24-bit depth and 8-bit stencil buffers, from OES_packed_depth_stencil, ES 3.0, or desktop GL 3.0.
+  static bool packedDepthStencil;
+
+  // Depth textures that can be rendered to and sampled, from OES_depth_texture, ANGLE_depth_texture, or ES 3.0.
+  static bool depthTexture;
+
+  // Discarding framebuffer contents, from EXT_discard_framebuffer or glInvalidateFramebuffer in ES 3.0 and
+  // ARB_invalidate_subdata.
+  static bool discardFramebuffer;
+
+  // Pixel pack buffers that can be mapped for reading, from ES 3.0, NV_pixel_buffer_object with
+  // EXT_map_buffer_range, or ARB_map_buffer_range.
+  static bool pixelBufferObject;
+
+  // Instanced draws with per-instance vertex attributes, from ANGLE_instanced_arrays, EXT_instanced_arrays, ES 3.0, or
+  // ARB_instanced_arrays.
+  static bool instancedArrays;
+
+private:
+  static bool s_isEs;
+  static int s_majorVersion;
+};
+
+} // namespace stock
@@ -2,8 +2,11 @@
 // Created by Matt Blair on 8/11/16.
 //
 #include "gl/Framebuffer.hpp"
+#include "gl/DeletionQueue.hpp"
 #include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
 #include "io/Log.hpp"
+#include <algorithm>
 #include <cassert>
 
 namespace stock {
@@ -16,52 +19,166 @@ Framebuffer::~Framebuffer() {
   assert(m_depthbufferHandle == 0);
   assert(m_stencilbufferHandle == 0);
   assert(m_framebufferHandle == 0);
+  assert(m_multisampleFramebufferHandle == 0);
+  assert(m_multisampleColorbufferHandle == 0);
+}
+
+// Check the status of the bound framebuffer and log any error.
+static bool checkFramebufferStatus() {
+
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  CHECK_GL();
+
+  switch (status) {
+  case GL_FRAMEBUFFER_COMPLETE:
+    return true;
+  case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
+    Log::e("Error creating framebuffer: GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT");
+    break;
+  case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
+    Log::e("Error creating framebuffer: GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT");
+    break;
+  case GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS:
+    Log::e("Error creating framebuffer: GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS");
+    break;
+  case GL_FRAMEBUFFER_UNSUPPORTED:
+    Log::e("Error creating framebuffer: GL_FRAMEBUFFER_UNSUPPORTED");
+    break;
+  default:
+    Log::e("Error creating framebuffer: Unrecognized error.");
+    break;
+  }
+  return false;
+}
+
+// Allocate storage for the bound renderbuffer, multisampled with whichever method the framebuffer uses.
+static void renderbufferStorage(GLenum format, uint32_t samples, uint32_t width, uint32_t height) {
+  if (samples <= 1) {
+    CHECK_GL(glRenderbufferStorage(GL_RENDERBUFFER, format, width, height));
+  } else if (Extensions::multisampledRenderToTexture) {
+    CHECK_GL(glRenderbufferStorageMultisampleEXT(GL_RENDERBUFFER, samples, format, width, height));
+  } else if (Extensions::framebufferBlit) {
+    CHECK_GL(glRenderbufferStorageMultisampleANGLE(GL_RENDERBUFFER, samples, format, width, height));
+  } else {
+    CHECK_GL(glRenderbufferStorageMultisampleAPPLE(GL_RENDERBUFFER, samples, format, width, height));
+  }
 }
 
 void Framebuffer::prepare(RenderState& rs, GLuint unit) {
 
   m_colorTexture.prepare(rs, unit);
 
+  bool useDepthTexture = m_options.hasDepth && m_options.hasDepthTexture;
+  if (useDepthTexture && !Extensions::depthTexture) {
+    Log::w("Depth textures are not supported, using a depth renderbuffer instead");
+    useDepthTexture = false;
+  }
+
+  // Share one buffer for depth and stencil if possible.
+  bool usePackedDepthStencil = m_options.hasDepth && m_options.hasStencil && Extensions::packedDepthStencil;
+
+  // Choose the number of samples.
+  m_samples = 0;
+  if (m_options.samples > 1) {
+    if (useDepthTexture) {
+      Log::w("Multisampled depth textures are not supported, rendering single-sampled instead");
+    } else if (Extensions::maxSamples > 1) {
+      m_samples = std::min(m_options.samples, static_cast<uint32_t>(Extensions::maxSamples));
+    } else {
+      Log::w("Multisampled framebuffers are not supported, rendering single-sampled instead");
+    }
+  }
+
+  // Without an implicit resolve, multisampled rendering goes to separate renderbuffers that are blitted to the
+  // color texture.
+  bool hasResolveBlit = m_samples > 1 && !Extensions::multisampledRenderToTexture;
+
   // Generate framebuffer handle.
   CHECK_GL(glGenFramebuffers(1, &m_framebufferHandle));
 
-  if (m_options.hasDepth) {
+  if (m_options.hasDepth && !useDepthTexture) {
     // Generate depth buffer handle.
     CHECK_GL(glGenRenderbuffers(1, &m_depthbufferHandle));
   }
 
-  if (m_options.hasStencil) {
+  if (m_options.hasStencil && !usePackedDepthStencil) {
     // Generate stencil buffer handle.
     CHECK_GL(glGenRenderbuffers(1, &m_stencilbufferHandle));
   }
 
+  if (useDepthTexture) {
+    // Create depth texture storage, packed with stencil if possible.
+    Texture::Options textureOptions;
+    textureOptions.minFilter = Texture::MinFilter::NEAREST;
+    textureOptions.magFilter = Texture::MagFilter::NEAREST;
+    auto format = usePackedDepthStencil ? PixelFormat::DEPTH_STENCIL : PixelFormat::DEPTH_COMPONENT;
+    auto type = usePackedDepthStencil ? Pixmap::PixelType::UNSIGNED_INT_24_8 : Pixmap::PixelType::UNSIGNED_INT;
+    m_depthTexture = Texture(Pixmap(m_width, m_height, nullptr, format, type), textureOptions);
+    m_depthTexture.prepare(rs, unit);
+  }
+
   // Bind color texture.
   m_colorTexture.bind(rs, unit);
 
-  if (m_options.hasDepth) {
+  if (m_depthbufferHandle != 0) {
     // Create depth buffer storage.
     CHECK_GL(glBindRenderbuffer(GL_RENDERBUFFER, m_depthbufferHandle));
-    CHECK_GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, m_width, m_height));
+    renderbufferStorage(usePackedDepthStencil ? GL_DEPTH24_STENCIL8_OES : GL_DEPTH_COMPONENT16, m_samples, m_width,
+                        m_height);
   }
 
-  if (m_options.hasStencil) {
+  if (m_stencilbufferHandle != 0) {
     // Create stencil buffer storage.
     CHECK_GL(glBindRenderbuffer(GL_RENDERBUFFER, m_stencilbufferHandle));
-    CHECK_GL(glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, m_width, m_height));
+    renderbufferStorage(GL_STENCIL_INDEX8, m_samples, m_width, m_height);
+  }
+
+  if (hasResolveBlit) {
+    // Create multisampled color buffer storage.
+    CHECK_GL(glGenRenderbuffers(1, &m_multisampleColorbufferHandle));
+    CHECK_GL(glBindRenderbuffer(GL_RENDERBUFFER, m_multisampleColorbufferHandle));
+    GLenum format = m_options.format == PixelFormat::RGB ? GL_RGB8_OES : GL_RGBA8_OES;
+    renderbufferStorage(format, m_samples, m_width, m_height);
   }
 
   // Bind the framebuffer.
   CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle));
 
   // Attach the color buffer.
-  CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture.glHandle(), 0));
+  if (m_samples > 1 && Extensions::multisampledRenderToTexture) {
+    CHECK_GL(glFramebufferTexture2DMultisampleEXT(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                                  m_colorTexture.glHandle(), 0, m_samples));
+  } else {
+    CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture.glHandle(), 0));
+  }
 
-  if (m_options.hasDepth) {
-    // Attach the depth buffer.
+  bool isComplete = true;
+
+  if (hasResolveBlit) {
+    // The framebuffer with the color texture is only a blit destination; create the framebuffer rendered to.
+    isComplete = checkFramebufferStatus();
+    CHECK_GL(glGenFramebuffers(1, &m_multisampleFramebufferHandle));
+    CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, m_multisampleFramebufferHandle));
+    CHECK_GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                       m_multisampleColorbufferHandle));
+  }
+
+  if (useDepthTexture) {
+    // Attach the depth texture, which also holds stencil if packed.
+    GLuint handle = m_depthTexture.glHandle();
+    CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, handle, 0));
+    if (usePackedDepthStencil) {
+      CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_TEXTURE_2D, handle, 0));
+    }
+  } else if (m_options.hasDepth) {
+    // Attach the depth buffer, which also holds stencil if packed.
     CHECK_GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthbufferHandle));
+    if (usePackedDepthStencil) {
+      CHECK_GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthbufferHandle));
+    }
   }
 
-  if (m_options.hasStencil) {
+  if (m_stencilbufferHandle != 0) {
     // Attach the stencil buffer.
     CHECK_GL(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_stencilbufferHandle));
   }
@@ -70,34 +187,14 @@ void Framebuffer::prepare(RenderState& rs, GLuint unit) {
   CHECK_GL(glBindRenderbuffer(GL_RENDERBUFFER, 0));
 
   // Check framebuffer status.
-  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  CHECK_GL();
+  isComplete = checkFramebufferStatus() && isComplete;
 
   // Bind the default framebuffer object.
   CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
-  // Check status and dispose on failure.
-  if (status != GL_FRAMEBUFFER_COMPLETE) {
-
+  // Dispose on failure.
+  if (!isComplete) {
     dispose(rs);
-
-    switch (status) {
-    case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
-      Log::e("Error creating framebuffer: GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT");
-      break;
-    case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
-      Log::e("Error creating framebuffer: GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT");
-      break;
-    case GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS:
-      Log::e("Error creating framebuffer: GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS");
-      break;
-    case GL_FRAMEBUFFER_UNSUPPORTED:
-      Log::e("Error creating framebuffer: GL_FRAMEBUFFER_UNSUPPORTED");
-      break;
-    default:
-      Log::e("Error creating framebuffer: Unrecognized error.");
-      break;
-    }
   }
 }
 
@@ -107,23 +204,77 @@ void Framebuffer::bind(RenderState& rs, GLuint unit) {
     prepare(rs, unit);
   }
 
-  CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle));
+  GLuint handle = m_multisampleFramebufferHandle != 0 ? m_multisampleFramebufferHandle : m_framebufferHandle;
+  CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, handle));
 }
 
 void Framebuffer::unbind(RenderState& rs) {
   CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 }
 
+void Framebuffer::resolve(RenderState& rs) {
+
+  if (m_multisampleFramebufferHandle == 0) {
+    return;
+  }
+
+  CHECK_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER_EXT, m_multisampleFramebufferHandle));
+  CHECK_GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER_EXT, m_framebufferHandle));
+
+  if (Extensions::framebufferBlit) {
+    GLint width = static_cast<GLint>(m_width), height = static_cast<GLint>(m_height);
+    CHECK_GL(glBlitFramebufferANGLE(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+  } else {
+    CHECK_GL(glResolveMultisampleFramebufferAPPLE());
+  }
+
+  // Nothing reads the multisampled buffers after resolving.
+  discard(rs, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+  CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+void Framebuffer::discard(RenderState&, GLbitfield mask) {
+
+  if (!Extensions::discardFramebuffer || m_framebufferHandle == 0) {
+    return;
+  }
+
+  GLenum attachments[3];
+  GLsizei count = 0;
+  if (mask & GL_COLOR_BUFFER_BIT) {
+    attachments[count++] = GL_COLOR_ATTACHMENT0;
+  }
+  if ((mask & GL_DEPTH_BUFFER_BIT) && m_options.hasDepth) {
+    attachments[count++] = GL_DEPTH_ATTACHMENT;
+  }
+  if ((mask & GL_STENCIL_BUFFER_BIT) && m_options.hasStencil) {
+    attachments[count++] = GL_STENCIL_ATTACHMENT;
+  }
+  if (count == 0) {
+    return;
+  }
+
+  // Discard from the framebuffer that is rendered to, so the color texture keeps any resolved contents.
+  GLuint handle = m_multisampleFramebufferHandle != 0 ? m_multisampleFramebufferHandle : m_framebufferHandle;
+  CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, handle));
+  CHECK_GL(glDiscardFramebufferEXT(GL_FRAMEBUFFER, count, attachments));
+}
+
 void Framebuffer::dispose(RenderState& rs) {
 
   m_colorTexture.dispose(rs);
 
-  if (m_options.hasDepth && m_depthbufferHandle != 0) {
+  if (m_depthTexture.glHandle() != 0) {
+    m_depthTexture.dispose(rs);
+  }
+
+  if (m_depthbufferHandle != 0) {
     CHECK_GL(glDeleteRenderbuffers(1, &m_depthbufferHandle));
     m_depthbufferHandle = 0;
   }
 
-  if (m_options.hasStencil && m_stencilbufferHandle != 0) {
+  if (m_stencilbufferHandle != 0) {
     CHECK_GL(glDeleteRenderbuffers(1, &m_stencilbufferHandle));
     m_stencilbufferHandle = 0;
   }
@@ -132,10 +283,54 @@ void Framebuffer::dispose(RenderState& rs) {
     CHECK_GL(glDeleteFramebuffers(1, &m_framebufferHandle));
     m_framebufferHandle = 0;
   }
+
+  if (m_multisampleColorbufferHandle != 0) {
+    CHECK_GL(glDeleteRenderbuffers(1, &m_multisampleColorbufferHandle));
+    m_multisampleColorbufferHandle = 0;
+  }
+
+  if (m_multisampleFramebufferHandle != 0) {
+    CHECK_GL(glDeleteFramebuffers(1, &m_multisampleFramebufferHandle));
+    m_multisampleFramebufferHandle = 0;
+  }
+}
+
+void Framebuffer::dispose(DeletionQueue& queue) {
+
+  m_colorTexture.dispose(queue);
+  m_depthTexture.dispose(queue);
+
+  queue.enqueue(DeletionQueue::HandleType::RENDERBUFFER, m_depthbufferHandle);
+  queue.enqueue(DeletionQueue::HandleType::RENDERBUFFER, m_stencilbufferHandle);
+  queue.enqueue(DeletionQueue::HandleType::FRAMEBUFFER, m_framebufferHandle);
+  queue.enqueue(DeletionQueue::HandleType::RENDERBUFFER, m_multisampleColorbufferHandle);
+  queue.enqueue(DeletionQueue::HandleType::FRAMEBUFFER, m_multisampleFramebufferHandle);
+  m_depthbufferHandle = 0;
+  m_stencilbufferHandle = 0;
+  m_framebufferHandle = 0;
+  m_multisampleColorbufferHandle = 0;
+  m_multisampleFramebufferHandle = 0;
+}
+
+ReadbackQueue::Ticket Framebuffer::readPixels(RenderState& rs, ReadbackQueue& queue, ReadbackQueue::Callback callback) {
+
+  if (m_framebufferHandle == 0) {
+    prepare(rs, 0);
+  }
+
+  // Read from the framebuffer with the color texture, which holds the resolved pixels.
+  CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferHandle));
+  auto ticket = queue.read(0, 0, m_width, m_height, std::move(callback));
+  CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  return ticket;
 }
 
 Texture& Framebuffer::colorTexture() {
   return m_colorTexture;
 }
 
+Texture& Framebuffer::depthTexture() {
+  return m_depthTexture;
+}
+
 } // namespace stock
@@ -3,10 +3,12 @@
 //
 #pragma once
 
+#include "gl/ReadbackQueue.hpp"
 #include "gl/Texture.hpp"
 
 namespace stock {
 
+class DeletionQueue;
 class RenderState;
 
 class Framebuffer {
@@ -18,6 +20,10 @@ public:
     PixelFormat format = PixelFormat::RGBA;
     bool hasDepth = false;
     bool hasStencil = false;
+    // Render depth into a texture that can be sampled by later passes; requires hasDepth.
+    bool hasDepthTexture = false;
+    // Number of samples per pixel; values above 1 render multisampled and are clamped to the supported maximum.
+    uint32_t samples = 0;
   };
 
   Framebuffer(uint32_t width, uint32_t height, Options options);
@@ -30,16 +36,49 @@ public:
 
   void unbind(RenderState& rs);
 
+  // Resolve multisampled rendering into the color texture and bind the default framebuffer. This does nothing for
+  // single-sampled framebuffers or when the GL resolves into the texture implicitly.
+  void resolve(RenderState& rs);
+
+  // Tell the GL that the contents of some buffers are no longer needed, so it can skip storing them. 'mask' combines
+  // GL_COLOR_BUFFER_BIT, GL_DEPTH_BUFFER_BIT, and GL_STENCIL_BUFFER_BIT as for glClear. This leaves the Framebuffer
+  // bound and does nothing if discarding isn't supported.
+  void discard(RenderState& rs, GLbitfield mask);
+
+  // Start reading the color texture back through a readback queue, which delivers the pixels a few frames later
+  // without stalling. Multisampled rendering must be resolved first. This binds the default framebuffer.
+  ReadbackQueue::Ticket readPixels(RenderState& rs, ReadbackQueue& queue, ReadbackQueue::Callback callback = nullptr);
+
   void dispose(RenderState& rs);
 
+  // Hand all OpenGL resources for this Framebuffer to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
   Texture& colorTexture();
 
+  // Get the depth texture; it has no GL handle unless the hasDepthTexture option is set and supported.
+  Texture& depthTexture();
+
+  uint32_t width() const { return m_width; }
+  uint32_t height() const { return m_height; }
+
+  const Options& options() const { return m_options; }
+
+  // Get the number of samples used for rendering, which may be less than requested; valid after prepare().
+  uint32_t samples() const { return m_samples; }
+
 private:
 
   Texture m_colorTexture;
+  Texture m_depthTexture;
   GLuint m_framebufferHandle = 0;
   GLuint m_depthbufferHandle = 0;
+  // The stencil buffer is shared with the depth buffer or texture when packed depth-stencil is supported.
   GLuint m_stencilbufferHandle = 0;
+  // Separate multisampled framebuffer and color buffer, used when resolving with a blit.
+  GLuint m_multisampleFramebufferHandle = 0;
+  GLuint m_multisampleColorbufferHandle = 0;
+  uint32_t m_samples = 0;
   uint32_t m_width = 0;
   uint32_t m_height = 0;
   Options m_options;
@@ -0,0 +1,42 @@
+#include "gl/FullscreenTriangle.hpp"
+#include "gl/ShaderProgram.hpp"
+#include "gl/VertexLayout.hpp"
+
+namespace stock {
+
+const char* FullscreenTriangle::vertexShaderSource() {
+  return R"SHADER_END(
+attribute vec2 a_position;
+varying vec2 v_uv;
+void main() {
+    v_uv = a_position * .5 + .5;
+    gl_Position = vec4(a_position, 0., 1.);
+}
+)SHADER_END";
+}
+
+FullscreenTriangle::FullscreenTriangle() {
+  m_mesh.setVertexLayout(VertexLayout({VertexAttribute("a_position", 2, GL_FLOAT, GL_FALSE)}));
+}
+
+void FullscreenTriangle::draw(RenderState& rs, ShaderProgram& shader) {
+  if (!m_isUploaded) {
+    // The corners outside of clip space are clipped away, leaving exactly the viewport.
+    static const float vertices[] = {-1.f, -1.f, 3.f, -1.f, -1.f, 3.f};
+    m_mesh.uploadVertices(rs, vertices, 3, GL_STATIC_DRAW);
+    m_isUploaded = true;
+  }
+  m_mesh.draw(rs, shader);
+}
+
+void FullscreenTriangle::dispose(RenderState& rs) {
+  m_mesh.dispose(rs);
+  m_isUploaded = false;
+}
+
+void FullscreenTriangle::dispose(DeletionQueue& queue) {
+  m_mesh.dispose(queue);
+  m_isUploaded = false;
+}
+
+} // namespace stock
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "gl/Mesh.hpp"
+
+namespace stock {
+
+class DeletionQueue;
+class RenderState;
+class ShaderProgram;
+
+// FullscreenTriangle draws a single triangle that covers the whole viewport, for compositing textures and for
+// full-screen shader passes. One triangle avoids the seam of a two-triangle quad and shades each pixel once.
+
+class FullscreenTriangle {
+
+public:
+  // Source of a vertex shader that passes texture coordinates from (0, 0) at the bottom-left of the viewport to (1, 1)
+  // at the top-right in 'v_uv'; fragment shaders drawn with this triangle can use it.
+  static const char* vertexShaderSource();
+
+  FullscreenTriangle();
+
+  // Draw the triangle with the given shader and the current render state.
+  void draw(RenderState& rs, ShaderProgram& shader);
+
+  void dispose(RenderState& rs);
+
+  // Hand all OpenGL resources to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
+private:
+  MeshBase m_mesh;
+  bool m_isUploaded = false;
+};
+
+} // namespace stock
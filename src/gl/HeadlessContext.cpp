@@ -0,0 +1,285 @@
+#define GLFW_INCLUDE_NONE
+#include "gl/HeadlessContext.hpp"
+#include "io/Log.hpp"
+#include <GLFW/glfw3.h>
+#include <cassert>
+#include <cstring>
+
+#if defined(__linux__)
+#define STOCK_HEADLESS_EGL
+#include <dlfcn.h>
+#endif
+
+namespace stock {
+
+#ifdef STOCK_HEADLESS_EGL
+
+// EGL headers aren't part of deps/, so the few types and tokens used here are declared directly.
+using EGLint = int32_t;
+using EGLBoolean = unsigned int;
+using EGLenum = unsigned int;
+using EGLDisplay = void*;
+using EGLConfig = void*;
+using EGLContext = void*;
+using EGLSurface = void*;
+
+static const EGLint EGL_ALPHA_SIZE = 0x3021;
+static const EGLint EGL_BLUE_SIZE = 0x3022;
+static const EGLint EGL_GREEN_SIZE = 0x3023;
+static const EGLint EGL_RED_SIZE = 0x3024;
+static const EGLint EGL_DEPTH_SIZE = 0x3025;
+static const EGLint EGL_STENCIL_SIZE = 0x3026;
+static const EGLint EGL_SURFACE_TYPE = 0x3033;
+static const EGLint EGL_NONE = 0x3038;
+static const EGLint EGL_RENDERABLE_TYPE = 0x3040;
+static const EGLint EGL_EXTENSIONS = 0x3055;
+static const EGLint EGL_HEIGHT = 0x3056;
+static const EGLint EGL_WIDTH = 0x3057;
+static const EGLint EGL_CONTEXT_CLIENT_VERSION = 0x3098;
+static const EGLenum EGL_OPENGL_ES_API = 0x30A0;
+static const EGLenum EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+static const EGLint EGL_PBUFFER_BIT = 0x0001;
+static const EGLint EGL_OPENGL_ES2_BIT = 0x0004;
+
+using PFNEGLGETPROCADDRESSPROC = void* (*)(const char* name);
+using PFNEGLQUERYSTRINGPROC = const char* (*)(EGLDisplay display, EGLint name);
+using PFNEGLGETDISPLAYPROC = EGLDisplay (*)(void* nativeDisplay);
+using PFNEGLGETPLATFORMDISPLAYEXTPROC = EGLDisplay (*)(EGLenum platform, void* nativeDisplay, const EGLint* attribs);
+using PFNEGLINITIALIZEPROC = EGLBoolean (*)(EGLDisplay display, EGLint* major, EGLint* minor);
+using PFNEGLTERMINATEPROC = EGLBoolean (*)(EGLDisplay display);
+using PFNEGLBINDAPIPROC = EGLBoolean (*)(EGLenum api);
+using PFNEGLCHOOSECONFIGPROC = EGLBoolean (*)(EGLDisplay display, const EGLint* attribs, EGLConfig* configs,
+                                              EGLint size, EGLint* count);
+using PFNEGLCREATECONTEXTPROC = EGLContext (*)(EGLDisplay display, EGLConfig config, EGLContext share,
+                                               const EGLint* attribs);
+using PFNEGLDESTROYCONTEXTPROC = EGLBoolean (*)(EGLDisplay display, EGLContext context);
+using PFNEGLCREATEPBUFFERSURFACEPROC = EGLSurface (*)(EGLDisplay display, EGLConfig config, const EGLint* attribs);
+using PFNEGLDESTROYSURFACEPROC = EGLBoolean (*)(EGLDisplay display, EGLSurface surface);
+using PFNEGLMAKECURRENTPROC = EGLBoolean (*)(EGLDisplay display, EGLSurface draw, EGLSurface read,
+                                             EGLContext context);
+
+// The libraries and entry points are shared by all contexts, since glad needs a plain function as its loader.
+static void* s_eglLibrary = nullptr;
+static void* s_glesLibrary = nullptr;
+static PFNEGLGETPROCADDRESSPROC s_eglGetProcAddress = nullptr;
+static PFNEGLQUERYSTRINGPROC s_eglQueryString = nullptr;
+static PFNEGLGETDISPLAYPROC s_eglGetDisplay = nullptr;
+static PFNEGLINITIALIZEPROC s_eglInitialize = nullptr;
+static PFNEGLTERMINATEPROC s_eglTerminate = nullptr;
+static PFNEGLBINDAPIPROC s_eglBindAPI = nullptr;
+static PFNEGLCHOOSECONFIGPROC s_eglChooseConfig = nullptr;
+static PFNEGLCREATECONTEXTPROC s_eglCreateContext = nullptr;
+static PFNEGLDESTROYCONTEXTPROC s_eglDestroyContext = nullptr;
+static PFNEGLCREATEPBUFFERSURFACEPROC s_eglCreatePbufferSurface = nullptr;
+static PFNEGLDESTROYSURFACEPROC s_eglDestroySurface = nullptr;
+static PFNEGLMAKECURRENTPROC s_eglMakeCurrent = nullptr;
+
+template <typename T> static bool loadEglProc(T& proc, const char* name) {
+  proc = reinterpret_cast<T>(dlsym(s_eglLibrary, name));
+  return proc != nullptr;
+}
+
+static bool loadEgl() {
+  if (s_eglLibrary != nullptr) {
+    return true;
+  }
+  s_eglLibrary = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+  if (s_eglLibrary == nullptr) {
+    return false;
+  }
+  bool loaded = loadEglProc(s_eglGetProcAddress, "eglGetProcAddress") &&
+                loadEglProc(s_eglQueryString, "eglQueryString") && loadEglProc(s_eglGetDisplay, "eglGetDisplay") &&
+                loadEglProc(s_eglInitialize, "eglInitialize") && loadEglProc(s_eglTerminate, "eglTerminate") &&
+                loadEglProc(s_eglBindAPI, "eglBindAPI") && loadEglProc(s_eglChooseConfig, "eglChooseConfig") &&
+                loadEglProc(s_eglCreateContext, "eglCreateContext") &&
+                loadEglProc(s_eglDestroyContext, "eglDestroyContext") &&
+                loadEglProc(s_eglCreatePbufferSurface, "eglCreatePbufferSurface") &&
+                loadEglProc(s_eglDestroySurface, "eglDestroySurface") &&
+                loadEglProc(s_eglMakeCurrent, "eglMakeCurrent");
+  if (!loaded) {
+    dlclose(s_eglLibrary);
+    s_eglLibrary = nullptr;
+    return false;
+  }
+  // Older EGL implementations only return extension functions from eglGetProcAddress.
+  s_glesLibrary = dlopen("libGLESv2.so.2", RTLD_NOW | RTLD_LOCAL);
+  return true;
+}
+
+static bool hasEglExtension(const char* extensions, const char* extension) {
+  if (extensions == nullptr) {
+    return false;
+  }
+  size_t length = std::strlen(extension);
+  for (const char* start = extensions; (start = std::strstr(start, extension)) != nullptr; start += length) {
+    bool startsWord = (start == extensions || start[-1] == ' ');
+    bool endsWord = (start[length] == ' ' || start[length] == '\0');
+    if (startsWord && endsWord) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void* getEglProcAddress(const char* name) {
+  void* proc = s_glesLibrary ? dlsym(s_glesLibrary, name) : nullptr;
+  return proc ? proc : s_eglGetProcAddress(name);
+}
+
+#endif // STOCK_HEADLESS_EGL
+
+HeadlessContext::~HeadlessContext() {
+  assert(m_backend == Backend::NONE);
+}
+
+bool HeadlessContext::create() {
+  if (createEgl() || createGlfw()) {
+    return true;
+  }
+  Log::e("Unable to create a headless OpenGL context");
+  return false;
+}
+
+GLADloadproc HeadlessContext::loader() const {
+  switch (m_backend) {
+#ifdef STOCK_HEADLESS_EGL
+  case Backend::EGL_SURFACELESS:
+  case Backend::EGL_PBUFFER:
+    return getEglProcAddress;
+#endif
+  case Backend::GLFW:
+    return (GLADloadproc)glfwGetProcAddress;
+  default:
+    return nullptr;
+  }
+}
+
+void HeadlessContext::dispose() {
+#ifdef STOCK_HEADLESS_EGL
+  if (m_display != nullptr) {
+    s_eglMakeCurrent(m_display, nullptr, nullptr, nullptr);
+    if (m_surface != nullptr) {
+      s_eglDestroySurface(m_display, m_surface);
+    }
+    if (m_context != nullptr) {
+      s_eglDestroyContext(m_display, m_context);
+    }
+    s_eglTerminate(m_display);
+  }
+#endif
+  m_display = nullptr;
+  m_context = nullptr;
+  m_surface = nullptr;
+  if (m_window != nullptr) {
+    glfwDestroyWindow(m_window);
+    glfwTerminate();
+    m_window = nullptr;
+  }
+  m_backend = Backend::NONE;
+}
+
+bool HeadlessContext::createEgl() {
+#ifdef STOCK_HEADLESS_EGL
+  if (!loadEgl()) {
+    Log::w("EGL is not available for headless rendering");
+    return false;
+  }
+
+  // Prefer Mesa's surfaceless platform, which needs no window system at all.
+  const char* clientExtensions = s_eglQueryString(nullptr, EGL_EXTENSIONS);
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = nullptr;
+  if (hasEglExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+    getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        s_eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  }
+  EGLDisplay display = nullptr;
+  if (getPlatformDisplay != nullptr) {
+    display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+    if (display != nullptr && !s_eglInitialize(display, nullptr, nullptr)) {
+      Log::w("Unable to initialize the surfaceless EGL display, trying the default display");
+      display = nullptr;
+    }
+  }
+  if (display == nullptr) {
+    display = s_eglGetDisplay(nullptr);
+    if (display == nullptr || !s_eglInitialize(display, nullptr, nullptr)) {
+      Log::w("Unable to initialize an EGL display");
+      return false;
+    }
+  }
+  m_display = display;
+
+  // Without a surface, a pbuffer is needed only if the context can't be made current on its own.
+  bool surfaceless = hasEglExtension(s_eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+  const EGLint configAttribs[] = {
+      EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+      EGL_RED_SIZE, 8,
+      EGL_GREEN_SIZE, 8,
+      EGL_BLUE_SIZE, 8,
+      EGL_ALPHA_SIZE, 8,
+      EGL_DEPTH_SIZE, 16,
+      EGL_STENCIL_SIZE, 8,
+      EGL_NONE,
+  };
+  EGLConfig config = nullptr;
+  EGLint configCount = 0;
+  if (!s_eglBindAPI(EGL_OPENGL_ES_API) || !s_eglChooseConfig(display, configAttribs, &config, 1, &configCount) ||
+      configCount == 0) {
+    Log::w("No suitable EGL config for headless rendering");
+    dispose();
+    return false;
+  }
+
+  const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+  m_context = s_eglCreateContext(display, config, nullptr, contextAttribs);
+  if (m_context == nullptr) {
+    Log::w("Unable to create an EGL context");
+    dispose();
+    return false;
+  }
+
+  if (!surfaceless) {
+    // Rendering goes to Framebuffers, so the pbuffer only has to exist.
+    const EGLint surfaceAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    m_surface = s_eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if (m_surface == nullptr) {
+      Log::w("Unable to create an EGL pbuffer surface");
+      dispose();
+      return false;
+    }
+  }
+
+  if (!s_eglMakeCurrent(display, m_surface, m_surface, m_context)) {
+    Log::w("Unable to make the EGL context current");
+    dispose();
+    return false;
+  }
+
+  m_backend = surfaceless ? Backend::EGL_SURFACELESS : Backend::EGL_PBUFFER;
+  Log::df("Created headless EGL context, surfaceless: %d\n", surfaceless);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool HeadlessContext::createGlfw() {
+  if (!glfwInit()) {
+    return false;
+  }
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  m_window = glfwCreateWindow(1, 1, "Headless", nullptr, nullptr);
+  glfwDefaultWindowHints();
+  if (m_window == nullptr) {
+    glfwTerminate();
+    return false;
+  }
+  glfwMakeContextCurrent(m_window);
+  m_backend = Backend::GLFW;
+  Log::d("Created headless context with an invisible GLFW window");
+  return true;
+}
+
+} // namespace stock
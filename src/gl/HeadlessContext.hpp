@@ -0,0 +1,53 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include <cstdint>
+
+struct GLFWwindow;
+
+namespace stock {
+
+// HeadlessContext creates an OpenGL ES context without a display, for rendering into Framebuffers in batch jobs.
+// It first tries EGL, loaded at runtime so that no EGL library is needed to build or to run with a window. EGL uses
+// Mesa's surfaceless platform where available, which runs on llvmpipe with no X server. Without EGL it falls back to
+// an invisible GLFW window, which does need a display.
+
+class HeadlessContext {
+
+public:
+  enum class Backend : uint8_t {
+    NONE,
+    EGL_SURFACELESS,
+    EGL_PBUFFER,
+    GLFW,
+  };
+
+  HeadlessContext() = default;
+
+  ~HeadlessContext();
+
+  // Create a context and make it current on this thread; returns false if no backend could create one.
+  bool create();
+
+  // Get the backend that created the context.
+  Backend backend() const { return m_backend; }
+
+  // Get a function loader for gladLoadGLES2Loader() and Extensions::load(); valid while the context exists.
+  GLADloadproc loader() const;
+
+  // Destroy the context.
+  void dispose();
+
+private:
+  bool createEgl();
+
+  bool createGlfw();
+
+  void* m_display = nullptr;
+  void* m_context = nullptr;
+  void* m_surface = nullptr;
+  GLFWwindow* m_window = nullptr;
+  Backend m_backend = Backend::NONE;
+};
+
+} // namespace stock
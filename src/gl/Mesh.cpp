@@ -1,10 +1,14 @@
 //
 // Created by Matt Blair on 5/26/16.
 //
+#include "debug/CpuProfiler.hpp"
+#include "gl/DeletionQueue.hpp"
 #include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
 #include "gl/Mesh.hpp"
 #include "gl/RenderState.hpp"
 #include "gl/ShaderProgram.hpp"
+#include <algorithm>
 #include <cassert>
 
 #define MAX_INDEX_VALUE 65535 // Maximum value of GLushort
@@ -33,6 +37,17 @@ void MeshBase::dispose(RenderState& rs) {
     CHECK_GL(glDeleteBuffers(1, &m_glIndexBuffer));
     m_glIndexBuffer = 0;
   }
+  m_vertexBufferSize = 0;
+  m_indexBufferSize = 0;
+}
+
+void MeshBase::dispose(DeletionQueue& queue) {
+  queue.enqueue(DeletionQueue::HandleType::BUFFER, m_glVertexBuffer);
+  queue.enqueue(DeletionQueue::HandleType::BUFFER, m_glIndexBuffer);
+  m_glVertexBuffer = 0;
+  m_glIndexBuffer = 0;
+  m_vertexBufferSize = 0;
+  m_indexBufferSize = 0;
 }
 
 void MeshBase::setVertexLayout(VertexLayout layout) {
@@ -45,6 +60,8 @@ void MeshBase::setDrawMode(GLenum drawMode) {
 
 void MeshBase::upload(RenderState& rs, GLenum hint) {
 
+  STOCK_PROFILE_SCOPE("Mesh::upload");
+
   if (m_glVertexData && m_vertexCount > 0) {
 
     // Generate vertex buffer, if needed.
@@ -56,6 +73,7 @@ void MeshBase::upload(RenderState& rs, GLenum hint) {
     rs.vertexBuffer(m_glVertexBuffer);
     size_t vertexBytes = m_vertexCount * m_vertexLayout.stride();
     CHECK_GL(glBufferData(GL_ARRAY_BUFFER, vertexBytes, m_glVertexData, hint));
+    m_vertexBufferSize = vertexBytes;
   }
 
   if (m_glIndexData && m_indexCount > 0) {
@@ -69,16 +87,107 @@ void MeshBase::upload(RenderState& rs, GLenum hint) {
     rs.indexBuffer(m_glIndexBuffer);
     size_t indexBytes = m_indexCount * sizeof(GLushort);
     CHECK_GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, m_glIndexData, hint));
+    m_indexBufferSize = indexBytes;
   }
 
   m_isUploaded = true;
 }
 
+// Replace the contents of the bound buffer. Respecifying the storage first lets the driver hand out new memory while
+// the GPU may still be reading the old contents, instead of waiting for it.
+static void replaceBufferData(GLenum target, const void* data, size_t bytes, size_t& bufferSize, GLenum hint) {
+  if (bytes > bufferSize) {
+    CHECK_GL(glBufferData(target, bytes, data, hint));
+    bufferSize = bytes;
+  } else {
+    CHECK_GL(glBufferData(target, bufferSize, nullptr, hint));
+    CHECK_GL(glBufferSubData(target, 0, bytes, data));
+  }
+}
+
+void MeshBase::uploadVertices(RenderState& rs, const void* vertices, size_t count, GLenum hint) {
+
+  if (m_glVertexBuffer == 0) {
+    CHECK_GL(glGenBuffers(1, &m_glVertexBuffer));
+  }
+
+  rs.vertexBuffer(m_glVertexBuffer);
+  replaceBufferData(GL_ARRAY_BUFFER, vertices, count * m_vertexLayout.stride(), m_vertexBufferSize, hint);
+
+  m_glVertexData = nullptr;
+  m_vertexCount = count;
+  m_isUploaded = true;
+}
+
+void MeshBase::uploadIndices(RenderState& rs, const uint16_t* indices, size_t count, GLenum hint) {
+
+  if (m_glIndexBuffer == 0) {
+    CHECK_GL(glGenBuffers(1, &m_glIndexBuffer));
+  }
+
+  rs.indexBuffer(m_glIndexBuffer);
+  replaceBufferData(GL_ELEMENT_ARRAY_BUFFER, indices, count * sizeof(GLushort), m_indexBufferSize, hint);
+
+  m_glIndexData = nullptr;
+  m_indexCount = count;
+  m_isUploaded = true;
+}
+
+// Respecify the storage of the bound buffer without data, keeping it at least as large as before so that the driver can
+// reuse allocations from earlier frames.
+static void orphanBufferData(GLenum target, size_t bytes, size_t& bufferSize, GLenum hint) {
+  bufferSize = std::max(bytes, bufferSize);
+  CHECK_GL(glBufferData(target, bufferSize, nullptr, hint));
+}
+
+void MeshBase::reserve(RenderState& rs, size_t vertexCount, size_t indexCount, GLenum hint) {
+
+  if (m_glVertexBuffer == 0) {
+    CHECK_GL(glGenBuffers(1, &m_glVertexBuffer));
+  }
+  rs.vertexBuffer(m_glVertexBuffer);
+  orphanBufferData(GL_ARRAY_BUFFER, vertexCount * m_vertexLayout.stride(), m_vertexBufferSize, hint);
+
+  if (indexCount > 0) {
+    if (m_glIndexBuffer == 0) {
+      CHECK_GL(glGenBuffers(1, &m_glIndexBuffer));
+    }
+    rs.indexBuffer(m_glIndexBuffer);
+    orphanBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLushort), m_indexBufferSize, hint);
+  }
+
+  m_glVertexData = nullptr;
+  m_glIndexData = nullptr;
+  m_vertexCount = vertexCount;
+  m_indexCount = indexCount;
+  m_isUploaded = true;
+}
+
+void MeshBase::writeVertices(RenderState& rs, size_t firstVertex, const void* vertices, size_t count) {
+  assert(firstVertex + count <= m_vertexCount);
+  size_t stride = m_vertexLayout.stride();
+  rs.vertexBuffer(m_glVertexBuffer);
+  CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, firstVertex * stride, count * stride, vertices));
+}
+
+void MeshBase::writeIndices(RenderState& rs, size_t firstIndex, const uint16_t* indices, size_t count) {
+  assert(firstIndex + count <= m_indexCount);
+  rs.indexBuffer(m_glIndexBuffer);
+  CHECK_GL(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(GLushort), count * sizeof(GLushort), indices));
+}
+
 bool MeshBase::draw(RenderState& rs, ShaderProgram& shader) {
+
+  // Upload first, since the number of indices isn't known until then.
+  if (!m_isUploaded) {
+    upload(rs);
+  }
+
   return draw(rs, shader, m_indexCount, 0);
 }
 
-bool MeshBase::draw(RenderState& rs, ShaderProgram& shader, size_t indexCount, const void* indexOffset) {
+bool MeshBase::draw(RenderState& rs, ShaderProgram& shader, size_t indexCount, const void* indexOffset,
+                    size_t baseVertex) {
 
   // Ensure that geometry is buffered into GPU.
   if (!m_isUploaded) {
@@ -102,14 +211,52 @@ bool MeshBase::draw(RenderState& rs, ShaderProgram& shader, size_t indexCount, c
     rs.indexBuffer(m_glIndexBuffer);
   }
 
-  // Enable vertex layout.
-  m_vertexLayout.enable(rs, shader);
+  // Enable vertex layout, starting from the base vertex.
+  m_vertexLayout.enable(rs, shader, baseVertex * m_vertexLayout.stride());
 
   // Draw as elements or arrays.
   if (m_indexCount > 0) {
     CHECK_GL(glDrawElements(m_drawMode, indexCount, GL_UNSIGNED_SHORT, indexOffset));
   } else if (m_vertexCount > 0) {
-    CHECK_GL(glDrawArrays(m_drawMode, 0, m_vertexCount));
+    CHECK_GL(glDrawArrays(m_drawMode, 0, m_vertexCount - baseVertex));
+  }
+
+  return true;
+}
+
+bool MeshBase::drawInstanced(RenderState& rs, ShaderProgram& shader, MeshBase& instances, size_t firstInstance,
+                             size_t instanceCount) {
+
+  if (!Extensions::instancedArrays) {
+    return false;
+  }
+
+  if (!m_isUploaded) {
+    upload(rs);
+  }
+  if (!instances.m_isUploaded) {
+    instances.upload(rs);
+  }
+
+  if (m_vertexCount == 0 || instanceCount == 0) {
+    return false;
+  }
+
+  if (!shader.use(rs)) {
+    return false;
+  }
+
+  // Attribute pointers refer to the buffer bound when they are set, so each layout is enabled with its own buffer.
+  rs.vertexBuffer(m_glVertexBuffer);
+  m_vertexLayout.enable(rs, shader);
+  rs.vertexBuffer(instances.m_glVertexBuffer);
+  instances.m_vertexLayout.enable(rs, shader, firstInstance * instances.m_vertexLayout.stride());
+
+  if (m_indexCount > 0) {
+    rs.indexBuffer(m_glIndexBuffer);
+    CHECK_GL(glDrawElementsInstancedANGLE(m_drawMode, m_indexCount, GL_UNSIGNED_SHORT, nullptr, instanceCount));
+  } else {
+    CHECK_GL(glDrawArraysInstancedANGLE(m_drawMode, 0, m_vertexCount, instanceCount));
   }
 
   return true;
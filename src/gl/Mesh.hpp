@@ -11,6 +11,7 @@
 
 namespace stock {
 
+class DeletionQueue;
 class RenderState;
 
 // Mesh is a drawable collection of geometry contained in a vertex buffer and
@@ -34,14 +35,34 @@ public:
   // geometry is uploaded, no more vertices or indices can be added.
   virtual void upload(RenderState& rs, GLenum hint = GL_STATIC_DRAW);
 
+  // Replace the contents of the vertex or index buffer, for geometry that changes every frame; the buffer storage is
+  // reused while it is large enough. The data is not retained.
+  void uploadVertices(RenderState& rs, const void* vertices, size_t count, GLenum hint = GL_STREAM_DRAW);
+  void uploadIndices(RenderState& rs, const uint16_t* indices, size_t count, GLenum hint = GL_STATIC_DRAW);
+
+  // Discard the contents of the vertex and index buffers and make room for the given number of vertices and indices,
+  // which can then be filled in parts with writeVertices() and writeIndices().
+  void reserve(RenderState& rs, size_t vertexCount, size_t indexCount, GLenum hint = GL_STREAM_DRAW);
+  void writeVertices(RenderState& rs, size_t firstVertex, const void* vertices, size_t count);
+  void writeIndices(RenderState& rs, size_t firstIndex, const uint16_t* indices, size_t count);
+
   // Release all OpenGL resources for this Mesh.
   void dispose(RenderState& rs);
 
+  // Hand all OpenGL resources for this Mesh to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
   // Render the geometry in this mesh using the ShaderProgram _shader; if
   // geometry has not already been uploaded it will be uploaded at this point.
   bool draw(RenderState& rs, ShaderProgram& shader);
 
-  bool draw(RenderState& rs, ShaderProgram& shader, size_t indexCount, const void* indexOffset);
+  // Render a range of indices; indices are relative to 'baseVertex'.
+  bool draw(RenderState& rs, ShaderProgram& shader, size_t indexCount, const void* indexOffset, size_t baseVertex = 0);
+
+  // Render 'instanceCount' copies of the geometry in this mesh, reading per-instance attributes from the vertices of
+  // 'instances' beginning at 'firstInstance'; requires Extensions::instancedArrays.
+  bool drawInstanced(RenderState& rs, ShaderProgram& shader, MeshBase& instances, size_t firstInstance,
+                     size_t instanceCount);
 
   // Get the total size of VRAM in bytes used by this Mesh.
   size_t getTotalBufferSize() const;
@@ -55,11 +76,13 @@ protected:
   size_t m_vertexCount = 0;
   GLuint m_glVertexBuffer = 0;
   GLbyte* m_glVertexData = nullptr;
+  size_t m_vertexBufferSize = 0;
 
   // Index data
   size_t m_indexCount = 0;
   GLuint m_glIndexBuffer = 0;
   GLushort* m_glIndexData = nullptr;
+  size_t m_indexBufferSize = 0;
 
   GLenum m_drawMode = GL_TRIANGLES;
 
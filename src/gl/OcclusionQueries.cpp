@@ -0,0 +1,182 @@
+#include "gl/OcclusionQueries.hpp"
+#include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
+#include "gl/RenderState.hpp"
+#include "view/Camera.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <cassert>
+
+namespace stock {
+
+// Number of query objects to generate whenever the pool runs out.
+static constexpr size_t QUERY_POOL_GROWTH = 32;
+
+static const std::string proxyVertexShader = R"SHADER_END(
+attribute vec3 a_position;
+uniform mat4 u_mvp;
+void main() {
+    gl_Position = u_mvp * vec4(a_position, 1.);
+}
+)SHADER_END";
+
+static const std::string proxyFragmentShader = R"SHADER_END(
+#ifdef GL_ES
+precision mediump float;
+#endif
+void main() {
+    gl_FragColor = vec4(1.);
+}
+)SHADER_END";
+
+OcclusionQueries::OcclusionQueries() : OcclusionQueries(Options()) {}
+
+OcclusionQueries::OcclusionQueries(Options options)
+    : m_options(options), m_shaderProgram(proxyFragmentShader, proxyVertexShader), m_mvpLocation("u_mvp") {
+  // The proxy is a unit cube, scaled and translated onto each box.
+  m_proxyMesh.vertices = {
+      {0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {1.f, 1.f, 0.f}, {0.f, 1.f, 0.f},
+      {0.f, 0.f, 1.f}, {1.f, 0.f, 1.f}, {1.f, 1.f, 1.f}, {0.f, 1.f, 1.f},
+  };
+  m_proxyMesh.indices = {
+      0, 2, 1, 0, 3, 2, 4, 5, 6, 4, 6, 7, 0, 1, 5, 0, 5, 4,
+      2, 3, 7, 2, 7, 6, 1, 2, 6, 1, 6, 5, 3, 0, 4, 3, 4, 7,
+  };
+  m_proxyMesh.retainData = true;
+  m_proxyMesh.setVertexLayout(VertexLayout({VertexAttribute("a_position", 3, GL_FLOAT, GL_FALSE)}));
+}
+
+OcclusionQueries::~OcclusionQueries() {
+  assert(m_queries.empty());
+}
+
+bool OcclusionQueries::isSupported() const {
+  return Extensions::occlusionQuery;
+}
+
+GLuint OcclusionQueries::acquireQuery() {
+  if (m_freeQueries.empty()) {
+    size_t count = m_queries.size();
+    m_queries.resize(count + QUERY_POOL_GROWTH);
+    CHECK_GL(glGenQueriesEXT(QUERY_POOL_GROWTH, &m_queries[count]));
+    m_freeQueries.assign(m_queries.begin() + count, m_queries.end());
+  }
+  GLuint query = m_freeQueries.back();
+  m_freeQueries.pop_back();
+  return query;
+}
+
+void OcclusionQueries::beginFrame(const Camera& camera) {
+  m_frame++;
+  m_viewProjectionMatrix = camera.viewProjectionMatrix();
+  m_cameraPosition = camera.transform().position();
+  m_cameraNear = camera.nearDepth();
+
+  if (!isSupported()) {
+    return;
+  }
+
+  // Queries complete in order, so visit them from oldest to newest and stop at the first one still in flight.
+  while (!m_pending.empty()) {
+    auto pending = m_pending.front();
+    auto it = m_objects.find(pending.id);
+    if (it != m_objects.end() && it->second.query == pending.query) {
+      GLuint available = 0;
+      CHECK_GL(glGetQueryObjectuivEXT(pending.query, GL_QUERY_RESULT_AVAILABLE_EXT, &available));
+      if (!available) {
+        break;
+      }
+      GLuint passed = 0;
+      CHECK_GL(glGetQueryObjectuivEXT(pending.query, GL_QUERY_RESULT_EXT, &passed));
+      auto& object = it->second;
+      if (passed) {
+        object.visible = true;
+        object.visibleFrame = object.queryFrame;
+      } else if (object.queryFrame > object.visibleFrame + m_options.visibleFrames) {
+        object.visible = false;
+      }
+      object.query = 0;
+    }
+    // Queries of removed objects are returned to the pool without reading their results.
+    m_freeQueries.push_back(pending.query);
+    m_pending.pop_front();
+  }
+}
+
+bool OcclusionQueries::isVisible(ObjectId id) const {
+  if (!isSupported()) {
+    return true;
+  }
+  auto it = m_objects.find(id);
+  if (it == m_objects.end()) {
+    return true;
+  }
+  const auto& object = it->second;
+  if (object.query != 0 && m_frame > object.queryFrame + m_options.maxLatency) {
+    return true;
+  }
+  return object.visible;
+}
+
+void OcclusionQueries::query(RenderState& rs, ObjectId id, const BoundingBox& box) {
+  if (!isSupported()) {
+    return;
+  }
+  auto& object = m_objects[id];
+  if (object.query != 0) {
+    return;
+  }
+
+  // A proxy close enough to be cut by the near plane may pass no samples even though the object is in view, so
+  // treat boxes near the camera as visible without a query.
+  glm::vec3 nearMargin(m_cameraNear * 4.f);
+  if (BoundingBox(box.min() - nearMargin, box.max() + nearMargin).contains(m_cameraPosition)) {
+    object.visible = true;
+    object.visibleFrame = m_frame;
+    return;
+  }
+
+  rs.colorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  rs.depthMask(GL_FALSE);
+  rs.depthTest(GL_TRUE);
+  rs.culling(GL_FALSE);
+  rs.blending(GL_FALSE);
+
+  // Enlarge the proxy slightly so its faces don't z-fight with the surfaces of the object itself.
+  auto size = box.max() - box.min();
+  auto padding = size * 0.01f + glm::vec3(1e-4f);
+  auto model = glm::scale(glm::translate(glm::mat4(1.f), box.min() - padding), size + padding * 2.f);
+  m_shaderProgram.setUniformMatrix4f(rs, m_mvpLocation, m_viewProjectionMatrix * model);
+
+  GLenum target = Extensions::isEs() ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT : GL_ANY_SAMPLES_PASSED_EXT;
+  GLuint query = acquireQuery();
+  CHECK_GL(glBeginQueryEXT(target, query));
+  m_proxyMesh.draw(rs, m_shaderProgram);
+  CHECK_GL(glEndQueryEXT(target));
+
+  object.query = query;
+  object.queryFrame = m_frame;
+  m_pending.push_back({id, query});
+}
+
+void OcclusionQueries::endFrame(RenderState& rs) {
+  rs.colorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  rs.depthMask(GL_TRUE);
+}
+
+void OcclusionQueries::remove(ObjectId id) {
+  m_objects.erase(id);
+}
+
+void OcclusionQueries::dispose(RenderState& rs) {
+  if (!m_queries.empty()) {
+    CHECK_GL(glDeleteQueriesEXT(static_cast<GLsizei>(m_queries.size()), m_queries.data()));
+  }
+  m_queries.clear();
+  m_freeQueries.clear();
+  m_pending.clear();
+  m_objects.clear();
+  m_shaderProgram.dispose(rs);
+  m_proxyMesh.dispose(rs);
+}
+
+} // namespace stock
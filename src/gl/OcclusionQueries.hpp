@@ -0,0 +1,98 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include "gl/Mesh.hpp"
+#include "gl/ShaderProgram.hpp"
+#include "gl/ShaderUniform.hpp"
+#include "transform/BoundingBox.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace stock {
+
+class Camera;
+class RenderState;
+
+// OcclusionQueries decides which objects to draw using hardware occlusion queries on their bounding boxes. Boxes are
+// drawn with color and depth writes disabled after the scene, and each result is read back once the GPU reports it
+// as available, usually one or two frames later, so queries never stall the pipeline. Until then an object keeps the
+// visibility of its previous result.
+//
+// Errors favor drawing: objects without a result are visible, and an object found visible stays visible for a few
+// frames before a query can hide it again.
+
+class OcclusionQueries {
+
+public:
+  using ObjectId = uint32_t;
+
+  struct Options {
+    // Number of frames an object stays visible after a query last found it visible.
+    uint32_t visibleFrames = 4;
+    // Number of frames after which an object whose query has no result yet is treated as visible.
+    uint32_t maxLatency = 3;
+  };
+
+  OcclusionQueries();
+
+  explicit OcclusionQueries(Options options);
+
+  ~OcclusionQueries();
+
+  // Returns true if the current context supports occlusion queries; if not, all objects are visible.
+  bool isSupported() const;
+
+  // Begin a frame viewed from 'camera' and collect query results that have become available.
+  void beginFrame(const Camera& camera);
+
+  // Returns true if the object should be drawn this frame.
+  bool isVisible(ObjectId id) const;
+
+  // Issue a query for an object with the given world-space bounds; call this after drawing the scene so the depth
+  // buffer contains all potential occluders. Objects that still have a query in flight are skipped.
+  void query(RenderState& rs, ObjectId id, const BoundingBox& box);
+
+  // Restore color and depth writes after the queries of a frame.
+  void endFrame(RenderState& rs);
+
+  // Forget an object's visibility and any query in flight for it.
+  void remove(ObjectId id);
+
+  // Delete the OpenGL query objects and proxy resources.
+  void dispose(RenderState& rs);
+
+private:
+  struct Object {
+    GLuint query = 0;
+    uint64_t queryFrame = 0;
+    uint64_t visibleFrame = 0;
+    bool visible = true;
+  };
+
+  struct Pending {
+    ObjectId id;
+    GLuint query;
+  };
+
+  GLuint acquireQuery();
+
+  Options m_options;
+  std::unordered_map<ObjectId, Object> m_objects;
+  std::deque<Pending> m_pending;
+  std::vector<GLuint> m_queries;
+  std::vector<GLuint> m_freeQueries;
+  glm::mat4 m_viewProjectionMatrix;
+  glm::vec3 m_cameraPosition;
+  float m_cameraNear = 0.f;
+  uint64_t m_frame = 0;
+
+  ShaderProgram m_shaderProgram;
+  UniformLocation m_mvpLocation;
+  Mesh<glm::vec3> m_proxyMesh;
+};
+
+} // namespace stock
@@ -3,6 +3,8 @@
 //
 
 #include "Pixmap.hpp"
+#include <algorithm>
+#include <cstdio>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_NO_HDR
@@ -59,7 +61,124 @@ uint32_t Pixmap::components() const {
   case PixelFormat::LUMINANCE_ALPHA: return 2;
   case PixelFormat::RGB: return 3;
   case PixelFormat::RGBA: return 4;
+  case PixelFormat::DEPTH_COMPONENT: return 1;
+  case PixelFormat::DEPTH_STENCIL: return 1;
   }
 }
 
+// Append a 32-bit big-endian integer.
+static void appendUint32(std::vector<uint8_t>& out, uint32_t value) {
+  out.push_back(static_cast<uint8_t>(value >> 24));
+  out.push_back(static_cast<uint8_t>(value >> 16));
+  out.push_back(static_cast<uint8_t>(value >> 8));
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+  static uint32_t table[256];
+  static bool hasTable = false;
+  if (!hasTable) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    hasTable = true;
+  }
+  uint32_t crc = 0xffffffffu;
+  for (size_t i = 0; i < length; i++) {
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffffu;
+}
+
+// Append a PNG chunk with its length and checksum.
+static void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+  appendUint32(out, static_cast<uint32_t>(data.size()));
+  size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  appendUint32(out, crc32(out.data() + start, out.size() - start));
+}
+
+std::vector<uint8_t> Pixmap::encodePng() const {
+  std::vector<uint8_t> out;
+
+  uint8_t colorType = 0;
+  switch (m_format) {
+  case PixelFormat::ALPHA: colorType = 0; break;
+  case PixelFormat::LUMINANCE: colorType = 0; break;
+  case PixelFormat::LUMINANCE_ALPHA: colorType = 4; break;
+  case PixelFormat::RGB: colorType = 2; break;
+  case PixelFormat::RGBA: colorType = 6; break;
+  default: return out;
+  }
+  if (m_type != PixelType::UNSIGNED_BYTE || m_pixels == nullptr || m_width == 0 || m_height == 0) {
+    return out;
+  }
+
+  static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  out.insert(out.end(), signature, signature + sizeof(signature));
+
+  std::vector<uint8_t> header;
+  appendUint32(header, m_width);
+  appendUint32(header, m_height);
+  header.push_back(8); // Bit depth
+  header.push_back(colorType);
+  header.push_back(0); // Compression method
+  header.push_back(0); // Filter method
+  header.push_back(0); // Interlace method
+  appendChunk(out, "IHDR", header);
+
+  // Each row starts with a filter type byte. Pixmap rows start at the bottom, but PNG rows start at the top.
+  size_t rowSize = static_cast<size_t>(m_width) * components();
+  std::vector<uint8_t> rows;
+  rows.reserve((rowSize + 1) * m_height);
+  for (uint32_t y = m_height; y-- > 0;) {
+    rows.push_back(0);
+    rows.insert(rows.end(), m_pixels + y * rowSize, m_pixels + (y + 1) * rowSize);
+  }
+
+  // Wrap the rows in a zlib stream made of uncompressed deflate blocks.
+  std::vector<uint8_t> data;
+  data.push_back(0x78);
+  data.push_back(0x01);
+  static const size_t MAX_BLOCK_SIZE = 65535;
+  for (size_t offset = 0; offset < rows.size(); offset += MAX_BLOCK_SIZE) {
+    size_t size = std::min(MAX_BLOCK_SIZE, rows.size() - offset);
+    bool isFinal = offset + size == rows.size();
+    data.push_back(isFinal ? 1 : 0);
+    data.push_back(static_cast<uint8_t>(size));
+    data.push_back(static_cast<uint8_t>(size >> 8));
+    data.push_back(static_cast<uint8_t>(~size));
+    data.push_back(static_cast<uint8_t>(~size >> 8));
+    data.insert(data.end(), rows.begin() + offset, rows.begin() + offset + size);
+  }
+  uint32_t a = 1, b = 0;
+  for (uint8_t byte : rows) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  appendUint32(data, (b << 16) | a);
+  appendChunk(out, "IDAT", data);
+
+  appendChunk(out, "IEND", {});
+  return out;
+}
+
+bool Pixmap::writePng(const std::string& path) const {
+  auto data = encodePng();
+  if (data.empty()) {
+    return false;
+  }
+  std::FILE* file = std::fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool success = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+  return std::fclose(file) == 0 && success;
+}
+
 } // namespace stock
@@ -5,7 +5,9 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <string>
 #include <vector>
+#include "gl/Extensions.hpp"
 #include "gl/GL.hpp"
 
 namespace stock {
@@ -20,10 +22,15 @@ public:
     LUMINANCE_ALPHA = GL_LUMINANCE_ALPHA,
     RGB = GL_RGB,
     RGBA = GL_RGBA,
+    DEPTH_COMPONENT = GL_DEPTH_COMPONENT,
+    DEPTH_STENCIL = GL_DEPTH_STENCIL_OES,
   };
 
   enum class PixelType : GLenum {
     UNSIGNED_BYTE = GL_UNSIGNED_BYTE,
+    UNSIGNED_SHORT = GL_UNSIGNED_SHORT,
+    UNSIGNED_INT = GL_UNSIGNED_INT,
+    UNSIGNED_INT_24_8 = GL_UNSIGNED_INT_24_8_OES,
   };
 
   // Construct an empty Pixmap.
@@ -58,9 +65,17 @@ public:
   uint32_t width() const { return m_width; }
   uint32_t height() const { return m_height; }
 
-  // Get the number of color components in the Pixmap.
+  // Get the number of components in each pixel of the Pixmap. Packed depth-stencil pixels are a single component of
+  // type UNSIGNED_INT_24_8.
   uint32_t components() const;
 
+  // Encode the Pixmap as a PNG image, top row first; returns an empty vector if the format or type isn't supported.
+  // The image data is stored without compression, which is fast to write but makes large files.
+  std::vector<uint8_t> encodePng() const;
+
+  // Write the Pixmap to a PNG file; returns true if successful.
+  bool writePng(const std::string& path) const;
+
 protected:
 
   PixelFormat m_format = PixelFormat::RGBA;
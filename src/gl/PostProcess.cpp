@@ -0,0 +1,220 @@
+#include "gl/PostProcess.hpp"
+#include "gl/RenderState.hpp"
+#include "gl/Texture.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace stock {
+
+constexpr PostProcess::PassId PostProcess::INPUT;
+
+PostProcess::PostProcess() : PostProcess(Options()) {}
+
+PostProcess::PostProcess(Options options) : m_options(options) {}
+
+PostProcess::~PostProcess() = default;
+
+PostProcess::PassId PostProcess::addPass(const std::string& name, const std::string& source, float scale,
+                                         std::vector<PassId> inputs, SetupFunction setup) {
+  auto id = static_cast<PassId>(m_passes.size());
+  if (inputs.empty()) {
+    inputs.push_back(id == 0 ? INPUT : id - 1);
+  }
+  for (auto input : inputs) {
+    assert(input == INPUT || input < id);
+    (void)input;
+  }
+  m_passes.push_back({name, source, scale, std::move(inputs), std::move(setup), false});
+  m_isCompiled = false;
+  return id;
+}
+
+PostProcess::PassId PostProcess::addColorPass(const std::string& name, const std::string& source,
+                                              SetupFunction setup) {
+  auto id = static_cast<PassId>(m_passes.size());
+  std::vector<PassId> inputs{id == 0 ? INPUT : id - 1};
+  m_passes.push_back({name, source, 1.f, std::move(inputs), std::move(setup), true});
+  m_isCompiled = false;
+  return id;
+}
+
+void PostProcess::clear() {
+  m_passes.clear();
+  m_isCompiled = false;
+}
+
+bool PostProcess::isReadLater(PassId pass) const {
+  for (PassId later = pass + 2; later < m_passes.size(); later++) {
+    const auto& inputs = m_passes[later].inputs;
+    if (std::find(inputs.begin(), inputs.end(), pass) != inputs.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PostProcess::compile() {
+  if (m_isCompiled) {
+    return;
+  }
+
+  for (auto& draw : m_draws) {
+    if (draw.shader) {
+      m_retiredShaders.push_back(std::move(draw.shader));
+    }
+  }
+  m_draws.clear();
+
+  // Group each sampling pass with the color passes after it; a color pass starts a new group only when its input
+  // must be kept for another pass, or when fusing is disabled.
+  std::vector<size_t> drawOfPass(m_passes.size());
+  for (PassId id = 0; id < m_passes.size(); id++) {
+    const auto& pass = m_passes[id];
+    bool fuse = pass.isColor && id > 0 && m_options.fuseColorPasses && !isReadLater(id - 1);
+    if (!fuse) {
+      Draw draw;
+      // Color passes run at the size of the pass before them.
+      draw.scale = pass.isColor && id > 0 ? m_draws[drawOfPass[id - 1]].scale : pass.scale;
+      for (auto input : pass.inputs) {
+        draw.inputs.push_back(input);
+      }
+      m_draws.push_back(std::move(draw));
+    }
+    m_draws.back().passes.push_back(id);
+    drawOfPass[id] = m_draws.size() - 1;
+  }
+
+  for (size_t index = 0; index < m_draws.size(); index++) {
+    auto& draw = m_draws[index];
+
+    // Inputs refer to the last pass of the draws that produce them; replace them with the draw index.
+    for (auto& input : draw.inputs) {
+      if (input != INPUT) {
+        input = static_cast<PassId>(drawOfPass[input]);
+      }
+    }
+
+    std::string source = "#ifdef GL_ES\nprecision mediump float;\n#endif\nvarying vec2 v_uv;\n";
+    for (size_t i = 0; i < draw.inputs.size(); i++) {
+      auto suffix = std::to_string(i);
+      source += "uniform sampler2D u_input" + suffix + ";\nuniform vec2 u_texelSize" + suffix + ";\n";
+      draw.inputLocations.emplace_back("u_input" + suffix);
+      draw.texelSizeLocations.emplace_back("u_texelSize" + suffix);
+    }
+
+    // Give each pass's 'apply' function a unique name, so that fused passes don't collide.
+    std::string body;
+    for (auto id : draw.passes) {
+      const auto& pass = m_passes[id];
+      auto function = "apply_" + std::to_string(id);
+      source += "#define apply " + function + "\n" + pass.source + "\n#undef apply\n";
+      if (pass.isColor) {
+        if (body.empty()) {
+          body += "    vec4 color = texture2D(u_input0, v_uv);\n";
+        }
+        body += "    color = " + function + "(color, v_uv);\n";
+      } else {
+        body += "    vec4 color = " + function + "(v_uv);\n";
+      }
+    }
+    source += "void main() {\n" + body + "    gl_FragColor = color;\n}\n";
+
+    draw.source = source;
+    draw.shader.reset(new ShaderProgram(source, FullscreenTriangle::vertexShaderSource()));
+  }
+
+  m_isCompiled = true;
+}
+
+size_t PostProcess::drawCount() {
+  compile();
+  return m_draws.size();
+}
+
+const std::string& PostProcess::drawSource(size_t draw) {
+  compile();
+  return m_draws[draw].source;
+}
+
+void PostProcess::addTo(RenderGraph& graph, RenderGraph::ResourceId input, RenderGraph::ResourceId output,
+                        uint32_t width, uint32_t height) {
+
+  compile();
+
+  std::vector<RenderGraph::ResourceId> targets(m_draws.size());
+  for (size_t index = 0; index < m_draws.size(); index++) {
+    Draw* draw = &m_draws[index];
+    const auto& name = m_passes[draw->passes.front()].name;
+
+    std::vector<RenderGraph::ResourceId> inputs;
+    for (auto drawInput : draw->inputs) {
+      inputs.push_back(drawInput == INPUT ? input : targets[drawInput]);
+    }
+
+    if (index + 1 == m_draws.size()) {
+      targets[index] = output;
+    } else {
+      auto scaledWidth = static_cast<uint32_t>(std::ceil(width * draw->scale));
+      auto scaledHeight = static_cast<uint32_t>(std::ceil(height * draw->scale));
+      targets[index] = graph.createTarget(name, std::max(scaledWidth, 1u), std::max(scaledHeight, 1u),
+                                          Framebuffer::Options());
+    }
+
+    graph.addPass(name, inputs, targets[index], [this, draw, inputs](RenderState& rs, RenderGraph& graph) {
+      for (auto& shader : m_retiredShaders) {
+        shader->dispose(rs);
+      }
+      m_retiredShaders.clear();
+
+      rs.blending(false);
+      rs.culling(false);
+      rs.depthTest(false);
+      rs.scissorTest(false);
+
+      auto& shader = *draw->shader;
+      for (size_t i = 0; i < inputs.size(); i++) {
+        auto& texture = graph.texture(inputs[i]);
+        auto unit = static_cast<GLuint>(i);
+        texture.bind(rs, unit);
+        shader.setUniformi(rs, draw->inputLocations[i], static_cast<int>(unit));
+        shader.setUniformf(rs, draw->texelSizeLocations[i], 1.f / texture.width(), 1.f / texture.height());
+      }
+      for (auto id : draw->passes) {
+        const auto& pass = m_passes[id];
+        if (pass.setup) {
+          pass.setup(rs, shader);
+        }
+      }
+      m_triangle.draw(rs, shader);
+    });
+  }
+}
+
+void PostProcess::dispose(RenderState& rs) {
+  for (auto& draw : m_draws) {
+    draw.shader->dispose(rs);
+  }
+  for (auto& shader : m_retiredShaders) {
+    shader->dispose(rs);
+  }
+  m_retiredShaders.clear();
+  m_draws.clear();
+  m_isCompiled = false;
+  m_triangle.dispose(rs);
+}
+
+void PostProcess::dispose(DeletionQueue& queue) {
+  for (auto& draw : m_draws) {
+    draw.shader->dispose(queue);
+  }
+  for (auto& shader : m_retiredShaders) {
+    shader->dispose(queue);
+  }
+  m_retiredShaders.clear();
+  m_draws.clear();
+  m_isCompiled = false;
+  m_triangle.dispose(queue);
+}
+
+} // namespace stock
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "gl/FullscreenTriangle.hpp"
+#include "gl/RenderGraph.hpp"
+#include "gl/ShaderProgram.hpp"
+#include "gl/ShaderUniform.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stock {
+
+class DeletionQueue;
+class RenderState;
+
+// PostProcess is a chain of full-screen passes that are added to a RenderGraph, which assigns their targets to a
+// minimal set of Framebuffers; a chain of passes that each read the previous one ping-pongs between two.
+//
+// A sampling pass reads any earlier passes, or the input of the chain, and renders at a scale of the chain's size,
+// e.g. 0.5 for a half-resolution blur. Its source defines 'vec4 apply(vec2 uv)', which samples input i with the
+// uniforms 'u_input<i>' and 'u_texelSize<i>'.
+//
+// A color pass changes the color of each pixel independently; its source defines 'vec4 apply(vec4 color, vec2 uv)'.
+// Color passes are fused into the shader of the pass before them, unless another pass reads that pass's result, so
+// e.g. a composite followed by tone mapping and a vignette is a single draw.
+//
+// All passes are drawn with one shared FullscreenTriangle. Since fused passes share a shader, uniform names must be
+// unique within the chain.
+
+class PostProcess {
+
+public:
+  using PassId = uint32_t;
+  using SetupFunction = std::function<void(RenderState& rs, ShaderProgram& shader)>;
+
+  // Refers to the input of the chain in the inputs of a pass.
+  static constexpr PassId INPUT = UINT32_MAX;
+
+  struct Options {
+    // Fuse color passes into the passes before them; disable to compare the results of each pass.
+    bool fuseColorPasses = true;
+  };
+
+  PostProcess();
+
+  explicit PostProcess(Options options);
+
+  ~PostProcess();
+
+  // Add a pass that samples the results of 'inputs' and renders at 'scale' times the size of the chain. With no
+  // inputs it reads the previous pass, or the input of the chain if it is the first pass. 'setup' is called before
+  // drawing the pass to set its uniforms.
+  PassId addPass(const std::string& name, const std::string& source, float scale, std::vector<PassId> inputs = {},
+                 SetupFunction setup = nullptr);
+
+  // Add a pass that changes the color of each pixel of the previous pass, at the same size.
+  PassId addColorPass(const std::string& name, const std::string& source, SetupFunction setup = nullptr);
+
+  // Add the chain to a render graph, reading from the target 'input' and rendering the last pass into 'output'.
+  // Passes are sized relative to 'width' and 'height'. This builds the shaders of the chain when it has changed,
+  // without making GL calls. An empty chain adds no passes.
+  void addTo(RenderGraph& graph, RenderGraph::ResourceId input, RenderGraph::ResourceId output, uint32_t width,
+             uint32_t height);
+
+  // Get the number of draws that the chain needs after fusing color passes.
+  size_t drawCount();
+
+  // Get the fragment shader source of a draw of the chain.
+  const std::string& drawSource(size_t draw);
+
+  // Remove all passes.
+  void clear();
+
+  void dispose(RenderState& rs);
+
+  // Hand all OpenGL resources to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
+private:
+  struct Pass {
+    std::string name;
+    std::string source;
+    float scale;
+    std::vector<PassId> inputs;
+    SetupFunction setup;
+    bool isColor;
+  };
+
+  // A group of passes drawn with one shader: an optional sampling pass followed by color passes.
+  struct Draw {
+    std::vector<PassId> passes;
+    std::vector<PassId> inputs;
+    float scale;
+    std::string source;
+    std::unique_ptr<ShaderProgram> shader;
+    std::vector<UniformLocation> inputLocations;
+    std::vector<UniformLocation> texelSizeLocations;
+  };
+
+  void compile();
+
+  // Returns true if any pass after 'pass', other than the one directly after it, reads its result.
+  bool isReadLater(PassId pass) const;
+
+  Options m_options;
+  std::vector<Pass> m_passes;
+  std::vector<Draw> m_draws;
+  // Shaders replaced by rebuilding the chain, disposed when the chain next runs.
+  std::vector<std::unique_ptr<ShaderProgram>> m_retiredShaders;
+  FullscreenTriangle m_triangle;
+  bool m_isCompiled = false;
+};
+
+} // namespace stock
@@ -0,0 +1,192 @@
+#include "gl/ReadbackQueue.hpp"
+#include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
+#include "gl/RenderState.hpp"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+namespace stock {
+
+constexpr ReadbackQueue::Ticket ReadbackQueue::NO_TICKET;
+constexpr size_t ReadbackQueue::BUFFER_COUNT;
+constexpr uint64_t ReadbackQueue::FRAME_DELAY;
+
+static const uint32_t BYTES_PER_PIXEL = 4;
+
+ReadbackQueue::~ReadbackQueue() {
+  assert(m_buffers.empty());
+  assert(m_pending.empty());
+}
+
+ReadbackQueue::Ticket ReadbackQueue::read(GLint x, GLint y, uint32_t width, uint32_t height, Callback callback) {
+  Ticket ticket = ++m_lastTicket;
+  size_t size = static_cast<size_t>(width) * height * BYTES_PER_PIXEL;
+
+  if (!Extensions::pixelBufferObject) {
+    // Read synchronously, but deliver the result the same way as an asynchronous read.
+    auto pixels = static_cast<uint8_t*>(std::malloc(size));
+    CHECK_GL(glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+    m_finished.push_back({ticket, Pixmap(width, height, pixels, Pixmap::PixelFormat::RGBA), std::move(callback)});
+    return ticket;
+  }
+
+  if (m_pending.size() == BUFFER_COUNT) {
+    // All buffers are in use, so the oldest read has to finish now.
+    auto& oldest = m_pending.front();
+    m_finished.push_back({oldest.ticket, finish(oldest), std::move(oldest.callback)});
+    m_pending.pop_front();
+  }
+
+  Request request;
+  request.ticket = ticket;
+  request.width = width;
+  request.height = height;
+  request.callback = std::move(callback);
+  request.buffer = acquireBuffer(size);
+  request.frame = m_frame;
+
+  // With a pack buffer bound, glReadPixels only queues a copy into the buffer and returns.
+  CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, m_buffers[request.buffer].handle));
+  CHECK_GL(glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+  CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, 0));
+
+  if (Extensions::sync) {
+    request.fence = glFenceSyncAPPLE(GL_SYNC_GPU_COMMANDS_COMPLETE_APPLE, 0);
+    CHECK_GL();
+  }
+
+  m_pending.push_back(std::move(request));
+  return ticket;
+}
+
+bool ReadbackQueue::isPending(Ticket ticket) const {
+  for (const auto& request : m_pending) {
+    if (request.ticket == ticket) {
+      return true;
+    }
+  }
+  for (const auto& result : m_finished) {
+    if (result.ticket == ticket) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReadbackQueue::isReady(Ticket ticket) const {
+  return m_unclaimed.find(ticket) != m_unclaimed.end();
+}
+
+bool ReadbackQueue::take(Ticket ticket, Pixmap& pixmap) {
+  auto it = m_unclaimed.find(ticket);
+  if (it == m_unclaimed.end()) {
+    return false;
+  }
+  pixmap = it->second;
+  m_unclaimed.erase(it);
+  return true;
+}
+
+void ReadbackQueue::poll() {
+  m_frame++;
+
+  // Reads finish in order, so stop at the first one that the GPU may still be working on.
+  while (!m_pending.empty()) {
+    auto& front = m_pending.front();
+    if (front.fence) {
+      GLenum status = glClientWaitSyncAPPLE(front.fence, GL_SYNC_FLUSH_COMMANDS_BIT_APPLE, 0);
+      CHECK_GL();
+      if (status == GL_TIMEOUT_EXPIRED_APPLE) {
+        break;
+      }
+    } else if (m_frame - front.frame < FRAME_DELAY) {
+      break;
+    }
+    m_finished.push_back({front.ticket, finish(front), std::move(front.callback)});
+    m_pending.pop_front();
+  }
+
+  // Callbacks may start new reads, so run them from a separate list.
+  std::vector<Result> finished;
+  finished.swap(m_finished);
+  for (auto& result : finished) {
+    if (result.callback) {
+      result.callback(result.ticket, result.pixmap);
+    } else {
+      m_unclaimed[result.ticket] = result.pixmap;
+    }
+  }
+}
+
+void ReadbackQueue::dispose(RenderState& rs) {
+  for (auto& request : m_pending) {
+    if (request.fence) {
+      CHECK_GL(glDeleteSyncAPPLE(request.fence));
+    }
+  }
+  m_pending.clear();
+  for (auto& buffer : m_buffers) {
+    rs.vertexBufferUnset(buffer.handle);
+    rs.indexBufferUnset(buffer.handle);
+    CHECK_GL(glDeleteBuffers(1, &buffer.handle));
+  }
+  m_buffers.clear();
+  for (auto& result : m_finished) {
+    result.pixmap.dispose();
+  }
+  m_finished.clear();
+  for (auto& entry : m_unclaimed) {
+    entry.second.dispose();
+  }
+  m_unclaimed.clear();
+}
+
+size_t ReadbackQueue::acquireBuffer(size_t size) {
+  size_t index = 0;
+  while (index < m_buffers.size() && m_buffers[index].inUse) {
+    index++;
+  }
+  if (index == m_buffers.size()) {
+    Buffer buffer;
+    CHECK_GL(glGenBuffers(1, &buffer.handle));
+    m_buffers.push_back(buffer);
+  }
+  auto& buffer = m_buffers[index];
+  if (buffer.size < size) {
+    CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, buffer.handle));
+    // ES 2.0 only accepts the draw usage hints.
+    GLenum usage = Extensions::isEs() && Extensions::majorVersion() < 3 ? GL_STREAM_DRAW : GL_STREAM_READ;
+    CHECK_GL(glBufferData(GL_PIXEL_PACK_BUFFER_NV, size, nullptr, usage));
+    buffer.size = size;
+  }
+  buffer.inUse = true;
+  return index;
+}
+
+Pixmap ReadbackQueue::finish(Request& request) {
+  auto& buffer = m_buffers[request.buffer];
+  size_t size = static_cast<size_t>(request.width) * request.height * BYTES_PER_PIXEL;
+  auto pixels = static_cast<uint8_t*>(std::malloc(size));
+
+  CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, buffer.handle));
+  auto mapped = glMapBufferRangeEXT(GL_PIXEL_PACK_BUFFER_NV, 0, size, GL_MAP_READ_BIT_EXT);
+  CHECK_GL();
+  if (mapped != nullptr) {
+    std::memcpy(pixels, mapped, size);
+    CHECK_GL(glUnmapBufferOES(GL_PIXEL_PACK_BUFFER_NV));
+  } else {
+    Log::e("Failed to map pixel buffer for readback");
+    std::memset(pixels, 0, size);
+  }
+  CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, 0));
+
+  if (request.fence) {
+    CHECK_GL(glDeleteSyncAPPLE(request.fence));
+    request.fence = nullptr;
+  }
+  buffer.inUse = false;
+  return Pixmap(request.width, request.height, pixels, Pixmap::PixelFormat::RGBA);
+}
+
+} // namespace stock
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "gl/GL.hpp"
+#include "gl/Pixmap.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace stock {
+
+class RenderState;
+
+// ReadbackQueue reads pixels from the GPU without stalling the pipeline. Each read copies the pixels into one of a
+// small ring of pixel pack buffers, and the buffer is only mapped in poll() once a fence shows that the copy has
+// finished, or after a few frames when fences are not supported. Without pixel buffer objects, reads fall back to a
+// synchronous glReadPixels but are still delivered through poll().
+//
+// Finished pixels are RGBA, unsigned bytes, and bottom row first; they are owned by the receiver, who must call
+// Pixmap::dispose() when done with them.
+
+class ReadbackQueue {
+
+public:
+  using Ticket = uint64_t;
+  using Callback = std::function<void(Ticket ticket, Pixmap pixmap)>;
+
+  // Never returned for a read.
+  static constexpr Ticket NO_TICKET = 0;
+
+  // Number of pixel buffers in the ring; starting a read while all are in use waits for the oldest read.
+  static constexpr size_t BUFFER_COUNT = 3;
+
+  // Number of calls to poll() after which a read is assumed finished when fences are not supported.
+  static constexpr uint64_t FRAME_DELAY = 2;
+
+  ReadbackQueue() = default;
+
+  ~ReadbackQueue();
+
+  // Start reading a rectangle of the bound framebuffer. If 'callback' is set it receives the pixels during a later
+  // poll(), otherwise they can be taken with take() once isReady() returns true.
+  Ticket read(GLint x, GLint y, uint32_t width, uint32_t height, Callback callback = nullptr);
+
+  // Returns true if the read is still in progress.
+  bool isPending(Ticket ticket) const;
+
+  // Returns true if the pixels of a read without a callback can be taken.
+  bool isReady(Ticket ticket) const;
+
+  // Take the pixels of a finished read without a callback; returns false if they are not ready.
+  bool take(Ticket ticket, Pixmap& pixmap);
+
+  // Collect the reads that have finished and run their callbacks; call this on the GL thread once per frame.
+  void poll();
+
+  // Delete the pixel buffers and discard all pending and unclaimed pixels.
+  void dispose(RenderState& rs);
+
+private:
+  struct Buffer {
+    GLuint handle = 0;
+    size_t size = 0;
+    bool inUse = false;
+  };
+
+  struct Request {
+    Ticket ticket = NO_TICKET;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    Callback callback;
+    size_t buffer = 0;
+    GLsync fence = nullptr;
+    uint64_t frame = 0;
+  };
+
+  struct Result {
+    Ticket ticket;
+    Pixmap pixmap;
+    Callback callback;
+  };
+
+  size_t acquireBuffer(size_t size);
+
+  // Copy the pixels of a request out of its buffer, mapping it even if the GPU hasn't finished writing it.
+  Pixmap finish(Request& request);
+
+  std::vector<Buffer> m_buffers;
+  std::deque<Request> m_pending;
+  std::vector<Result> m_finished;
+  std::unordered_map<Ticket, Pixmap> m_unclaimed;
+  Ticket m_lastTicket = NO_TICKET;
+  uint64_t m_frame = 0;
+};
+
+} // namespace stock
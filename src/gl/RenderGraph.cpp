@@ -0,0 +1,310 @@
+#include "gl/RenderGraph.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "gl/Error.hpp"
+#include "gl/RenderState.hpp"
+#include "io/Log.hpp"
+#include <cassert>
+
+namespace stock {
+
+constexpr RenderGraph::ResourceId RenderGraph::BACKBUFFER;
+constexpr uint64_t RenderGraph::POOL_RETENTION_FRAMES;
+constexpr uint32_t RenderGraph::NO_PASS;
+
+// Returns true if Framebuffers created with these parameters are interchangeable.
+static bool isCompatible(uint32_t widthA, uint32_t heightA, const Framebuffer::Options& a, uint32_t widthB,
+                         uint32_t heightB, const Framebuffer::Options& b) {
+  return widthA == widthB && heightA == heightB && a.format == b.format && a.hasDepth == b.hasDepth &&
+         a.hasStencil == b.hasStencil && a.hasDepthTexture == b.hasDepthTexture && a.samples == b.samples;
+}
+
+RenderGraph::RenderGraph() {
+  reset();
+}
+
+RenderGraph::~RenderGraph() {
+  assert(m_pool.empty());
+}
+
+void RenderGraph::setBackbufferSize(uint32_t width, uint32_t height) {
+  m_backbufferWidth = width;
+  m_backbufferHeight = height;
+}
+
+RenderGraph::ResourceId RenderGraph::createTarget(const std::string& name, uint32_t width, uint32_t height,
+                                                  Framebuffer::Options options) {
+  Target target;
+  target.name = name;
+  target.width = width;
+  target.height = height;
+  target.options = options;
+  m_targets.push_back(target);
+  m_compiled = false;
+  return static_cast<ResourceId>(m_targets.size() - 1);
+}
+
+RenderGraph::PassId RenderGraph::addPass(const std::string& name, std::vector<ResourceId> inputs, ResourceId output,
+                                         ExecuteFunction execute) {
+  assert(output < m_targets.size());
+  PassId id = static_cast<PassId>(m_passes.size());
+  if (output != BACKBUFFER) {
+    assert(m_targets[output].producer == NO_PASS);
+    m_targets[output].producer = id;
+  }
+  Pass pass;
+  pass.name = name;
+  pass.inputs = std::move(inputs);
+  pass.output = output;
+  pass.execute = std::move(execute);
+  m_passes.push_back(std::move(pass));
+  m_compiled = false;
+  return id;
+}
+
+void RenderGraph::retain(PassId pass) {
+  m_passes[pass].retained = true;
+  m_compiled = false;
+}
+
+bool RenderGraph::isCulled(PassId pass) const {
+  return m_passes[pass].culled;
+}
+
+uint32_t RenderGraph::framebufferIndex(ResourceId target) const {
+  return m_targets[target].slot;
+}
+
+bool RenderGraph::compile() {
+  m_order.clear();
+  m_slots.clear();
+  m_compiled = false;
+
+  // Find the passes that contribute to the backbuffer or to retained passes, walking back from those passes.
+  std::vector<PassId> stack;
+  for (PassId id = 0; id < m_passes.size(); id++) {
+    auto& pass = m_passes[id];
+    pass.culled = !(pass.output == BACKBUFFER || pass.retained);
+    if (!pass.culled) {
+      stack.push_back(id);
+    }
+  }
+  while (!stack.empty()) {
+    auto& pass = m_passes[stack.back()];
+    stack.pop_back();
+    for (auto input : pass.inputs) {
+      assert(input != BACKBUFFER && input < m_targets.size());
+      uint32_t producer = m_targets[input].producer;
+      if (producer == NO_PASS) {
+        Log::ef("RenderGraph pass '%s' reads target '%s' which no pass writes\n", pass.name.c_str(),
+                m_targets[input].name.c_str());
+        return false;
+      }
+      if (m_passes[producer].culled) {
+        m_passes[producer].culled = false;
+        stack.push_back(producer);
+      }
+    }
+  }
+
+  // Count the dependencies of each pass; passes writing the backbuffer also depend on the previous such pass.
+  std::vector<uint32_t> dependencyCount(m_passes.size(), 0);
+  uint32_t previousBackbufferPass = NO_PASS;
+  size_t activeCount = 0;
+  for (PassId id = 0; id < m_passes.size(); id++) {
+    const auto& pass = m_passes[id];
+    if (pass.culled) {
+      continue;
+    }
+    activeCount++;
+    dependencyCount[id] = static_cast<uint32_t>(pass.inputs.size());
+    if (pass.output == BACKBUFFER) {
+      dependencyCount[id] += previousBackbufferPass != NO_PASS;
+      previousBackbufferPass = id;
+    }
+  }
+
+  // Repeatedly run the earliest added pass whose dependencies have all run, so independent passes keep the order
+  // they were added in.
+  std::vector<uint8_t> done(m_passes.size(), 0);
+  while (m_order.size() < activeCount) {
+    PassId next = NO_PASS;
+    for (PassId id = 0; id < m_passes.size(); id++) {
+      if (!m_passes[id].culled && !done[id] && dependencyCount[id] == 0) {
+        next = id;
+        break;
+      }
+    }
+    if (next == NO_PASS) {
+      Log::e("RenderGraph has a cycle");
+      m_order.clear();
+      return false;
+    }
+    done[next] = 1;
+    m_order.push_back(next);
+    const auto& output = m_passes[next].output;
+    for (PassId id = 0; id < m_passes.size(); id++) {
+      const auto& pass = m_passes[id];
+      if (pass.culled || done[id]) {
+        continue;
+      }
+      for (auto input : pass.inputs) {
+        dependencyCount[id] -= (input == output);
+      }
+      if (output == BACKBUFFER && pass.output == BACKBUFFER) {
+        // Only the next pass writing the backbuffer depends on this one.
+        dependencyCount[id]--;
+        break;
+      }
+    }
+  }
+
+  // Find the position of the last pass reading each target.
+  std::vector<uint32_t> lastUse(m_targets.size(), NO_PASS);
+  for (uint32_t position = 0; position < m_order.size(); position++) {
+    const auto& pass = m_passes[m_order[position]];
+    lastUse[pass.output] = position;
+    for (auto input : pass.inputs) {
+      lastUse[input] = position;
+    }
+  }
+
+  // Assign each target a Framebuffer slot when its pass runs and free the slot again after its last use.
+  std::vector<uint32_t> freeSlots;
+  for (uint32_t position = 0; position < m_order.size(); position++) {
+    const auto& pass = m_passes[m_order[position]];
+    if (pass.output != BACKBUFFER) {
+      auto& target = m_targets[pass.output];
+      auto it = freeSlots.begin();
+      for (; it != freeSlots.end(); ++it) {
+        const auto& other = m_targets[m_slots[*it]];
+        if (isCompatible(target.width, target.height, target.options, other.width, other.height, other.options)) {
+          break;
+        }
+      }
+      if (it != freeSlots.end()) {
+        target.slot = *it;
+        freeSlots.erase(it);
+      } else {
+        target.slot = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back(pass.output);
+      }
+    }
+    if (pass.output != BACKBUFFER && lastUse[pass.output] == position) {
+      freeSlots.push_back(m_targets[pass.output].slot);
+    }
+    for (auto input : pass.inputs) {
+      if (lastUse[input] == position) {
+        freeSlots.push_back(m_targets[input].slot);
+        // Don't free a slot twice when a pass reads the same target more than once.
+        lastUse[input] = NO_PASS;
+      }
+    }
+  }
+
+  m_compiled = true;
+  return true;
+}
+
+void RenderGraph::execute(RenderState& rs) {
+  STOCK_PROFILE_SCOPE("RenderGraph::execute");
+  if (!m_compiled && !compile()) {
+    return;
+  }
+  m_frame++;
+
+  // Assign a pooled Framebuffer to each slot, creating new ones as needed.
+  for (auto& entry : m_pool) {
+    entry.inUse = false;
+  }
+  m_slotEntries.assign(m_slots.size(), 0);
+  for (size_t slot = 0; slot < m_slots.size(); slot++) {
+    const auto& target = m_targets[m_slots[slot]];
+    size_t index = 0;
+    for (; index < m_pool.size(); index++) {
+      const auto& entry = m_pool[index];
+      const auto& framebuffer = *entry.framebuffer;
+      if (!entry.inUse && isCompatible(target.width, target.height, target.options, framebuffer.width(),
+                                       framebuffer.height(), framebuffer.options())) {
+        break;
+      }
+    }
+    if (index == m_pool.size()) {
+      PoolEntry entry;
+      entry.framebuffer.reset(new Framebuffer(target.width, target.height, target.options));
+      m_pool.push_back(std::move(entry));
+    }
+    m_pool[index].inUse = true;
+    m_pool[index].lastUsedFrame = m_frame;
+    m_slotEntries[slot] = index;
+  }
+
+  for (auto id : m_order) {
+    auto& pass = m_passes[id];
+    if (pass.output == BACKBUFFER) {
+      CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+      CHECK_GL(glViewport(0, 0, m_backbufferWidth, m_backbufferHeight));
+    } else {
+      auto& target = m_targets[pass.output];
+      framebuffer(pass.output).bind(rs, 0);
+      CHECK_GL(glViewport(0, 0, target.width, target.height));
+    }
+    if (pass.execute) {
+      pass.execute(rs, *this);
+    }
+    if (pass.output != BACKBUFFER) {
+      // Later passes can only read color and depth textures, so other buffers don't need to be stored.
+      auto& output = framebuffer(pass.output);
+      const auto& options = m_targets[pass.output].options;
+      output.discard(rs, (options.hasDepthTexture ? 0 : GL_DEPTH_BUFFER_BIT) | GL_STENCIL_BUFFER_BIT);
+      // Make multisampled rendering readable by later passes.
+      output.resolve(rs);
+    }
+  }
+  CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  CHECK_GL(glViewport(0, 0, m_backbufferWidth, m_backbufferHeight));
+
+  // Release Framebuffers that haven't been used for a while.
+  for (size_t index = 0; index < m_pool.size();) {
+    if (m_frame - m_pool[index].lastUsedFrame > POOL_RETENTION_FRAMES) {
+      m_pool[index].framebuffer->dispose(rs);
+      m_pool.erase(m_pool.begin() + index);
+    } else {
+      index++;
+    }
+  }
+}
+
+void RenderGraph::reset() {
+  m_targets.clear();
+  m_passes.clear();
+  m_order.clear();
+  m_slots.clear();
+  m_compiled = false;
+  Target backbuffer;
+  backbuffer.name = "backbuffer";
+  backbuffer.width = m_backbufferWidth;
+  backbuffer.height = m_backbufferHeight;
+  m_targets.push_back(backbuffer);
+}
+
+Framebuffer& RenderGraph::framebuffer(ResourceId target) {
+  assert(target != BACKBUFFER);
+  return *m_pool[m_slotEntries[m_targets[target].slot]].framebuffer;
+}
+
+Texture& RenderGraph::texture(ResourceId target) {
+  return framebuffer(target).colorTexture();
+}
+
+Texture& RenderGraph::depthTexture(ResourceId target) {
+  return framebuffer(target).depthTexture();
+}
+
+void RenderGraph::dispose(RenderState& rs) {
+  for (auto& entry : m_pool) {
+    entry.framebuffer->dispose(rs);
+  }
+  m_pool.clear();
+}
+
+} // namespace stock
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "gl/Framebuffer.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stock {
+
+class RenderState;
+
+// RenderGraph runs a frame as a set of passes that each render into one target and read any number of targets
+// written by other passes. Compiling the graph culls passes whose results are never used, orders the remaining
+// passes so that every target is written before it is read, and assigns targets to Framebuffers. A target is only
+// live from the pass that writes it to the last pass that reads it, so targets with the same size and format whose
+// lifetimes don't overlap share one Framebuffer.
+//
+// Framebuffers are kept in a pool across frames, so a graph that is rebuilt every frame reuses the same GL objects.
+
+class RenderGraph {
+
+public:
+  using ResourceId = uint32_t;
+  using PassId = uint32_t;
+  using ExecuteFunction = std::function<void(RenderState& rs, RenderGraph& graph)>;
+
+  // The default framebuffer; passes writing to it are never culled and run in the order they were added.
+  static constexpr ResourceId BACKBUFFER = 0;
+
+  // Number of frames a pooled Framebuffer is kept without being used before it is disposed.
+  static constexpr uint64_t POOL_RETENTION_FRAMES = 8;
+
+  RenderGraph();
+
+  ~RenderGraph();
+
+  // Set the size of the default framebuffer, used for the viewport of passes that write to it.
+  void setBackbufferSize(uint32_t width, uint32_t height);
+
+  // Declare a transient target; its contents are undefined until the pass writing it has run.
+  ResourceId createTarget(const std::string& name, uint32_t width, uint32_t height, Framebuffer::Options options);
+
+  // Add a pass that reads the 'inputs' and renders into 'output'; each target can be written by only one pass.
+  PassId addPass(const std::string& name, std::vector<ResourceId> inputs, ResourceId output, ExecuteFunction execute);
+
+  // Never cull a pass, e.g. because it reads pixels back from its target.
+  void retain(PassId pass);
+
+  // Cull and order the passes and assign targets to Framebuffers; returns false if the graph has a cycle or reads
+  // a target that no pass writes. This makes no GL calls.
+  bool compile();
+
+  // Run the passes in order, compiling the graph first if needed.
+  void execute(RenderState& rs);
+
+  // Remove all passes and targets, keeping pooled Framebuffers for the next frame.
+  void reset();
+
+  // Get the passes that will run, in order; valid after compile().
+  const std::vector<PassId>& order() const { return m_order; }
+
+  // Returns true if the pass will not run; valid after compile().
+  bool isCulled(PassId pass) const;
+
+  // Get the number of Framebuffers needed for the targets after aliasing; valid after compile().
+  size_t framebufferCount() const { return m_slots.size(); }
+
+  // Get the index of the Framebuffer assigned to a target; targets with the same index share a Framebuffer.
+  uint32_t framebufferIndex(ResourceId target) const;
+
+  // Get the Framebuffer, color texture, or depth texture of a target; valid only while the passes are executing.
+  Framebuffer& framebuffer(ResourceId target);
+  Texture& texture(ResourceId target);
+  Texture& depthTexture(ResourceId target);
+
+  // Release all pooled Framebuffers.
+  void dispose(RenderState& rs);
+
+private:
+  static constexpr uint32_t NO_PASS = UINT32_MAX;
+
+  struct Target {
+    std::string name;
+    uint32_t width;
+    uint32_t height;
+    Framebuffer::Options options;
+    uint32_t producer = NO_PASS;
+    uint32_t slot = 0;
+  };
+
+  struct Pass {
+    std::string name;
+    std::vector<ResourceId> inputs;
+    ResourceId output;
+    ExecuteFunction execute;
+    bool retained = false;
+    bool culled = true;
+  };
+
+  struct PoolEntry {
+    std::unique_ptr<Framebuffer> framebuffer;
+    uint64_t lastUsedFrame = 0;
+    bool inUse = false;
+  };
+
+  std::vector<Target> m_targets;
+  std::vector<Pass> m_passes;
+  std::vector<PassId> m_order;
+  // For each Framebuffer slot, the target whose size and format it uses.
+  std::vector<ResourceId> m_slots;
+  // For each Framebuffer slot, the pool entry assigned to it while executing.
+  std::vector<size_t> m_slotEntries;
+  std::vector<PoolEntry> m_pool;
+  uint32_t m_backbufferWidth = 0;
+  uint32_t m_backbufferHeight = 0;
+  uint64_t m_frame = 0;
+  bool m_compiled = false;
+};
+
+} // namespace stock
@@ -16,6 +16,7 @@ void RenderState::reset() {
   m_cullFace.set = false;
   m_culling.set = false;
   m_depthTest.set = false;
+  m_depthFunc.set = false;
   m_depthMask.set = false;
   m_frontFace.set = false;
   m_stencilTest.set = false;
@@ -28,9 +29,10 @@ void RenderState::reset() {
   m_textureUnit.set = false;
 
   attributeBindings.fill(0);
+  attributeDivisors.fill(0);
   textureBindings.fill(0);
 
-  CHECK_GL(glDepthFunc(GL_LESS));
+  depthFunc(GL_LESS);
 }
 
 inline void setGlFlag(GLenum flag, GLboolean enable) {
@@ -60,14 +62,28 @@ bool RenderState::blendEquation(GLenum mode) {
 }
 
 bool RenderState::blendFunc(GLenum sfactor, GLenum dfactor) {
-  if (!m_blendFunc.set || m_blendFunc.sfactor != sfactor || m_blendFunc.dfactor != dfactor) {
-    m_blendFunc = {sfactor, dfactor, true};
-    CHECK_GL(glBlendFunc(sfactor, dfactor));
+  return blendFuncSeparate(sfactor, dfactor, sfactor, dfactor);
+}
+
+bool RenderState::blendFuncSeparate(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha) {
+  if (!m_blendFunc.set || m_blendFunc.srcRgb != srcRgb || m_blendFunc.dstRgb != dstRgb ||
+      m_blendFunc.srcAlpha != srcAlpha || m_blendFunc.dstAlpha != dstAlpha) {
+    m_blendFunc = {srcRgb, dstRgb, srcAlpha, dstAlpha, true};
+    CHECK_GL(glBlendFuncSeparate(srcRgb, dstRgb, srcAlpha, dstAlpha));
     return false;
   }
   return true;
 }
 
+bool RenderState::blendState(const BlendState& state) {
+  bool unchanged = blending(state.enabled);
+  if (state.enabled) {
+    unchanged = blendEquation(state.equation) && unchanged;
+    unchanged = blendFuncSeparate(state.srcRgb, state.dstRgb, state.srcAlpha, state.dstAlpha) && unchanged;
+  }
+  return unchanged;
+}
+
 bool RenderState::clearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a) {
   if (!m_clearColor.set || m_clearColor.r != r || m_clearColor.g != g || m_clearColor.b != b || m_clearColor.a != a) {
     m_clearColor = {r, g, b, a, true};
@@ -113,6 +129,15 @@ bool RenderState::depthTest(GLboolean enable) {
   return true;
 }
 
+bool RenderState::depthFunc(GLenum func) {
+  if (!m_depthFunc.set || m_depthFunc.func != func) {
+    m_depthFunc = {func, true};
+    CHECK_GL(glDepthFunc(func));
+    return false;
+  }
+  return true;
+}
+
 bool RenderState::depthMask(GLboolean enable) {
   if (!m_depthMask.set || m_depthMask.enabled != enable) {
     m_depthMask = {enable, true};
@@ -16,6 +16,26 @@ public:
   // TODO: read max texture units from hardware
   static constexpr size_t MAX_COMBINED_TEXTURE_UNITS = 16;
 
+  // A complete blending configuration, to set with blendState() in one call.
+  struct BlendState {
+    GLboolean enabled;
+    GLenum equation;
+    GLenum srcRgb, dstRgb, srcAlpha, dstAlpha;
+
+    static BlendState opaque() { return {GL_FALSE, GL_FUNC_ADD, GL_ONE, GL_ZERO, GL_ONE, GL_ZERO}; }
+
+    // Blend colors that are not premultiplied by alpha over the destination, accumulating coverage in alpha.
+    static BlendState alpha() {
+      return {GL_TRUE, GL_FUNC_ADD, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA};
+    }
+
+    static BlendState premultipliedAlpha() {
+      return {GL_TRUE, GL_FUNC_ADD, GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA};
+    }
+
+    static BlendState additive() { return {GL_TRUE, GL_FUNC_ADD, GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE}; }
+  };
+
   RenderState() = default;
 
   // Disallow copying by construction and assignment.
@@ -31,6 +51,12 @@ public:
 
   bool blendFunc(GLenum sfactor, GLenum dfactor);
 
+  bool blendFuncSeparate(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha);
+
+  // Set blending, the blend equation, and the blend function; the equation and function are left unchanged when
+  // blending is disabled. Returns true if all of them were already set.
+  bool blendState(const BlendState& state);
+
   bool clearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a);
 
   bool colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a);
@@ -41,6 +67,8 @@ public:
 
   bool depthTest(GLboolean enable);
 
+  bool depthFunc(GLenum func);
+
   bool depthMask(GLboolean enable);
 
   bool frontFace(GLenum face);
@@ -78,6 +106,9 @@ public:
   // For each vertex attribute location, contains the GL program last used to bind the attribute or zero if unbound.
   std::array<GLuint, MAX_ATTRIBUTES> attributeBindings = {{0}};
 
+  // For each vertex attribute location, contains the instance divisor last set for the attribute.
+  std::array<GLuint, MAX_ATTRIBUTES> attributeDivisors = {{0}};
+
 private:
 
   std::array<GLuint, MAX_COMBINED_TEXTURE_UNITS> textureBindings = {{0}};
@@ -93,7 +124,12 @@ private:
   } m_blendEquation;
 
   struct {
-    GLenum sfactor, dfactor;
+    GLenum func;
+    bool set;
+  } m_depthFunc;
+
+  struct {
+    GLenum srcRgb, dstRgb, srcAlpha, dstAlpha;
     bool set;
   } m_blendFunc;
 
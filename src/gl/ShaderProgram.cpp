@@ -2,15 +2,24 @@
 // Created by Matt Blair on 4/2/16.
 //
 #include "gl/ShaderProgram.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "gl/DeletionQueue.hpp"
 #include "gl/Error.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 
 namespace stock {
 
+// Identifies each program object; programs may be created on any thread.
+static std::atomic<uint32_t> s_nextId(1);
+
+// Identifies each successful build, since GL program names are reused after deletion.
+static uint32_t s_nextSerial = 1;
+
 ShaderProgram::ShaderProgram(const std::string& fragmentShaderSource, const std::string& vertexShaderSource)
-    : m_fragmentShaderSource(fragmentShaderSource), m_vertexShaderSource(vertexShaderSource) {}
+    : m_fragmentShaderSource(fragmentShaderSource), m_vertexShaderSource(vertexShaderSource), m_id(s_nextId++) {}
 
 ShaderProgram::~ShaderProgram() {
   assert(m_glProgram == 0);
@@ -36,6 +45,19 @@ void ShaderProgram::dispose(RenderState& rs) {
     CHECK_GL(glDeleteShader(m_glVertexShader));
     m_glVertexShader = 0;
   }
+
+  m_needsBuild = true;
+}
+
+void ShaderProgram::dispose(DeletionQueue& queue) {
+
+  queue.enqueue(DeletionQueue::HandleType::PROGRAM, m_glProgram);
+  queue.enqueue(DeletionQueue::HandleType::SHADER, m_glFragmentShader);
+  queue.enqueue(DeletionQueue::HandleType::SHADER, m_glVertexShader);
+  m_glProgram = 0;
+  m_glFragmentShader = 0;
+  m_glVertexShader = 0;
+  m_needsBuild = true;
 }
 
 GLint ShaderProgram::getAttributeLocation(const std::string& name) {
@@ -59,14 +81,23 @@ GLint ShaderProgram::getAttributeLocation(const std::string& name) {
 
 GLint ShaderProgram::getUniformLocation(const UniformLocation& uniform) {
 
-  if (uniform.location >= -1) {
-    return uniform.location;
+  auto entry = std::find_if(uniform.locations.begin(), uniform.locations.end(),
+                            [this](const UniformLocation::Entry& e) { return e.programId == m_id; });
+  if (entry != uniform.locations.end() && entry->serial == m_serial) {
+    return entry->location;
   }
 
-  uniform.location = glGetUniformLocation(m_glProgram, uniform.name.c_str());
+  GLint location = glGetUniformLocation(m_glProgram, uniform.name.c_str());
   CHECK_GL();
+  if (entry != uniform.locations.end()) {
+    // The program was rebuilt, so its old location is replaced.
+    entry->serial = m_serial;
+    entry->location = location;
+  } else {
+    uniform.locations.push_back({m_id, m_serial, location});
+  }
 
-  return uniform.location;
+  return location;
 }
 
 GLuint ShaderProgram::getGlProgram() const {
@@ -100,6 +131,8 @@ bool ShaderProgram::use(RenderState& rs) {
 
 bool ShaderProgram::build(RenderState& rs) {
 
+  STOCK_PROFILE_SCOPE("ShaderProgram::build");
+
   m_needsBuild = false;
 
   // Try to compile vertex and fragment shaders, releasing resources and
@@ -139,10 +172,12 @@ bool ShaderProgram::build(RenderState& rs) {
   m_glFragmentShader = fragmentShader;
   m_glVertexShader = vertexShader;
   m_glProgram = program;
+  m_serial = s_nextSerial++;
 
-  // Clear any cached shader locations.
+  // Clear any cached shader locations and uniform values.
 
   m_attributes.fill("");
+  m_uniformCache.clear();
 
   return true;
 }
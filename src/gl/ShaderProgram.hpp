@@ -12,6 +12,7 @@
 
 namespace stock {
 
+class DeletionQueue;
 class RenderState;
 
 class ShaderProgram {
@@ -26,9 +27,18 @@ public:
   // keeps the program's previous state; if successful it returns true.
   bool build(RenderState& rs);
 
-  // Disposes the GL resources for this shader.
+  // Disposes the GL resources for this shader; the next call to use() builds it again.
   void dispose(RenderState& rs);
 
+  // Hand the GL resources for this shader to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
+  const std::string& getFragmentShaderSource() const { return m_fragmentShaderSource; }
+  const std::string& getVertexShaderSource() const { return m_vertexShaderSource; }
+
+  // Identifies this object for as long as it exists, unlike its address or its GL program name.
+  uint32_t getId() const { return m_id; }
+
   GLuint getGlProgram() const;
   GLuint getGlFragmentShader() const;
   GLuint getGlVertexShader() const;
@@ -79,6 +89,11 @@ private:
   GLuint m_glFragmentShader = 0;
   GLuint m_glVertexShader = 0;
 
+  uint32_t m_id = 0;
+
+  // Serial of the current build, which keys the locations cached in UniformLocation.
+  uint32_t m_serial = 0;
+
   bool m_needsBuild = true;
 
   GLuint makeLinkedShaderProgram(GLuint fragmentShader, GLuint vertexShader);
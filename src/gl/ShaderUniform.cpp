@@ -130,12 +130,12 @@ void ShaderUniform::deleteArrays() {
   switch (m_type) {
   case ValueType::ARRAY_INT:
     if (m_arrayInt != nullptr) {
-      delete m_arrayInt;
+      delete[] m_arrayInt;
     }
     break;
   case ValueType::ARRAY_FLOAT:
     if (m_arrayFloat != nullptr) {
-      delete m_arrayFloat;
+      delete[] m_arrayFloat;
     }
     break;
   default:
@@ -3,7 +3,9 @@
 //
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace stock {
 
@@ -15,9 +17,15 @@ public:
 private:
   const std::string name;
 
-  // Location values are > 0 for valid locations and -1 for errors.
-  // We set the initial value to none of these.
-  mutable int location = -2;
+  struct Entry {
+    uint32_t programId;
+    uint32_t serial;
+    int location;
+  };
+
+  // Location found in each program that the uniform was used with, as of the serial of the program's latest build.
+  // Location values are >= 0 for valid locations and -1 for errors.
+  mutable std::vector<Entry> locations;
 
   friend class ShaderProgram;
 };
@@ -0,0 +1,181 @@
+#include "gl/SpriteBatch.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "gl/RenderState.hpp"
+#include "gl/ShaderUniform.hpp"
+#include "gl/Texture.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace stock {
+
+constexpr size_t SpriteBatch::MAX_SPRITES_PER_DRAW;
+
+static const std::string vs_src = R"SHADER_END(
+attribute vec3 a_position;
+attribute vec2 a_uv;
+attribute vec4 a_color;
+varying vec2 v_uv;
+varying vec4 v_color;
+uniform mat4 u_mvp;
+void main() {
+    v_uv = a_uv;
+    v_color = a_color;
+    gl_Position = u_mvp * vec4(a_position, 1.);
+}
+)SHADER_END";
+static const std::string fs_src = R"SHADER_END(
+#ifdef GL_ES
+precision mediump float;
+#endif
+varying vec2 v_uv;
+varying vec4 v_color;
+uniform sampler2D u_texture;
+void main() {
+    gl_FragColor = texture2D(u_texture, v_uv) * v_color;
+}
+)SHADER_END";
+
+SpriteBatch::SpriteBatch() : m_shader(fs_src, vs_src), m_mvpMatrixLocation("u_mvp"), m_textureLocation("u_texture") {
+  m_mesh.setVertexLayout(VertexLayout({
+      VertexAttribute("a_position", 3, GL_FLOAT, GL_FALSE),
+      VertexAttribute("a_uv", 2, GL_FLOAT, GL_FALSE),
+      VertexAttribute("a_color", 4, GL_UNSIGNED_BYTE, GL_TRUE),
+  }));
+  m_mesh.setDrawMode(GL_TRIANGLES);
+}
+
+SpriteBatch::~SpriteBatch() = default;
+
+void SpriteBatch::setViewProjection(RenderState& rs, const glm::mat4& matrix) {
+  if (matrix != m_viewProjection) {
+    flush(rs);
+    m_viewProjection = matrix;
+  }
+}
+
+void SpriteBatch::draw(Texture& texture, const glm::mat4& transform, const glm::vec4& uvRect, uint32_t color,
+                       int32_t layer) {
+  auto p0 = transform * glm::vec4(0.f, 0.f, 0.f, 1.f);
+  auto p1 = transform * glm::vec4(1.f, 0.f, 0.f, 1.f);
+  auto p2 = transform * glm::vec4(1.f, 1.f, 0.f, 1.f);
+  auto p3 = transform * glm::vec4(0.f, 1.f, 0.f, 1.f);
+
+  m_sprites.push_back({&texture, layer, static_cast<uint32_t>(m_vertices.size())});
+  m_vertices.push_back({p0.x, p0.y, p0.z, uvRect.x, uvRect.y, color});
+  m_vertices.push_back({p1.x, p1.y, p1.z, uvRect.z, uvRect.y, color});
+  m_vertices.push_back({p2.x, p2.y, p2.z, uvRect.z, uvRect.w, color});
+  m_vertices.push_back({p3.x, p3.y, p3.z, uvRect.x, uvRect.w, color});
+  m_isSorted = false;
+}
+
+void SpriteBatch::draw(Texture& texture, const glm::vec2& position, const glm::vec2& size, const glm::vec4& uvRect,
+                       uint32_t color, int32_t layer) {
+  float x0 = position.x, y0 = position.y;
+  float x1 = position.x + size.x, y1 = position.y + size.y;
+
+  m_sprites.push_back({&texture, layer, static_cast<uint32_t>(m_vertices.size())});
+  m_vertices.push_back({x0, y0, 0.f, uvRect.x, uvRect.y, color});
+  m_vertices.push_back({x1, y0, 0.f, uvRect.z, uvRect.y, color});
+  m_vertices.push_back({x1, y1, 0.f, uvRect.z, uvRect.w, color});
+  m_vertices.push_back({x0, y1, 0.f, uvRect.x, uvRect.w, color});
+  m_isSorted = false;
+}
+
+size_t SpriteBatch::sort() {
+  if (m_isSorted) {
+    return m_batches.size();
+  }
+
+  // A stable sort keeps quads with the same layer and texture in the order they were queued.
+  std::stable_sort(m_sprites.begin(), m_sprites.end(), [](const Sprite& a, const Sprite& b) {
+    if (a.layer != b.layer) {
+      return a.layer < b.layer;
+    }
+    return std::less<Texture*>()(a.texture, b.texture);
+  });
+
+  m_sortedVertices.resize(m_vertices.size());
+  m_batches.clear();
+  for (size_t i = 0; i < m_sprites.size(); i++) {
+    const auto& sprite = m_sprites[i];
+    std::copy_n(&m_vertices[sprite.firstVertex], 4, &m_sortedVertices[i * 4]);
+
+    // Start a new batch when the texture changes or the quad can't be reached from the current draw's vertices.
+    bool startsDraw = i % MAX_SPRITES_PER_DRAW == 0;
+    if (startsDraw || m_batches.back().texture != sprite.texture) {
+      m_batches.push_back({sprite.texture, i, 0});
+    }
+    m_batches.back().spriteCount++;
+  }
+
+  m_isSorted = true;
+  return m_batches.size();
+}
+
+size_t SpriteBatch::flush(RenderState& rs) {
+
+  STOCK_PROFILE_SCOPE("SpriteBatch::flush");
+
+  m_drawCallCount = 0;
+  if (m_sprites.empty()) {
+    return 0;
+  }
+
+  sort();
+
+  if (!m_hasIndices) {
+    std::vector<uint16_t> indices(MAX_SPRITES_PER_DRAW * 6);
+    for (size_t i = 0; i < MAX_SPRITES_PER_DRAW; i++) {
+      auto v = static_cast<uint16_t>(i * 4);
+      uint16_t quad[] = {v, uint16_t(v + 1), uint16_t(v + 2), uint16_t(v + 2), uint16_t(v + 3), v};
+      std::copy_n(quad, 6, &indices[i * 6]);
+    }
+    m_mesh.uploadIndices(rs, indices.data(), indices.size(), GL_STATIC_DRAW);
+    m_hasIndices = true;
+  }
+
+  rs.blending(true);
+  rs.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  rs.culling(false);
+  m_shader.setUniformMatrix4f(rs, m_mvpMatrixLocation, m_viewProjection);
+  m_shader.setUniformi(rs, m_textureLocation, 0);
+
+  // Stream the quads in chunks that the shared indices can address; batches never cross a chunk.
+  size_t chunkStart = 0;
+  for (size_t i = 0; i < m_batches.size(); i++) {
+    const auto& batch = m_batches[i];
+    if (i == 0 || batch.firstSprite % MAX_SPRITES_PER_DRAW == 0) {
+      chunkStart = batch.firstSprite;
+      size_t chunkSize = std::min(MAX_SPRITES_PER_DRAW, m_sprites.size() - chunkStart);
+      m_mesh.uploadVertices(rs, &m_sortedVertices[chunkStart * 4], chunkSize * 4, GL_STREAM_DRAW);
+    }
+
+    batch.texture->prepare(rs, 0);
+    batch.texture->bind(rs, 0);
+
+    auto offset = reinterpret_cast<const void*>((batch.firstSprite - chunkStart) * 6 * sizeof(GLushort));
+    if (m_mesh.draw(rs, m_shader, batch.spriteCount * 6, offset)) {
+      m_drawCallCount++;
+    }
+  }
+
+  m_vertices.clear();
+  m_sprites.clear();
+  m_batches.clear();
+  m_isSorted = true;
+  return m_drawCallCount;
+}
+
+void SpriteBatch::dispose(RenderState& rs) {
+  m_mesh.dispose(rs);
+  m_shader.dispose(rs);
+  m_hasIndices = false;
+}
+
+void SpriteBatch::dispose(DeletionQueue& queue) {
+  m_mesh.dispose(queue);
+  m_shader.dispose(queue);
+  m_hasIndices = false;
+}
+
+} // namespace stock
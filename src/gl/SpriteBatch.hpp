@@ -0,0 +1,98 @@
+#pragma once
+
+#include "gl/Mesh.hpp"
+#include "gl/ShaderProgram.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace stock {
+
+class DeletionQueue;
+class RenderState;
+class Texture;
+
+// SpriteBatch draws many textured quads with a few draw calls. Quads are collected on the CPU, sorted by layer and
+// then by texture, and streamed into one vertex buffer when the batch is flushed; each run of quads with the same
+// texture is then drawn with a single call. All quads share one index buffer that is generated once.
+//
+// Quads in the same layer may be drawn in any order, so quads that overlap with blending should be put in different
+// layers. Layers are drawn in increasing order.
+
+class SpriteBatch {
+
+public:
+  struct Vertex {
+    float x, y, z;
+    float u, v;
+    uint32_t color;
+  };
+
+  // Largest number of quads that can be addressed by one draw call with 16-bit indices.
+  static constexpr size_t MAX_SPRITES_PER_DRAW = 65536 / 4;
+
+  SpriteBatch();
+
+  ~SpriteBatch();
+
+  // Set the matrix that transforms quads into clip space; queued quads are flushed first if the matrix changes.
+  void setViewProjection(RenderState& rs, const glm::mat4& matrix);
+
+  // Queue a quad covering the unit square from (0, 0) to (1, 1), transformed by 'transform'. 'uvRect' holds the
+  // texture coordinates of the (0, 0) and (1, 1) corners and 'color' is an ABGR color multiplied with the texture.
+  // The texture must stay alive until the batch is flushed.
+  void draw(Texture& texture, const glm::mat4& transform, const glm::vec4& uvRect = glm::vec4(0.f, 0.f, 1.f, 1.f),
+            uint32_t color = 0xffffffff, int32_t layer = 0);
+
+  // Queue an axis-aligned quad in the z = 0 plane with its lower-left corner at 'position'.
+  void draw(Texture& texture, const glm::vec2& position, const glm::vec2& size,
+            const glm::vec4& uvRect = glm::vec4(0.f, 0.f, 1.f, 1.f), uint32_t color = 0xffffffff, int32_t layer = 0);
+
+  // Get the number of queued quads.
+  size_t size() const { return m_sprites.size(); }
+
+  // Sort the queued quads into batches without drawing them; returns the number of draw calls that flush() will make.
+  size_t sort();
+
+  // Draw all queued quads and clear the queue; returns the number of draw calls made.
+  size_t flush(RenderState& rs);
+
+  // Get the number of draw calls made by the last flush().
+  size_t drawCallCount() const { return m_drawCallCount; }
+
+  // Release all OpenGL resources for this SpriteBatch.
+  void dispose(RenderState& rs);
+
+  // Hand all OpenGL resources for this SpriteBatch to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
+private:
+  struct Sprite {
+    Texture* texture;
+    int32_t layer;
+    uint32_t firstVertex;
+  };
+
+  struct Batch {
+    Texture* texture;
+    size_t firstSprite;
+    size_t spriteCount;
+  };
+
+  std::vector<Vertex> m_vertices;
+  std::vector<Vertex> m_sortedVertices;
+  std::vector<Sprite> m_sprites;
+  std::vector<Batch> m_batches;
+  glm::mat4 m_viewProjection;
+  MeshBase m_mesh;
+  ShaderProgram m_shader;
+  UniformLocation m_mvpMatrixLocation;
+  UniformLocation m_textureLocation;
+  size_t m_drawCallCount = 0;
+  bool m_isSorted = true;
+  bool m_hasIndices = false;
+};
+
+} // namespace stock
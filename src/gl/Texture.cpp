@@ -2,6 +2,7 @@
 // Created by Matt Blair on 7/30/16.
 //
 
+#include "gl/DeletionQueue.hpp"
 #include "gl/Error.hpp"
 #include "gl/Texture.hpp"
 #include "gl/RenderState.hpp"
@@ -24,7 +25,7 @@ Texture::~Texture() {
 
 uint32_t Texture::width() const { return m_pixmap.width(); }
 
-uint32_t Texture::height() const { return m_pixmap.width(); }
+uint32_t Texture::height() const { return m_pixmap.height(); }
 
 GLuint Texture::glHandle() const { return m_glHandle; }
 
@@ -72,4 +73,12 @@ void Texture::dispose(RenderState& rs) {
   m_pixmap.dispose();
 }
 
+void Texture::dispose(DeletionQueue& queue) {
+
+  queue.enqueue(DeletionQueue::HandleType::TEXTURE, m_glHandle);
+  m_glHandle = 0;
+
+  m_pixmap.dispose();
+}
+
 } // namespace stock
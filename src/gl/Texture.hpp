@@ -9,6 +9,7 @@
 
 namespace stock {
 
+class DeletionQueue;
 class RenderState;
 
 class Texture {
@@ -70,6 +71,9 @@ public:
   // Delete any OpenGL resources for the Texture.
   void dispose(RenderState& rs);
 
+  // Hand any OpenGL resources for the Texture to a deletion queue; this may be called from any thread.
+  void dispose(DeletionQueue& queue);
+
 protected:
 
   // Source pixel data
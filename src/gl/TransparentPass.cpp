@@ -0,0 +1,177 @@
+#include "gl/TransparentPass.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "view/Camera.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STOCK_TRANSPARENCY_SSE
+#endif
+
+namespace stock {
+
+// Insertion sort may move items this many times per item before falling back to a radix sort.
+static constexpr size_t INSERTION_MOVES_PER_ITEM = 4;
+
+// Map a float to an unsigned integer with the same order: flip all bits of negative values, and only the sign bit of
+// the others.
+static inline uint32_t floatToKey(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint32_t mask = static_cast<uint32_t>(-static_cast<int32_t>(bits >> 31)) | 0x80000000u;
+  return bits ^ mask;
+}
+
+TransparentPass::TransparentPass() : TransparentPass(Options()) {}
+
+TransparentPass::TransparentPass(Options options) : m_options(options) {}
+
+void TransparentPass::submit(const glm::vec3& position, uint32_t item) {
+  m_items.push_back(item);
+  m_x.push_back(position.x);
+  m_y.push_back(position.y);
+  m_z.push_back(position.z);
+}
+
+void TransparentPass::computeDepthKeys(const glm::mat4& viewMatrix, const float* x, const float* y, const float* z,
+                                       size_t count, uint32_t* keys) {
+  // Only the z row of the view matrix is needed.
+  float mx = viewMatrix[0][2], my = viewMatrix[1][2], mz = viewMatrix[2][2], mw = viewMatrix[3][2];
+  size_t i = 0;
+#if defined(STOCK_TRANSPARENCY_SSE)
+  __m128 rx = _mm_set1_ps(mx), ry = _mm_set1_ps(my), rz = _mm_set1_ps(mz), rw = _mm_set1_ps(mw);
+  __m128i signBit = _mm_set1_epi32(static_cast<int>(0x80000000u));
+  for (; i + 4 <= count; i += 4) {
+    __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, _mm_loadu_ps(x + i)), _mm_mul_ps(ry, _mm_loadu_ps(y + i))),
+                              _mm_add_ps(_mm_mul_ps(rz, _mm_loadu_ps(z + i)), rw));
+    __m128i bits = _mm_castps_si128(depth);
+    __m128i mask = _mm_or_si128(_mm_srai_epi32(bits, 31), signBit);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i), _mm_xor_si128(bits, mask));
+  }
+#endif
+  for (; i < count; i++) {
+    keys[i] = floatToKey(mx * x[i] + my * y[i] + (mz * z[i] + mw));
+  }
+}
+
+void TransparentPass::sort(const Camera& camera) {
+  sort(camera.viewMatrix());
+}
+
+void TransparentPass::sort(const glm::mat4& viewMatrix) {
+
+  STOCK_PROFILE_SCOPE("TransparentPass::sort");
+
+  size_t count = m_items.size();
+  m_keys.resize(count);
+  computeDepthKeys(viewMatrix, m_x.data(), m_y.data(), m_z.data(), count, m_keys.data());
+
+  // Start from the previous order if the same items were submitted, and otherwise from submission order.
+  bool isCoherent = m_items == m_previousItems && m_order.size() == count;
+  if (!isCoherent) {
+    m_order.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      m_order[i] = static_cast<uint32_t>(i);
+    }
+  }
+
+  // A small camera movement leaves each item only a few places from where it belongs. The number of out-of-order
+  // neighbors says little about that, since it nears one in two items after any movement, so insertion sort is tried
+  // and abandoned once it has made too many moves.
+  size_t moves = 0;
+  if (isCoherent && insertionSort(moves)) {
+    m_lastSortMethod = moves == 0 ? SortMethod::NONE : SortMethod::INSERTION;
+  } else {
+    radixSort();
+    m_lastSortMethod = SortMethod::RADIX;
+  }
+
+  m_sortedItems.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    m_sortedItems[i] = m_items[m_order[i]];
+  }
+}
+
+bool TransparentPass::insertionSort(size_t& moves) {
+  size_t budget = m_order.size() * INSERTION_MOVES_PER_ITEM;
+  for (size_t i = 1; i < m_order.size(); i++) {
+    uint32_t index = m_order[i];
+    uint32_t key = m_keys[index];
+    size_t j = i;
+    for (; j > 0 && m_keys[m_order[j - 1]] > key; j--) {
+      if (moves++ == budget) {
+        // Leave the order valid; the radix sort doesn't depend on where it starts.
+        m_order[j] = index;
+        return false;
+      }
+      m_order[j] = m_order[j - 1];
+    }
+    m_order[j] = index;
+  }
+  return true;
+}
+
+void TransparentPass::radixSort() {
+  size_t count = m_order.size();
+  if (count < 2) {
+    return;
+  }
+  m_sortKeys.resize(count);
+  m_sortKeysTemp.resize(count);
+  m_orderTemp.resize(count);
+
+  // Count all four digits in one pass over the keys.
+  std::array<std::array<uint32_t, 256>, 4> histograms{};
+  for (size_t i = 0; i < count; i++) {
+    uint32_t key = m_keys[m_order[i]];
+    m_sortKeys[i] = key;
+    for (int digit = 0; digit < 4; digit++) {
+      histograms[digit][(key >> (digit * 8)) & 0xff]++;
+    }
+  }
+
+  // Sort stably by each byte from the least significant, skipping bytes that are the same in all keys.
+  for (int digit = 0; digit < 4; digit++) {
+    auto& histogram = histograms[digit];
+    int shift = digit * 8;
+    if (histogram[(m_sortKeys[0] >> shift) & 0xff] == count) {
+      continue;
+    }
+    uint32_t offset = 0;
+    for (auto& bucket : histogram) {
+      uint32_t size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+    for (size_t i = 0; i < count; i++) {
+      uint32_t key = m_sortKeys[i];
+      uint32_t destination = histogram[(key >> shift) & 0xff]++;
+      m_sortKeysTemp[destination] = key;
+      m_orderTemp[destination] = m_order[i];
+    }
+    m_sortKeys.swap(m_sortKeysTemp);
+    m_order.swap(m_orderTemp);
+  }
+}
+
+void TransparentPass::draw(RenderState& rs, const DrawFunction& draw) {
+  rs.blendState(m_options.blend);
+  rs.depthTest(m_options.depthTest);
+  rs.depthMask(false);
+  for (auto item : m_sortedItems) {
+    draw(rs, item);
+  }
+  rs.depthMask(true);
+}
+
+void TransparentPass::clear() {
+  m_previousItems.swap(m_items);
+  m_items.clear();
+  m_x.clear();
+  m_y.clear();
+  m_z.clear();
+  m_sortedItems.clear();
+}
+
+} // namespace stock
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "gl/RenderState.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace stock {
+
+class Camera;
+
+// TransparentPass draws translucent items back to front. Items are submitted each frame with a position and an ID,
+// sorted by their view-space depth, and then drawn in order through a callback with depth writes disabled.
+//
+// Depths are computed several items at a time with SIMD and sorted as 32-bit integer keys with a radix sort. When
+// the same items are submitted as in the previous frame, sorting starts from the previous order: a camera that moved a
+// little leaves the order sorted or nearly so, which a bounded insertion sort fixes in about one pass.
+
+class TransparentPass {
+
+public:
+  using DrawFunction = std::function<void(RenderState& rs, uint32_t item)>;
+
+  struct Options {
+    RenderState::BlendState blend = RenderState::BlendState::alpha();
+    // Test depth against opaque geometry drawn before; depth is never written.
+    bool depthTest = true;
+  };
+
+  // How the last call to sort() ordered the items.
+  enum class SortMethod : uint8_t {
+    // The order of the previous frame was still sorted.
+    NONE,
+    INSERTION,
+    RADIX,
+  };
+
+  TransparentPass();
+
+  explicit TransparentPass(Options options);
+
+  // Add an item to draw in this frame; 'item' is passed to the draw function.
+  void submit(const glm::vec3& position, uint32_t item);
+
+  // Sort the submitted items from the farthest to the nearest along the view direction.
+  void sort(const Camera& camera);
+  void sort(const glm::mat4& viewMatrix);
+
+  // Set the blend state, disable depth writes, and call 'draw' for each item in sorted order. Depth writes are enabled
+  // again afterward.
+  void draw(RenderState& rs, const DrawFunction& draw);
+
+  // Remove the submitted items for the next frame, keeping their order to start the next sort from.
+  void clear();
+
+  // Get the submitted items in sorted order; valid after sort().
+  const std::vector<uint32_t>& order() const { return m_sortedItems; }
+
+  size_t size() const { return m_items.size(); }
+
+  SortMethod lastSortMethod() const { return m_lastSortMethod; }
+
+  void setOptions(const Options& options) { m_options = options; }
+  const Options& options() const { return m_options; }
+
+  // Compute sort keys for 'count' positions given as arrays of coordinates. Keys are the view-space z coordinates
+  // mapped to unsigned integers with the same order, so sorting them in ascending order sorts back to front.
+  static void computeDepthKeys(const glm::mat4& viewMatrix, const float* x, const float* y, const float* z,
+                               size_t count, uint32_t* keys);
+
+private:
+  // Sort m_order by the keys, starting from its current order.
+  void radixSort();
+
+  // Try to finish sorting m_order by insertion, counting the moves made; returns false if that would take too many.
+  bool insertionSort(size_t& moves);
+
+  Options m_options;
+
+  // Submitted items and their positions, in submission order.
+  std::vector<uint32_t> m_items;
+  std::vector<float> m_x, m_y, m_z;
+  std::vector<uint32_t> m_keys;
+
+  // Indices of submitted items in sorted order.
+  std::vector<uint32_t> m_order;
+  std::vector<uint32_t> m_sortedItems;
+
+  // Items submitted in the previous frame, whose sorted order is still in m_order.
+  std::vector<uint32_t> m_previousItems;
+
+  // Scratch buffers for the radix sort.
+  std::vector<uint32_t> m_sortKeys, m_sortKeysTemp, m_orderTemp;
+
+  SortMethod m_lastSortMethod = SortMethod::NONE;
+};
+
+} // namespace stock
@@ -10,14 +10,16 @@ namespace stock {
 
 struct VertexAttribute {
 
-  VertexAttribute(std::string name, GLint size, GLenum type, GLboolean normalized)
-      : name(name), offset(0), size(size), type(type), normalized(normalized) {}
+  VertexAttribute(std::string name, GLint size, GLenum type, GLboolean normalized, GLuint divisor = 0)
+      : name(name), offset(0), size(size), type(type), normalized(normalized), divisor(divisor) {}
 
   std::string name;
   size_t offset;
   GLint size;
   GLenum type;
   GLboolean normalized;
+  // Number of instances drawn before advancing to the next value, or 0 to advance per vertex.
+  GLuint divisor;
 };
 
 } // namespace stock
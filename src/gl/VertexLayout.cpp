@@ -3,6 +3,7 @@
 //
 #include "gl/VertexLayout.hpp"
 #include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
 #include "gl/RenderState.hpp"
 #include "gl/ShaderProgram.hpp"
 
@@ -61,6 +62,12 @@ void VertexLayout::enable(RenderState& rs, ShaderProgram& program, size_t offset
 
       void* data = reinterpret_cast<void*>(a.offset + offset);
       CHECK_GL(glVertexAttribPointer(location, a.size, a.type, a.normalized, m_stride, data));
+
+      GLuint& divisor = rs.attributeDivisors[location];
+      if (divisor != a.divisor && Extensions::instancedArrays) {
+        CHECK_GL(glVertexAttribDivisorANGLE(location, a.divisor));
+        divisor = a.divisor;
+      }
     }
   }
 
@@ -3,6 +3,7 @@
 //
 
 #include "io/UrlSession.hpp"
+#include "debug/CpuProfiler.hpp"
 #include "io/Log.hpp"
 #include <cassert>
 #include <cstring>
@@ -117,6 +118,7 @@ void UrlSession::curlLoop(uint32_t index) {
   assert(m_tasks.size() > index);
   Task& task = m_tasks[index];
   Log::vf("curlLoop %u starting\n", index);
+  STOCK_PROFILE_THREAD("curlLoop " + std::to_string(index));
   // Create a buffer for curl error messages.
   char curlErrorString[CURL_ERROR_SIZE];
   // Set up an easy handle for reuse.
@@ -152,6 +154,7 @@ void UrlSession::curlLoop(uint32_t index) {
       }
     }
     if (haveRequest) {
+      STOCK_PROFILE_SCOPE("UrlSession::request");
       // Configure the easy handle.
       const char* url = task.request.url.data();
       curl_easy_setopt(handle, CURLOPT_URL, url);
@@ -173,6 +176,7 @@ void UrlSession::curlLoop(uint32_t index) {
         task.response.successful = false;
       }
       if (task.request.callback) {
+        STOCK_PROFILE_SCOPE("UrlSession::callback");
         Log::vf("curlLoop %u performing request callback\n", index);
         task.request.callback(task.response);
       }
@@ -1,13 +1,25 @@
 #define GLFW_INCLUDE_NONE
+#include "debug/CpuProfiler.hpp"
 #include "debug/DebugDraw.hpp"
+#include "debug/GpuProfiler.hpp"
+#include "gl/DeletionQueue.hpp"
+#include "gl/DepthPrepass.hpp"
+#include "gl/DynamicResolution.hpp"
 #include "gl/Error.hpp"
+#include "gl/Extensions.hpp"
+#include "gl/Framebuffer.hpp"
+#include "gl/HeadlessContext.hpp"
 #include "gl/Mesh.hpp"
+#include "gl/ReadbackQueue.hpp"
 #include "gl/RenderState.hpp"
 #include "gl/ShaderProgram.hpp"
 #include "io/UrlSession.hpp"
 #include "view/Camera.hpp"
+#include "FramePacer.hpp"
 #include "ImGuiImpl.hpp"
+#include "MainLoop.hpp"
 #include <GLFW/glfw3.h>
+#include <cstring>
 
 using namespace stock;
 
@@ -23,6 +35,9 @@ void main() {
 )SHADER_END";
 
 const std::string fs_src = R"SHADER_END(
+#ifdef GL_ES
+precision mediump float;
+#endif
 varying vec4 v_color;
 void main() {
     gl_FragColor = v_color;
@@ -34,7 +49,93 @@ struct Vertex {
   unsigned int color;
 };
 
-int main(void) {
+static void setupMesh(Mesh<Vertex>& mesh) {
+  mesh.setVertexLayout(VertexLayout({
+      VertexAttribute("a_position", 3, GL_FLOAT, GL_FALSE),
+      VertexAttribute("a_color", 4, GL_UNSIGNED_BYTE, GL_TRUE),
+  }));
+  mesh.vertices = {
+      {1.f, 1.f, 1.f, 0xff000000},
+      {-1.f, 1.f, -1.f, 0xffff0000},
+      {1.f, -1.f, -1.f, 0xff00ff00},
+      {-1.f, -1.f, 1.f, 0xff0000ff},
+  };
+  mesh.indices = {0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3};
+}
+
+// Render the scene once into a Framebuffer without a window and write it to a PNG file.
+static int renderHeadless(const char* path) {
+
+  Log::setLevel(Log::Level::DEBUGGING);
+
+  HeadlessContext context;
+  if (!context.create()) {
+    return -1;
+  }
+
+  gladLoadGLES2Loader(context.loader());
+  Extensions::load(context.loader());
+
+  const uint32_t width = 1024, height = 768;
+
+  RenderState rs;
+  rs.reset();
+  rs.clearColor(0.f, 0.f, 0.f, 1.f);
+  rs.culling(true);
+  rs.cullFace(GL_BACK);
+  rs.depthTest(true);
+  rs.blending(false);
+  rs.scissorTest(false);
+
+  ShaderProgram shader(fs_src, vs_src);
+  UniformLocation mvpMatrixLocation("u_mvp");
+
+  Mesh<Vertex> mesh;
+  setupMesh(mesh);
+
+  Camera camera(width, height, Camera::Options());
+  camera.transform().position() = { 3.f, 0.f, 0.f };
+  camera.lookAt({0.f, 0.f, 0.f});
+
+  Framebuffer::Options framebufferOptions;
+  framebufferOptions.hasDepth = true;
+  Framebuffer framebuffer(width, height, framebufferOptions);
+  framebuffer.bind(rs, 0);
+  CHECK_GL(glViewport(0, 0, width, height));
+  CHECK_GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+  shader.setUniformMatrix4f(rs, mvpMatrixLocation, camera.viewProjectionMatrix());
+  mesh.draw(rs, shader);
+
+  bool success = false;
+  ReadbackQueue readbackQueue;
+  auto ticket = framebuffer.readPixels(rs, readbackQueue, [&](ReadbackQueue::Ticket, Pixmap pixmap) {
+    success = pixmap.writePng(path);
+    pixmap.dispose();
+  });
+  while (readbackQueue.isPending(ticket)) {
+    readbackQueue.poll();
+  }
+
+  if (success) {
+    Log::df("Wrote image to %s\n", path);
+  } else {
+    Log::ef("Unable to write image to %s\n", path);
+  }
+
+  readbackQueue.dispose(rs);
+  framebuffer.dispose(rs);
+  shader.dispose(rs);
+  mesh.dispose(rs);
+  context.dispose();
+  return success ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+
+  if (argc == 3 && std::strcmp(argv[1], "--headless") == 0) {
+    return renderHeadless(argv[2]);
+  }
 
   GLFWwindow* window;
 
@@ -54,6 +155,7 @@ int main(void) {
   glfwMakeContextCurrent(window);
 
   gladLoadGLES2Loader((GLADloadproc)glfwGetProcAddress);
+  Extensions::load((GLADloadproc)glfwGetProcAddress);
 
   // Setup ImGui binding
   ImGui::CreateContext();
@@ -69,17 +171,7 @@ int main(void) {
   UniformLocation mvpMatrixLocation("u_mvp");
 
   Mesh<Vertex> mesh;
-  mesh.setVertexLayout(VertexLayout({
-      VertexAttribute("a_position", 3, GL_FLOAT, GL_FALSE),
-      VertexAttribute("a_color", 4, GL_UNSIGNED_BYTE, GL_TRUE),
-  }));
-  mesh.vertices = {
-      {1.f, 1.f, 1.f, 0xff000000},
-      {-1.f, 1.f, -1.f, 0xffff0000},
-      {1.f, -1.f, -1.f, 0xff00ff00},
-      {-1.f, -1.f, 1.f, 0xff0000ff},
-  };
-  mesh.indices = {0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3};
+  setupMesh(mesh);
 
   RenderState rs;
   rs.reset();
@@ -91,21 +183,60 @@ int main(void) {
 
   Log::setLevel(Log::Level::DEBUGGING);
 
+  MainLoop mainLoop(window, MainLoop::Options());
+
+  // With vsync, pace frames to the monitor's refresh rate and start each one as late as it can be to finish on time,
+  // so that camera input is fresh when the scene is drawn. Without vsync, frames start as soon as possible.
+  const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+  double refreshRate = videoMode ? videoMode->refreshRate : 60.;
+  FramePacer::Options framePacerOptions;
+  framePacerOptions.targetFrameRate = refreshRate;
+  FramePacer framePacer(framePacerOptions);
+  mainLoop.setFramePacer(&framePacer);
+
   UrlSession urlSession({});
-  urlSession.addRequest("http://vector.mapzen.com/osm/all/16/17583/24208.json", [](UrlSession::Response response) {
+  urlSession.addRequest("http://vector.mapzen.com/osm/all/16/17583/24208.json", [&](UrlSession::Response response) {
+    STOCK_PROFILE_SCOPE("Response");
     Log::df("Received URL response! Data length: %d\n", response.data.size());
+    mainLoop.requestRedraw();
   });
 
+  GpuProfiler gpuProfiler;
+
+  // Delete GL objects replaced mid-session once the frames that used them have finished on the GPU.
+  DeletionQueue deletionQueue;
+
+  // Render the scene at a resolution that keeps the GPU frame time under budget.
+  DynamicResolution dynamicResolution;
+  dynamicResolution.setDeletionQueue(&deletionQueue);
+  bool isDynamicResolution = false;
+
+  // Lay down depth before shading, so that overlapping geometry is only shaded once per pixel.
+  DepthPrepass depthPrepass;
+  bool isDepthPrepass = false;
+
   bool isPaused = false;
 
+  bool isContinuous = mainLoop.isContinuous();
+
+  bool isVsync = true;
+  glfwSwapInterval(1);
+
+  // Redraw the UI only when it changes, and otherwise composite it from a texture.
+  bool isUiCached = true;
+  ImGuiImpl::SetCachedRendering(isUiCached);
+
   glm::dvec2 mousePosition;
 
-  // Loop until the user closes the window.
-  while (!glfwWindowShouldClose(window)) {
+  STOCK_PROFILE_THREAD("main");
+
+  // Draw frames when something changes, until the user closes the window.
+  mainLoop.run([&]() {
+
+    STOCK_PROFILE_SCOPE("Frame");
 
-    // Poll for and process events.
-    glfwPollEvents();
     ImGuiImpl::NewFrame(rs);
+    gpuProfiler.beginFrame();
 
     // Create ImGui interface.
     ImGui::Text("Hello, world!");
@@ -113,7 +244,40 @@ int main(void) {
 
     ImGui::Checkbox("Pause", &isPaused);
 
+    if (ImGui::Checkbox("Redraw continuously", &isContinuous)) {
+      mainLoop.setContinuous(isContinuous);
+    }
+
+    if (ImGui::Checkbox("Vsync", &isVsync)) {
+      glfwSwapInterval(isVsync ? 1 : 0);
+      framePacerOptions = framePacer.options();
+      framePacerOptions.targetFrameRate = isVsync ? refreshRate : 0.;
+      framePacer.setOptions(framePacerOptions);
+    }
+
+    ImGui::Checkbox("Dynamic resolution", &isDynamicResolution);
+    if (isDynamicResolution) {
+      ImGui::SameLine();
+      ImGui::Text("%.0f%% (%ux%u)", dynamicResolution.scale() * 100.f, dynamicResolution.renderWidth(),
+                  dynamicResolution.renderHeight());
+    }
+
+    ImGui::Checkbox("Depth pre-pass", &isDepthPrepass);
+
+    if (ImGui::Checkbox("Cache UI", &isUiCached)) {
+      ImGuiImpl::SetCachedRendering(isUiCached);
+    }
+
+    framePacer.drawPanel();
+    gpuProfiler.drawPanel();
+    CpuProfiler::drawFlameView();
+    if (ImGui::Button("Save Trace")) {
+      CpuProfiler::writeChromeTrace("trace.json");
+    }
+
     // Render here.
+    gpuProfiler.pushScope("Scene");
+    STOCK_PROFILE_SCOPE("Render");
     rs.culling(true);
     rs.cullFace(GL_BACK);
     rs.depthTest(true);
@@ -122,11 +286,30 @@ int main(void) {
 
     CHECK_GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
+    if (isDynamicResolution) {
+      int width, height;
+      glfwGetFramebufferSize(window, &width, &height);
+      dynamicResolution.bind(rs, width, height);
+      CHECK_GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    }
+
+    // ImGui::ShowDemoWindow();
 
+    if (ImGui::TreeNode("Camera Transform")) {
+      auto position = camera.transform().position();
+      auto direction = camera.transform().getDirection();
+      ImGui::InputFloat3("Position", &position.x, 4);
+      ImGui::InputFloat3("Direction", &direction.x, 4);
+      ImGui::TreePop();
+    }
+
+    // Sample input and update the camera just before drawing, to keep the latency of camera controls low.
     static const glm::vec3 point = {0.f, 0.f, 0.f}, axis = {0.f, 0.f, 1.f};
     if (!isPaused) {
       camera.transform().orbit(point, axis, 0.016f);
       camera.transform().lookAt(point);
+      // Keep animating.
+      mainLoop.requestRedraw();
     }
 
     glm::dvec2 lastMousePosition = mousePosition;
@@ -143,25 +326,27 @@ int main(void) {
       }
     }
 
-    // ImGui::ShowDemoWindow();
+    depthPrepass.setEnabled(isDepthPrepass);
+    depthPrepass.render(rs, [&](RenderState& rs, DepthPrepass& prepass) {
+      auto& program = prepass.program(shader);
+      program.setUniformMatrix4f(rs, mvpMatrixLocation, camera.viewProjectionMatrix());
+      mesh.draw(rs, program);
+    });
 
-    if (ImGui::TreeNode("Camera Transform")) {
-      auto position = camera.transform().position();
-      auto direction = camera.transform().getDirection();
-      ImGui::InputFloat3("Position", &position.x, 4);
-      ImGui::InputFloat3("Direction", &direction.x, 4);
-      ImGui::TreePop();
+    // Upscale the scene, then draw debug shapes and UI at native resolution.
+    if (isDynamicResolution) {
+      dynamicResolution.present(rs);
     }
-    shader.setUniformMatrix4f(rs, mvpMatrixLocation, camera.viewProjectionMatrix());
 
-    mesh.draw(rs, shader);
+    gpuProfiler.popScope();
+    gpuProfiler.pushScope("DebugDraw");
 
     DebugDraw::cameraMatrix(camera.viewProjectionMatrix());
-    DebugDraw::point(rs, {1.f, 0.f, 0.f});
-    DebugDraw::point(rs, {0.f, 1.f, 0.f});
-    DebugDraw::point(rs, {0.f, 0.f, 1.f});
+    DebugDraw::point({1.f, 0.f, 0.f});
+    DebugDraw::point({0.f, 1.f, 0.f});
+    DebugDraw::point({0.f, 0.f, 1.f});
 
-    DebugDraw::linestring(rs, {
+    DebugDraw::linestring({
       { 1.f, -1.f, -1.f},
       { 1.f,  1.f, -1.f},
       {-1.f,  1.f, -1.f},
@@ -169,19 +354,46 @@ int main(void) {
       { 1.f, -1.f, -1.f},
     });
 
+    DebugDraw::flush(rs);
+
+    gpuProfiler.popScope();
+
     // Render ImGui interface.
-    ImGui::Render();
-    ImGuiImpl::RenderDrawData(rs, ImGui::GetDrawData());
+    {
+      STOCK_PROFILE_SCOPE("ImGui");
+      GpuProfiler::Scope scope(gpuProfiler, "ImGui");
+      ImGui::Render();
+      ImGuiImpl::RenderDrawData(rs, ImGui::GetDrawData());
+    }
+
+    gpuProfiler.endFrame();
+    framePacer.endFrame(gpuProfiler.frameMilliseconds());
+    if (isDynamicResolution) {
+      dynamicResolution.update(gpuProfiler.frameMilliseconds());
+    }
 
     // Swap front and back buffers.
-    glfwSwapBuffers(window);
-  }
+    {
+      STOCK_PROFILE_SCOPE("Swap");
+      glfwSwapBuffers(window);
+    }
+
+    deletionQueue.endFrame(rs);
+  });
 
   shader.dispose(rs);
   mesh.dispose(rs);
 
   DebugDraw::dispose(rs);
 
+  gpuProfiler.dispose(rs);
+
+  dynamicResolution.dispose(rs);
+
+  depthPrepass.dispose(rs);
+
+  deletionQueue.dispose(rs);
+
   ImGuiImpl::Shutdown(rs);
 
   glfwTerminate();
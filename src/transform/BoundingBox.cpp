@@ -0,0 +1,61 @@
+#include "transform/BoundingBox.hpp"
+#include "glm/common.hpp"
+#include <limits>
+
+namespace stock {
+
+BoundingBox::BoundingBox()
+    : m_min(std::numeric_limits<float>::max()), m_max(std::numeric_limits<float>::lowest()) {}
+
+BoundingBox::BoundingBox(const glm::vec3& min, const glm::vec3& max) : m_min(min), m_max(max) {}
+
+bool BoundingBox::isEmpty() const {
+  return m_min.x > m_max.x || m_min.y > m_max.y || m_min.z > m_max.z;
+}
+
+void BoundingBox::expand(const glm::vec3& point) {
+  m_min = glm::min(m_min, point);
+  m_max = glm::max(m_max, point);
+}
+
+void BoundingBox::expand(const BoundingBox& other) {
+  m_min = glm::min(m_min, other.m_min);
+  m_max = glm::max(m_max, other.m_max);
+}
+
+bool BoundingBox::contains(const glm::vec3& point) const {
+  return point.x >= m_min.x && point.y >= m_min.y && point.z >= m_min.z && point.x <= m_max.x &&
+         point.y <= m_max.y && point.z <= m_max.z;
+}
+
+bool BoundingBox::contains(const BoundingBox& other) const {
+  return other.m_min.x >= m_min.x && other.m_min.y >= m_min.y && other.m_min.z >= m_min.z &&
+         other.m_max.x <= m_max.x && other.m_max.y <= m_max.y && other.m_max.z <= m_max.z;
+}
+
+bool BoundingBox::intersects(const BoundingBox& other) const {
+  return other.m_min.x <= m_max.x && other.m_min.y <= m_max.y && other.m_min.z <= m_max.z &&
+         other.m_max.x >= m_min.x && other.m_max.y >= m_min.y && other.m_max.z >= m_min.z;
+}
+
+float BoundingBox::area() const {
+  auto size = m_max - m_min;
+  return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+BoundingBox BoundingBox::transformed(const glm::mat4& matrix) const {
+  if (isEmpty()) {
+    return *this;
+  }
+  // Transform the center and project the extents onto each axis of the result (Arvo's method).
+  auto center = glm::vec3(matrix * glm::vec4(this->center(), 1.f));
+  auto extents = this->extents();
+  glm::vec3 radius;
+  for (int i = 0; i < 3; i++) {
+    radius[i] = glm::abs(matrix[0][i]) * extents.x + glm::abs(matrix[1][i]) * extents.y +
+                glm::abs(matrix[2][i]) * extents.z;
+  }
+  return BoundingBox(center - radius, center + radius);
+}
+
+} // namespace stock
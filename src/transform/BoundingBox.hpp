@@ -0,0 +1,54 @@
+#pragma once
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+
+namespace stock {
+
+// BoundingBox is an axis-aligned box described by its minimum and maximum corners. A default-constructed box is
+// empty and contains no points.
+
+class BoundingBox {
+
+public:
+  BoundingBox();
+
+  BoundingBox(const glm::vec3& min, const glm::vec3& max);
+
+  const glm::vec3& min() const { return m_min; }
+  glm::vec3& min() { return m_min; }
+
+  const glm::vec3& max() const { return m_max; }
+  glm::vec3& max() { return m_max; }
+
+  glm::vec3 center() const { return (m_min + m_max) * .5f; }
+
+  // Get half of the size of the box along each axis.
+  glm::vec3 extents() const { return (m_max - m_min) * .5f; }
+
+  // Returns true if the box contains no points.
+  bool isEmpty() const;
+
+  // Grow the box to contain a point or another box.
+  void expand(const glm::vec3& point);
+  void expand(const BoundingBox& other);
+
+  // Returns true if the box contains the given point or box.
+  bool contains(const glm::vec3& point) const;
+  bool contains(const BoundingBox& other) const;
+
+  // Returns true if the box and the other box share any points.
+  bool intersects(const BoundingBox& other) const;
+
+  // Get the surface area of the box.
+  float area() const;
+
+  // Get the smallest box containing this box after transformation by an affine matrix.
+  BoundingBox transformed(const glm::mat4& matrix) const;
+
+private:
+  glm::vec3 m_min;
+  glm::vec3 m_max;
+};
+
+} // namespace stock
@@ -0,0 +1,248 @@
+#include "transform/SceneGraph.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "glm/mat3x3.hpp"
+#include <cassert>
+
+namespace stock {
+
+constexpr SceneGraph::NodeId SceneGraph::NULL_NODE;
+constexpr uint32_t SceneGraph::NULL_INDEX;
+
+// Keep the elements of 'values' whose flag in 'removed' is zero, preserving their order.
+template <typename T> static void compact(std::vector<T>& values, const std::vector<uint8_t>& removed) {
+  size_t count = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (!removed[i]) {
+      values[count++] = values[i];
+    }
+  }
+  values.resize(count);
+}
+
+// Reorder 'values' so that element i of the result is element order[i] of the input.
+template <typename T> static void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+  std::vector<T> result;
+  result.reserve(order.size());
+  for (auto index : order) {
+    result.push_back(values[index]);
+  }
+  values.swap(result);
+}
+
+SceneGraph::NodeId SceneGraph::create(NodeId parent) {
+  assert(parent == NULL_NODE || isValid(parent));
+  NodeId id;
+  if (!m_freeIds.empty()) {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+  } else {
+    id = static_cast<NodeId>(m_indices.size());
+    m_indices.push_back(NULL_INDEX);
+  }
+  uint32_t index = static_cast<uint32_t>(m_ids.size());
+  m_indices[id] = index;
+  m_positions.emplace_back(0.f);
+  m_rotations.emplace_back();
+  m_scales.emplace_back(1.f);
+  m_worldMatrices.emplace_back(1.f);
+  m_parentIndices.push_back(parent == NULL_NODE ? NULL_INDEX : m_indices[parent]);
+  m_parentIds.push_back(parent);
+  m_ids.push_back(id);
+  m_dirty.push_back(1);
+  m_changed.push_back(0);
+  m_orderDirty = true;
+  m_anyDirty = true;
+  return id;
+}
+
+void SceneGraph::destroy(NodeId node) {
+  if (!isValid(node)) {
+    return;
+  }
+  if (m_orderDirty) {
+    rebuildOrder();
+  }
+
+  // Every parent precedes its children, so one forward pass finds all descendants.
+  std::vector<uint8_t> removed(m_ids.size(), 0);
+  uint32_t start = m_indices[node];
+  removed[start] = 1;
+  for (size_t i = start + 1; i < m_ids.size(); i++) {
+    uint32_t parent = m_parentIndices[i];
+    removed[i] = static_cast<uint8_t>(parent != NULL_INDEX && removed[parent]);
+  }
+  for (size_t i = start; i < m_ids.size(); i++) {
+    if (removed[i]) {
+      m_indices[m_ids[i]] = NULL_INDEX;
+      m_freeIds.push_back(m_ids[i]);
+    }
+  }
+
+  // Removing nodes from a breadth-first order leaves the remaining nodes in breadth-first order.
+  compact(m_positions, removed);
+  compact(m_rotations, removed);
+  compact(m_scales, removed);
+  compact(m_worldMatrices, removed);
+  compact(m_parentIds, removed);
+  compact(m_ids, removed);
+  compact(m_dirty, removed);
+  compact(m_changed, removed);
+  m_parentIndices.resize(m_ids.size());
+  for (uint32_t i = 0; i < m_ids.size(); i++) {
+    m_indices[m_ids[i]] = i;
+  }
+  for (uint32_t i = 0; i < m_ids.size(); i++) {
+    m_parentIndices[i] = m_parentIds[i] == NULL_NODE ? NULL_INDEX : m_indices[m_parentIds[i]];
+  }
+}
+
+bool SceneGraph::isValid(NodeId node) const {
+  return node < m_indices.size() && m_indices[node] != NULL_INDEX;
+}
+
+SceneGraph::NodeId SceneGraph::parent(NodeId node) const {
+  return m_parentIds[m_indices[node]];
+}
+
+bool SceneGraph::setParent(NodeId node, NodeId parent) {
+  assert(isValid(node) && (parent == NULL_NODE || isValid(parent)));
+  uint32_t index = m_indices[node];
+  if (m_parentIds[index] == parent) {
+    return true;
+  }
+  for (NodeId ancestor = parent; ancestor != NULL_NODE; ancestor = m_parentIds[m_indices[ancestor]]) {
+    if (ancestor == node) {
+      return false;
+    }
+  }
+  m_parentIds[index] = parent;
+  m_orderDirty = true;
+  markDirty(index);
+  return true;
+}
+
+void SceneGraph::setPosition(NodeId node, const glm::vec3& position) {
+  uint32_t index = m_indices[node];
+  m_positions[index] = position;
+  markDirty(index);
+}
+
+void SceneGraph::setRotation(NodeId node, const glm::quat& rotation) {
+  uint32_t index = m_indices[node];
+  m_rotations[index] = rotation;
+  markDirty(index);
+}
+
+void SceneGraph::setScale(NodeId node, const glm::vec3& scale) {
+  uint32_t index = m_indices[node];
+  m_scales[index] = scale;
+  markDirty(index);
+}
+
+Transform SceneGraph::transform(NodeId node) const {
+  uint32_t index = m_indices[node];
+  Transform transform;
+  transform.position() = m_positions[index];
+  transform.rotation() = m_rotations[index];
+  transform.scale() = m_scales[index];
+  return transform;
+}
+
+void SceneGraph::setTransform(NodeId node, const Transform& transform) {
+  uint32_t index = m_indices[node];
+  m_positions[index] = transform.position();
+  m_rotations[index] = transform.rotation();
+  m_scales[index] = transform.scale();
+  markDirty(index);
+}
+
+void SceneGraph::markDirty(uint32_t index) {
+  m_dirty[index] = 1;
+  m_anyDirty = true;
+}
+
+void SceneGraph::rebuildOrder() {
+  uint32_t count = static_cast<uint32_t>(m_ids.size());
+  for (uint32_t i = 0; i < count; i++) {
+    m_parentIndices[i] = m_parentIds[i] == NULL_NODE ? NULL_INDEX : m_indices[m_parentIds[i]];
+  }
+
+  // Gather the children of each node into one array, with the children of node i starting at childStart[i].
+  std::vector<uint32_t> childStart(count + 1, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    if (m_parentIndices[i] != NULL_INDEX) {
+      childStart[m_parentIndices[i] + 1]++;
+    }
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    childStart[i + 1] += childStart[i];
+  }
+  std::vector<uint32_t> children(childStart[count]);
+  std::vector<uint32_t> childEnd(childStart.begin(), childStart.end() - 1);
+  for (uint32_t i = 0; i < count; i++) {
+    if (m_parentIndices[i] != NULL_INDEX) {
+      children[childEnd[m_parentIndices[i]]++] = i;
+    }
+  }
+
+  // Visit roots first, then each level of the hierarchy in turn.
+  std::vector<uint32_t> order;
+  order.reserve(count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (m_parentIndices[i] == NULL_INDEX) {
+      order.push_back(i);
+    }
+  }
+  for (size_t head = 0; head < order.size(); head++) {
+    uint32_t index = order[head];
+    order.insert(order.end(), children.begin() + childStart[index], children.begin() + childStart[index + 1]);
+  }
+  assert(order.size() == count);
+
+  permute(m_positions, order);
+  permute(m_rotations, order);
+  permute(m_scales, order);
+  permute(m_worldMatrices, order);
+  permute(m_parentIds, order);
+  permute(m_ids, order);
+  permute(m_dirty, order);
+  permute(m_changed, order);
+  for (uint32_t i = 0; i < count; i++) {
+    m_indices[m_ids[i]] = i;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    m_parentIndices[i] = m_parentIds[i] == NULL_NODE ? NULL_INDEX : m_indices[m_parentIds[i]];
+  }
+  m_orderDirty = false;
+}
+
+size_t SceneGraph::update() {
+  STOCK_PROFILE_SCOPE("SceneGraph::update");
+  if (m_orderDirty) {
+    rebuildOrder();
+  }
+  if (!m_anyDirty) {
+    return 0;
+  }
+  size_t computed = 0;
+  for (size_t i = 0; i < m_ids.size(); i++) {
+    uint32_t parent = m_parentIndices[i];
+    bool changed = m_dirty[i] || (parent != NULL_INDEX && m_changed[parent]);
+    m_changed[i] = static_cast<uint8_t>(changed);
+    m_dirty[i] = 0;
+    if (!changed) {
+      continue;
+    }
+    // Build translate * scale * rotate directly; scaling after rotation scales each row of the rotation.
+    glm::mat3 rotation = glm::mat3_cast(m_rotations[i]);
+    const auto& scale = m_scales[i];
+    glm::mat4 local(glm::vec4(rotation[0] * scale, 0.f), glm::vec4(rotation[1] * scale, 0.f),
+                    glm::vec4(rotation[2] * scale, 0.f), glm::vec4(m_positions[i], 1.f));
+    m_worldMatrices[i] = parent == NULL_INDEX ? local : m_worldMatrices[parent] * local;
+    computed++;
+  }
+  m_anyDirty = false;
+  return computed;
+}
+
+} // namespace stock
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "transform/Transform.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include "glm/gtx/quaternion.hpp"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace stock {
+
+// SceneGraph is a hierarchy of nodes, each with a local position, rotation, and scale relative to its parent. Node
+// data is stored as separate arrays ordered breadth-first, so computing world matrices is a single forward pass over
+// memory in which every parent precedes its children.
+//
+// Changing a node marks it dirty, and update() recomputes world matrices only for dirty nodes and their descendants.
+// Local transforms compose the same way as Transform::convertLocalPointToWorld: rotate, then scale, then translate.
+
+class SceneGraph {
+
+public:
+  using NodeId = uint32_t;
+
+  static constexpr NodeId NULL_NODE = std::numeric_limits<NodeId>::max();
+
+  SceneGraph() = default;
+
+  // Create a node with an identity local transform, as a child of 'parent' or as a root if 'parent' is NULL_NODE.
+  NodeId create(NodeId parent = NULL_NODE);
+
+  // Destroy a node and all of its descendants.
+  void destroy(NodeId node);
+
+  // Returns true if the ID refers to a node that has not been destroyed.
+  bool isValid(NodeId node) const;
+
+  // Get the number of nodes.
+  size_t size() const { return m_ids.size(); }
+
+  // Get the parent of a node, or NULL_NODE for a root.
+  NodeId parent(NodeId node) const;
+
+  // Move a node and its descendants under a new parent, keeping its local transform; returns false if the new parent
+  // is the node itself or one of its descendants.
+  bool setParent(NodeId node, NodeId parent);
+
+  const glm::vec3& position(NodeId node) const { return m_positions[m_indices[node]]; }
+  void setPosition(NodeId node, const glm::vec3& position);
+
+  const glm::quat& rotation(NodeId node) const { return m_rotations[m_indices[node]]; }
+  void setRotation(NodeId node, const glm::quat& rotation);
+
+  const glm::vec3& scale(NodeId node) const { return m_scales[m_indices[node]]; }
+  void setScale(NodeId node, const glm::vec3& scale);
+
+  // Get or set the local position, rotation, and scale of a node together.
+  Transform transform(NodeId node) const;
+  void setTransform(NodeId node, const Transform& transform);
+
+  // Get the matrix from a node's local space to world space, as of the last call to update().
+  const glm::mat4& worldMatrix(NodeId node) const { return m_worldMatrices[m_indices[node]]; }
+
+  // Recompute the world matrices of changed nodes and their descendants; returns the number of matrices computed.
+  size_t update();
+
+private:
+  static constexpr uint32_t NULL_INDEX = std::numeric_limits<uint32_t>::max();
+
+  void markDirty(uint32_t index);
+  void rebuildOrder();
+
+  // Node data by index, in breadth-first order after rebuildOrder().
+  std::vector<glm::vec3> m_positions;
+  std::vector<glm::quat> m_rotations;
+  std::vector<glm::vec3> m_scales;
+  std::vector<glm::mat4> m_worldMatrices;
+  std::vector<uint32_t> m_parentIndices;
+  std::vector<NodeId> m_parentIds;
+  std::vector<NodeId> m_ids;
+  std::vector<uint8_t> m_dirty;
+  std::vector<uint8_t> m_changed;
+
+  // Index of each node ID, or NULL_INDEX for destroyed IDs.
+  std::vector<uint32_t> m_indices;
+  std::vector<NodeId> m_freeIds;
+
+  bool m_orderDirty = false;
+  bool m_anyDirty = false;
+};
+
+} // namespace stock
@@ -88,6 +88,10 @@ glm::mat4 Camera::viewProjectionMatrix() const {
   return proj * view;
 }
 
+Frustum Camera::frustum() const {
+  return Frustum(viewProjectionMatrix());
+}
+
 glm::mat3 Camera::normalMatrix() const {
   auto view = viewMatrix();
   return glm::mat3(view);
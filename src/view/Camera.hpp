@@ -4,6 +4,7 @@
 #pragma once
 
 #include "transform/Transform.hpp"
+#include "view/Frustum.hpp"
 #include "glm/mat3x3.hpp"
 #include "glm/mat4x4.hpp"
 #include "glm/vec3.hpp"
@@ -53,6 +54,9 @@ public:
 
   glm::mat3 normalMatrix() const;
 
+  // Get the volume visible to the camera in world space.
+  Frustum frustum() const;
+
   const Transform& transform() const { return m_transform; }
   Transform& transform() { return m_transform; }
 
@@ -0,0 +1,139 @@
+#include "view/Frustum.hpp"
+#include "glm/geometric.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define STOCK_FRUSTUM_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STOCK_FRUSTUM_LANES 4
+#endif
+
+namespace stock {
+
+#if STOCK_FRUSTUM_LANES == 8
+
+using Lanes = __m256;
+static inline Lanes load(const float* p) { return _mm256_loadu_ps(p); }
+static inline Lanes splat(float v) { return _mm256_set1_ps(v); }
+static inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+static inline Lanes sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+static inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+static inline Lanes greaterEqual(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline Lanes both(Lanes a, Lanes b) { return _mm256_and_ps(a, b); }
+static inline Lanes allTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+static inline int bits(Lanes a) { return _mm256_movemask_ps(a); }
+
+#elif STOCK_FRUSTUM_LANES == 4
+
+using Lanes = __m128;
+static inline Lanes load(const float* p) { return _mm_loadu_ps(p); }
+static inline Lanes splat(float v) { return _mm_set1_ps(v); }
+static inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes greaterEqual(Lanes a, Lanes b) { return _mm_cmpge_ps(a, b); }
+static inline Lanes both(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+static inline Lanes allTrue() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+static inline int bits(Lanes a) { return _mm_movemask_ps(a); }
+
+#endif
+
+Frustum::Frustum() {
+  m_planes.fill(glm::vec4(0.f, 0.f, 0.f, 1.f));
+}
+
+Frustum::Frustum(const glm::mat4& m) {
+  // Gribb-Hartmann extraction: each plane is the sum or difference of the last row and another row of the matrix.
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+    rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+  }
+  m_planes[0] = rows[3] + rows[0];
+  m_planes[1] = rows[3] - rows[0];
+  m_planes[2] = rows[3] + rows[1];
+  m_planes[3] = rows[3] - rows[1];
+  m_planes[4] = rows[3] + rows[2];
+  m_planes[5] = rows[3] - rows[2];
+  for (auto& plane : m_planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+  for (const auto& plane : m_planes) {
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersectsBox(const BoundingBox& box) const {
+  auto center = box.center();
+  auto extents = box.extents();
+  for (const auto& plane : m_planes) {
+    glm::vec3 normal(plane);
+    // Test the corner of the box farthest along the plane normal.
+    if (glm::dot(normal, center) + glm::dot(glm::abs(normal), extents) + plane.w < 0.f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Frustum::testSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count,
+                          uint8_t* visible) const {
+  size_t i = 0;
+#if defined(STOCK_FRUSTUM_LANES)
+  for (; i + STOCK_FRUSTUM_LANES <= count; i += STOCK_FRUSTUM_LANES) {
+    Lanes cx = load(x + i), cy = load(y + i), cz = load(z + i);
+    Lanes negativeRadius = sub(splat(0.f), load(radius + i));
+    Lanes inside = allTrue();
+    for (const auto& plane : m_planes) {
+      Lanes distance = add(add(mul(splat(plane.x), cx), mul(splat(plane.y), cy)), add(mul(splat(plane.z), cz),
+                                                                                      splat(plane.w)));
+      inside = both(inside, greaterEqual(distance, negativeRadius));
+    }
+    int mask = bits(inside);
+    for (int lane = 0; lane < STOCK_FRUSTUM_LANES; lane++) {
+      visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    visible[i] = intersectsSphere(glm::vec3(x[i], y[i], z[i]), radius[i]);
+  }
+}
+
+void Frustum::testBoxes(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY,
+                        const float* maxZ, size_t count, uint8_t* visible) const {
+  size_t i = 0;
+#if defined(STOCK_FRUSTUM_LANES)
+  Lanes half = splat(.5f), zero = splat(0.f);
+  for (; i + STOCK_FRUSTUM_LANES <= count; i += STOCK_FRUSTUM_LANES) {
+    Lanes x0 = load(minX + i), y0 = load(minY + i), z0 = load(minZ + i);
+    Lanes x1 = load(maxX + i), y1 = load(maxY + i), z1 = load(maxZ + i);
+    Lanes cx = mul(add(x0, x1), half), cy = mul(add(y0, y1), half), cz = mul(add(z0, z1), half);
+    Lanes ex = mul(sub(x1, x0), half), ey = mul(sub(y1, y0), half), ez = mul(sub(z1, z0), half);
+    Lanes inside = allTrue();
+    for (const auto& plane : m_planes) {
+      Lanes distance = add(add(mul(splat(plane.x), cx), mul(splat(plane.y), cy)), add(mul(splat(plane.z), cz),
+                                                                                      splat(plane.w)));
+      Lanes reach = add(add(mul(splat(glm::abs(plane.x)), ex), mul(splat(glm::abs(plane.y)), ey)),
+                        mul(splat(glm::abs(plane.z)), ez));
+      inside = both(inside, greaterEqual(add(distance, reach), zero));
+    }
+    int mask = bits(inside);
+    for (int lane = 0; lane < STOCK_FRUSTUM_LANES; lane++) {
+      visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    BoundingBox box(glm::vec3(minX[i], minY[i], minZ[i]), glm::vec3(maxX[i], maxY[i], maxZ[i]));
+    visible[i] = intersectsBox(box);
+  }
+}
+
+} // namespace stock
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "transform/BoundingBox.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace stock {
+
+// Frustum is the volume visible through a view-projection matrix, described by six inward-facing planes in world
+// space. Planes are stored as (normal, distance) so that a point p is inside a plane when dot(normal, p) + distance
+// is non-negative, in the order: left, right, bottom, top, near, far.
+
+class Frustum {
+
+public:
+  static constexpr size_t PLANE_COUNT = 6;
+
+  // Create a frustum that contains all points.
+  Frustum();
+
+  // Extract the frustum planes from a view-projection matrix; this works for perspective and orthographic
+  // projections.
+  explicit Frustum(const glm::mat4& viewProjectionMatrix);
+
+  const glm::vec4& plane(size_t index) const { return m_planes[index]; }
+
+  // Returns true if any part of the sphere or box may be inside the frustum. These tests are conservative: some
+  // shapes outside the frustum near its corners are reported as visible.
+  bool intersectsSphere(const glm::vec3& center, float radius) const;
+  bool intersectsBox(const BoundingBox& box) const;
+
+  // Test 'count' spheres given as arrays of center coordinates and radii, writing 1 into 'visible' for each sphere
+  // that may be inside the frustum and 0 otherwise.
+  void testSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count,
+                   uint8_t* visible) const;
+
+  // Test 'count' boxes given as arrays of minimum and maximum corner coordinates, writing 1 into 'visible' for each
+  // box that may be inside the frustum and 0 otherwise.
+  void testBoxes(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY,
+                 const float* maxZ, size_t count, uint8_t* visible) const;
+
+private:
+  std::array<glm::vec4, PLANE_COUNT> m_planes;
+};
+
+} // namespace stock
@@ -0,0 +1,286 @@
+#include "view/OcclusionBuffer.hpp"
+#include "debug/CpuProfiler.hpp"
+#include "glm/common.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STOCK_OCCLUSION_SSE
+#endif
+
+namespace stock {
+
+constexpr uint32_t OcclusionBuffer::TILE_WIDTH;
+constexpr uint32_t OcclusionBuffer::TILE_HEIGHT;
+
+OcclusionBuffer::OcclusionBuffer() : OcclusionBuffer(Options()) {}
+
+OcclusionBuffer::OcclusionBuffer(Options options) : m_options(options), m_nextTile(0), m_tilesDone(0) {
+  assert(options.width % 4 == 0);
+  m_depth.assign(options.width * options.height, 1.f);
+  m_tilesX = (options.width + TILE_WIDTH - 1) / TILE_WIDTH;
+  m_tilesY = (options.height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+  m_bins.resize(m_tilesX * m_tilesY);
+  // Start the worker threads.
+  m_keepRunning = true;
+  for (uint32_t i = 0; i < options.numberOfThreads; i++) {
+    m_threads.emplace_back(&OcclusionBuffer::workerLoop, this, i);
+  }
+}
+
+OcclusionBuffer::~OcclusionBuffer() {
+  // Stop the worker threads.
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keepRunning = false;
+  }
+  m_startCondition.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+void OcclusionBuffer::begin(const glm::mat4& viewProjectionMatrix) {
+  m_viewProjectionMatrix = viewProjectionMatrix;
+  std::fill(m_depth.begin(), m_depth.end(), 1.f);
+  m_triangles.clear();
+}
+
+void OcclusionBuffer::addOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint16_t>& indices,
+                                  const glm::mat4& modelMatrix) {
+  addOccluder(positions.data(), positions.size(), indices.data(), indices.size(), modelMatrix);
+}
+
+void OcclusionBuffer::addOccluder(const glm::vec3* positions, size_t positionCount, const uint16_t* indices,
+                                  size_t indexCount, const glm::mat4& modelMatrix) {
+  STOCK_PROFILE_SCOPE("OcclusionBuffer::addOccluder");
+
+  auto matrix = m_viewProjectionMatrix * modelMatrix;
+  m_clipPositions.resize(positionCount);
+  for (size_t i = 0; i < positionCount; i++) {
+    m_clipPositions[i] = matrix * glm::vec4(positions[i], 1.f);
+  }
+
+  float width = static_cast<float>(m_options.width);
+  float height = static_cast<float>(m_options.height);
+
+  for (size_t i = 0; i + 2 < indexCount; i += 3) {
+    glm::vec3 screen[3];
+    bool clipped = false;
+    for (int v = 0; v < 3; v++) {
+      const auto& clip = m_clipPositions[indices[i + v]];
+      // Skip triangles crossing the near plane; drawing fewer occluders is always conservative.
+      if (clip.w <= 0.f || clip.z < -clip.w) {
+        clipped = true;
+        break;
+      }
+      float inverseW = 1.f / clip.w;
+      screen[v] = glm::vec3((clip.x * inverseW * .5f + .5f) * width, (clip.y * inverseW * .5f + .5f) * height,
+                            clip.z * inverseW);
+    }
+    if (clipped) {
+      continue;
+    }
+
+    // Rasterize both faces by making every triangle counter-clockwise.
+    float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+                 (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+    if (area == 0.f) {
+      continue;
+    }
+    if (area < 0.f) {
+      std::swap(screen[1], screen[2]);
+      area = -area;
+    }
+
+    auto minimum = glm::min(glm::min(screen[0], screen[1]), screen[2]);
+    auto maximum = glm::max(glm::max(screen[0], screen[1]), screen[2]);
+    if (minimum.z > 1.f) {
+      continue;
+    }
+
+    Triangle triangle;
+    triangle.minX = std::max(0, static_cast<int32_t>(std::floor(minimum.x)));
+    triangle.minY = std::max(0, static_cast<int32_t>(std::floor(minimum.y)));
+    triangle.maxX = std::min(static_cast<int32_t>(m_options.width), static_cast<int32_t>(std::ceil(maximum.x)));
+    triangle.maxY = std::min(static_cast<int32_t>(m_options.height), static_cast<int32_t>(std::ceil(maximum.y)));
+    if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) {
+      continue;
+    }
+
+    // Each edge function is scaled so that it equals 'area' at the opposite vertex.
+    for (int e = 0; e < 3; e++) {
+      const auto& a = screen[(e + 1) % 3];
+      const auto& b = screen[(e + 2) % 3];
+      triangle.edges[e] = glm::vec3(a.y - b.y, b.x - a.x, a.x * b.y - a.y * b.x);
+    }
+    triangle.depth = (triangle.edges[0] * screen[0].z + triangle.edges[1] * screen[1].z +
+                      triangle.edges[2] * screen[2].z) / area;
+    m_triangles.push_back(triangle);
+  }
+}
+
+void OcclusionBuffer::render() {
+  STOCK_PROFILE_SCOPE("OcclusionBuffer::render");
+
+  // A worker that woke late for the previous frame may still be leaving rasterizeTiles().
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_activeWorkers == 0; });
+  }
+
+  // Sort triangles into the tiles they overlap.
+  for (auto& bin : m_bins) {
+    bin.clear();
+  }
+  for (uint32_t i = 0; i < m_triangles.size(); i++) {
+    const auto& triangle = m_triangles[i];
+    uint32_t tileMinX = triangle.minX / TILE_WIDTH, tileMaxX = (triangle.maxX - 1) / TILE_WIDTH;
+    uint32_t tileMinY = triangle.minY / TILE_HEIGHT, tileMaxY = (triangle.maxY - 1) / TILE_HEIGHT;
+    for (uint32_t y = tileMinY; y <= tileMaxY; y++) {
+      for (uint32_t x = tileMinX; x <= tileMaxX; x++) {
+        m_bins[y * m_tilesX + x].push_back(i);
+      }
+    }
+  }
+
+  // Rasterize the tiles on the worker threads and this thread, then wait for all tiles to finish.
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_nextTile = 0;
+    m_tilesDone = 0;
+    m_generation++;
+  }
+  m_startCondition.notify_all();
+  rasterizeTiles();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_doneCondition.wait(lock, [this] { return m_tilesDone == m_bins.size() && m_activeWorkers == 0; });
+}
+
+void OcclusionBuffer::rasterizeTiles() {
+  uint32_t tileCount = static_cast<uint32_t>(m_bins.size());
+  uint32_t tile;
+  while ((tile = m_nextTile++) < tileCount) {
+    rasterizeTile(tile);
+    if (++m_tilesDone == tileCount) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_doneCondition.notify_all();
+    }
+  }
+}
+
+void OcclusionBuffer::rasterizeTile(uint32_t tile) {
+  int32_t tileX = static_cast<int32_t>((tile % m_tilesX) * TILE_WIDTH);
+  int32_t tileY = static_cast<int32_t>((tile / m_tilesX) * TILE_HEIGHT);
+  int32_t tileMaxX = std::min(tileX + static_cast<int32_t>(TILE_WIDTH), static_cast<int32_t>(m_options.width));
+  int32_t tileMaxY = std::min(tileY + static_cast<int32_t>(TILE_HEIGHT), static_cast<int32_t>(m_options.height));
+
+  for (uint32_t index : m_bins[tile]) {
+    const auto& triangle = m_triangles[index];
+    // Start rows on a multiple of 4 pixels; the extra pixels fail the edge tests.
+    int32_t minX = std::max(tileX, triangle.minX) & ~3;
+    int32_t maxX = std::min(tileMaxX, triangle.maxX);
+    int32_t minY = std::max(tileY, triangle.minY);
+    int32_t maxY = std::min(tileMaxY, triangle.maxY);
+    const auto& e0 = triangle.edges[0];
+    const auto& e1 = triangle.edges[1];
+    const auto& e2 = triangle.edges[2];
+    const auto& d = triangle.depth;
+
+    for (int32_t y = minY; y < maxY; y++) {
+      float* row = &m_depth[y * m_options.width];
+      float py = y + .5f;
+      float row0 = e0.y * py + e0.z, row1 = e1.y * py + e1.z, row2 = e2.y * py + e2.z, rowDepth = d.y * py + d.z;
+      int32_t x = minX;
+#if defined(STOCK_OCCLUSION_SSE)
+      __m128 zero = _mm_setzero_ps();
+      __m128 step = _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f);
+      for (; x < maxX; x += 4) {
+        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), step);
+        __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e0.x), px), _mm_set1_ps(row0));
+        __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e1.x), px), _mm_set1_ps(row1));
+        __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e2.x), px), _mm_set1_ps(row2));
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+        __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(d.x), px), _mm_set1_ps(rowDepth));
+        __m128 previous = _mm_loadu_ps(row + x);
+        __m128 write = _mm_and_ps(inside, _mm_cmplt_ps(depth, previous));
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(write, depth), _mm_andnot_ps(write, previous)));
+      }
+#endif
+      for (; x < maxX; x++) {
+        float px = x + .5f;
+        if (e0.x * px + row0 >= 0.f && e1.x * px + row1 >= 0.f && e2.x * px + row2 >= 0.f) {
+          row[x] = std::min(row[x], d.x * px + rowDepth);
+        }
+      }
+    }
+  }
+}
+
+void OcclusionBuffer::workerLoop(uint32_t index) {
+  (void)index; // Only used when profiling.
+  STOCK_PROFILE_THREAD("OcclusionBuffer " + std::to_string(index));
+  uint32_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_startCondition.wait(lock, [&] { return !m_keepRunning || m_generation != generation; });
+      if (!m_keepRunning) {
+        return;
+      }
+      generation = m_generation;
+      m_activeWorkers++;
+    }
+    rasterizeTiles();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_activeWorkers == 0) {
+      m_doneCondition.notify_all();
+    }
+  }
+}
+
+bool OcclusionBuffer::isVisible(const BoundingBox& box) const {
+  glm::vec3 minimum(std::numeric_limits<float>::max());
+  glm::vec3 maximum(std::numeric_limits<float>::lowest());
+  for (int corner = 0; corner < 8; corner++) {
+    glm::vec4 point((corner & 1) ? box.max().x : box.min().x, (corner & 2) ? box.max().y : box.min().y,
+                    (corner & 4) ? box.max().z : box.min().z, 1.f);
+    auto clip = m_viewProjectionMatrix * point;
+    // Boxes crossing the near plane can't be tested reliably.
+    if (clip.w <= 0.f || clip.z < -clip.w) {
+      return true;
+    }
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    minimum = glm::min(minimum, ndc);
+    maximum = glm::max(maximum, ndc);
+  }
+  if (minimum.z > 1.f) {
+    return false;
+  }
+
+  float width = static_cast<float>(m_options.width);
+  float height = static_cast<float>(m_options.height);
+  int32_t minX = std::max(0, static_cast<int32_t>(std::floor((minimum.x * .5f + .5f) * width)));
+  int32_t minY = std::max(0, static_cast<int32_t>(std::floor((minimum.y * .5f + .5f) * height)));
+  int32_t maxX = std::min(static_cast<int32_t>(m_options.width),
+                          static_cast<int32_t>(std::ceil((maximum.x * .5f + .5f) * width)));
+  int32_t maxY = std::min(static_cast<int32_t>(m_options.height),
+                          static_cast<int32_t>(std::ceil((maximum.y * .5f + .5f) * height)));
+
+  // The box is visible if its nearest depth is in front of the occluders at any pixel it covers.
+  for (int32_t y = minY; y < maxY; y++) {
+    const float* row = &m_depth[y * m_options.width];
+    for (int32_t x = minX; x < maxX; x++) {
+      if (minimum.z <= row[x]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace stock
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "transform/BoundingBox.hpp"
+#include "glm/mat4x4.hpp"
+#include "glm/vec3.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stock {
+
+// OcclusionBuffer is a small depth buffer rendered on the CPU. Occluder meshes are rasterized into it each frame and
+// the bounding boxes of other objects are then tested against it, so objects hidden behind nearer occluders can be
+// skipped before any draw is submitted.
+//
+// Triangles are binned into screen tiles and the tiles are rasterized in parallel by a set of worker threads together
+// with the calling thread. Results are conservative: occluder triangles crossing the near plane are not drawn and
+// boxes crossing the near plane are always visible.
+
+class OcclusionBuffer {
+
+public:
+  struct Options {
+    // Size of the depth buffer in pixels; the width must be a multiple of 4.
+    uint32_t width = 256;
+    uint32_t height = 128;
+    // Number of worker threads used in addition to the thread calling render().
+    uint32_t numberOfThreads = 3;
+  };
+
+  OcclusionBuffer();
+
+  explicit OcclusionBuffer(Options options);
+
+  ~OcclusionBuffer();
+
+  // Clear the depth buffer and occluders and set the view-projection matrix used for the next frame.
+  void begin(const glm::mat4& viewProjectionMatrix);
+
+  // Add the triangles of an occluder mesh, given by positions in local space, a triangle list of indices into the
+  // positions, and a matrix transforming the positions into world space.
+  void addOccluder(const glm::vec3* positions, size_t positionCount, const uint16_t* indices, size_t indexCount,
+                   const glm::mat4& modelMatrix);
+
+  void addOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint16_t>& indices,
+                   const glm::mat4& modelMatrix);
+
+  // Rasterize all occluders added since begin().
+  void render();
+
+  // Returns false if the world-space box is entirely hidden behind the rendered occluders or outside the view.
+  bool isVisible(const BoundingBox& box) const;
+
+  uint32_t width() const { return m_options.width; }
+  uint32_t height() const { return m_options.height; }
+
+  // Get the depth buffer as rows of normalized device depth, starting from the bottom row.
+  const float* depth() const { return m_depth.data(); }
+
+  // Get the number of occluder triangles added since begin().
+  size_t triangleCount() const { return m_triangles.size(); }
+
+private:
+  static constexpr uint32_t TILE_WIDTH = 32;
+  static constexpr uint32_t TILE_HEIGHT = 32;
+
+  struct Triangle {
+    // Edge functions as (a, b, c) where a * x + b * y + c is non-negative inside the triangle.
+    glm::vec3 edges[3];
+    // Depth plane as (a, b, c) where depth is a * x + b * y + c.
+    glm::vec3 depth;
+    // Pixel bounds of the triangle, inclusive min and exclusive max.
+    int32_t minX, minY, maxX, maxY;
+  };
+
+  void rasterizeTiles();
+  void rasterizeTile(uint32_t tile);
+  void workerLoop(uint32_t index);
+
+  Options m_options;
+  glm::mat4 m_viewProjectionMatrix;
+  std::vector<float> m_depth;
+  std::vector<Triangle> m_triangles;
+  std::vector<glm::vec4> m_clipPositions;
+  std::vector<std::vector<uint32_t>> m_bins;
+  uint32_t m_tilesX = 0;
+  uint32_t m_tilesY = 0;
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_startCondition;
+  std::condition_variable m_doneCondition;
+  std::atomic<uint32_t> m_nextTile;
+  std::atomic<uint32_t> m_tilesDone;
+  uint32_t m_generation = 0;
+  uint32_t m_activeWorkers = 0;
+  bool m_keepRunning = false;
+};
+
+} // namespace stock
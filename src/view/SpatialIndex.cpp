@@ -0,0 +1,444 @@
+#include "view/SpatialIndex.hpp"
+#include "transform/Transform.hpp"
+#include "view/Frustum.hpp"
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace stock {
+
+constexpr int32_t SpatialIndex::NULL_NODE;
+
+static BoundingBox combine(const BoundingBox& a, const BoundingBox& b) {
+  BoundingBox result = a;
+  result.expand(b);
+  return result;
+}
+
+SpatialIndex::SpatialIndex() {}
+
+SpatialIndex::SpatialIndex(Options options) : m_options(options) {}
+
+int32_t SpatialIndex::allocateNode() {
+  if (m_freeList != NULL_NODE) {
+    int32_t node = m_freeList;
+    // Free nodes are linked through their parent index.
+    m_freeList = m_nodes[node].parent;
+    m_nodes[node] = Node();
+    return node;
+  }
+  m_nodes.emplace_back();
+  return static_cast<int32_t>(m_nodes.size() - 1);
+}
+
+void SpatialIndex::freeNode(int32_t node) {
+  m_nodes[node].parent = m_freeList;
+  m_nodes[node].height = -1;
+  m_freeList = node;
+}
+
+void SpatialIndex::insert(ObjectId id, const BoundingBox& box) {
+  if (contains(id)) {
+    update(id, box);
+    return;
+  }
+  int32_t leaf = allocateNode();
+  glm::vec3 margin(m_options.margin);
+  m_nodes[leaf].box = BoundingBox(box.min() - margin, box.max() + margin);
+  m_nodes[leaf].id = id;
+  m_leaves[id] = leaf;
+  insertLeaf(leaf);
+}
+
+bool SpatialIndex::remove(ObjectId id) {
+  auto it = m_leaves.find(id);
+  if (it == m_leaves.end()) {
+    return false;
+  }
+  removeLeaf(it->second);
+  freeNode(it->second);
+  m_leaves.erase(it);
+  return true;
+}
+
+bool SpatialIndex::update(ObjectId id, const BoundingBox& box) {
+  auto it = m_leaves.find(id);
+  if (it == m_leaves.end()) {
+    insert(id, box);
+    return true;
+  }
+  int32_t leaf = it->second;
+  if (m_nodes[leaf].box.contains(box)) {
+    return false;
+  }
+  removeLeaf(leaf);
+  glm::vec3 margin(m_options.margin);
+  m_nodes[leaf].box = BoundingBox(box.min() - margin, box.max() + margin);
+  insertLeaf(leaf);
+  return true;
+}
+
+bool SpatialIndex::update(ObjectId id, const BoundingBox& localBox, const Transform& transform) {
+  BoundingBox worldBox;
+  for (int corner = 0; corner < 8; corner++) {
+    glm::vec3 point((corner & 1) ? localBox.max().x : localBox.min().x, (corner & 2) ? localBox.max().y : localBox.min().y,
+                    (corner & 4) ? localBox.max().z : localBox.min().z);
+    worldBox.expand(transform.convertLocalPointToWorld(point));
+  }
+  return update(id, worldBox);
+}
+
+bool SpatialIndex::contains(ObjectId id) const {
+  return m_leaves.find(id) != m_leaves.end();
+}
+
+void SpatialIndex::clear() {
+  m_nodes.clear();
+  m_leaves.clear();
+  m_root = NULL_NODE;
+  m_freeList = NULL_NODE;
+}
+
+int32_t SpatialIndex::height() const {
+  return m_root == NULL_NODE ? 0 : m_nodes[m_root].height;
+}
+
+void SpatialIndex::insertLeaf(int32_t leaf) {
+
+  if (m_root == NULL_NODE) {
+    m_root = leaf;
+    m_nodes[leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // Descend to the sibling that minimizes the increase in surface area of the tree.
+  BoundingBox leafBox = m_nodes[leaf].box;
+  int32_t index = m_root;
+  while (!m_nodes[index].isLeaf()) {
+    const auto& node = m_nodes[index];
+    float area = node.box.area();
+    float combinedArea = combine(node.box, leafBox).area();
+
+    // Cost of creating a new parent for this node and the new leaf.
+    float cost = 2.f * combinedArea;
+
+    // Minimum cost of pushing the leaf further down the tree.
+    float inheritanceCost = 2.f * (combinedArea - area);
+
+    float childCost[2];
+    int32_t children[2] = {node.child1, node.child2};
+    for (int i = 0; i < 2; i++) {
+      const auto& child = m_nodes[children[i]];
+      float childArea = combine(child.box, leafBox).area();
+      childCost[i] = (child.isLeaf() ? childArea : childArea - child.box.area()) + inheritanceCost;
+    }
+
+    if (cost < childCost[0] && cost < childCost[1]) {
+      break;
+    }
+    index = childCost[0] < childCost[1] ? children[0] : children[1];
+  }
+  int32_t sibling = index;
+
+  // Create a new parent for the sibling and the leaf.
+  int32_t oldParent = m_nodes[sibling].parent;
+  int32_t newParent = allocateNode();
+  m_nodes[newParent].parent = oldParent;
+  m_nodes[newParent].box = combine(leafBox, m_nodes[sibling].box);
+  m_nodes[newParent].height = m_nodes[sibling].height + 1;
+  m_nodes[newParent].child1 = sibling;
+  m_nodes[newParent].child2 = leaf;
+  m_nodes[sibling].parent = newParent;
+  m_nodes[leaf].parent = newParent;
+
+  if (oldParent != NULL_NODE) {
+    if (m_nodes[oldParent].child1 == sibling) {
+      m_nodes[oldParent].child1 = newParent;
+    } else {
+      m_nodes[oldParent].child2 = newParent;
+    }
+  } else {
+    m_root = newParent;
+  }
+
+  // Walk back up the tree fixing heights and boxes.
+  index = m_nodes[leaf].parent;
+  while (index != NULL_NODE) {
+    index = balance(index);
+    auto& node = m_nodes[index];
+    node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+    node.box = combine(m_nodes[node.child1].box, m_nodes[node.child2].box);
+    index = node.parent;
+  }
+}
+
+void SpatialIndex::removeLeaf(int32_t leaf) {
+
+  if (leaf == m_root) {
+    m_root = NULL_NODE;
+    return;
+  }
+
+  int32_t parent = m_nodes[leaf].parent;
+  int32_t grandParent = m_nodes[parent].parent;
+  int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+  if (grandParent == NULL_NODE) {
+    m_root = sibling;
+    m_nodes[sibling].parent = NULL_NODE;
+    freeNode(parent);
+    return;
+  }
+
+  // Replace the parent with the sibling.
+  if (m_nodes[grandParent].child1 == parent) {
+    m_nodes[grandParent].child1 = sibling;
+  } else {
+    m_nodes[grandParent].child2 = sibling;
+  }
+  m_nodes[sibling].parent = grandParent;
+  freeNode(parent);
+
+  int32_t index = grandParent;
+  while (index != NULL_NODE) {
+    index = balance(index);
+    auto& node = m_nodes[index];
+    node.height = 1 + std::max(m_nodes[node.child1].height, m_nodes[node.child2].height);
+    node.box = combine(m_nodes[node.child1].box, m_nodes[node.child2].box);
+    index = node.parent;
+  }
+}
+
+// If the subtree at 'iA' is imbalanced, rotate its taller child up and return the new subtree root.
+int32_t SpatialIndex::balance(int32_t iA) {
+
+  Node& A = m_nodes[iA];
+  if (A.isLeaf() || A.height < 2) {
+    return iA;
+  }
+
+  int32_t iB = A.child1;
+  int32_t iC = A.child2;
+  Node& B = m_nodes[iB];
+  Node& C = m_nodes[iC];
+
+  int32_t difference = C.height - B.height;
+
+  // Rotate C up.
+  if (difference > 1) {
+    int32_t iF = C.child1;
+    int32_t iG = C.child2;
+    Node& F = m_nodes[iF];
+    Node& G = m_nodes[iG];
+
+    C.child1 = iA;
+    C.parent = A.parent;
+    A.parent = iC;
+
+    if (C.parent != NULL_NODE) {
+      if (m_nodes[C.parent].child1 == iA) {
+        m_nodes[C.parent].child1 = iC;
+      } else {
+        m_nodes[C.parent].child2 = iC;
+      }
+    } else {
+      m_root = iC;
+    }
+
+    if (F.height > G.height) {
+      C.child2 = iF;
+      A.child2 = iG;
+      G.parent = iA;
+      A.box = combine(B.box, G.box);
+      C.box = combine(A.box, F.box);
+      A.height = 1 + std::max(B.height, G.height);
+      C.height = 1 + std::max(A.height, F.height);
+    } else {
+      C.child2 = iG;
+      A.child2 = iF;
+      F.parent = iA;
+      A.box = combine(B.box, F.box);
+      C.box = combine(A.box, G.box);
+      A.height = 1 + std::max(B.height, F.height);
+      C.height = 1 + std::max(A.height, G.height);
+    }
+    return iC;
+  }
+
+  // Rotate B up.
+  if (difference < -1) {
+    int32_t iD = B.child1;
+    int32_t iE = B.child2;
+    Node& D = m_nodes[iD];
+    Node& E = m_nodes[iE];
+
+    B.child1 = iA;
+    B.parent = A.parent;
+    A.parent = iB;
+
+    if (B.parent != NULL_NODE) {
+      if (m_nodes[B.parent].child1 == iA) {
+        m_nodes[B.parent].child1 = iB;
+      } else {
+        m_nodes[B.parent].child2 = iB;
+      }
+    } else {
+      m_root = iB;
+    }
+
+    if (D.height > E.height) {
+      B.child2 = iD;
+      A.child1 = iE;
+      E.parent = iA;
+      A.box = combine(C.box, E.box);
+      B.box = combine(A.box, D.box);
+      A.height = 1 + std::max(C.height, E.height);
+      B.height = 1 + std::max(A.height, D.height);
+    } else {
+      B.child2 = iE;
+      A.child1 = iD;
+      D.parent = iA;
+      A.box = combine(C.box, D.box);
+      B.box = combine(A.box, E.box);
+      A.height = 1 + std::max(C.height, D.height);
+      B.height = 1 + std::max(A.height, E.height);
+    }
+    return iB;
+  }
+
+  return iA;
+}
+
+void SpatialIndex::collectLeaves(int32_t node, std::vector<ObjectId>& results) const {
+  std::vector<int32_t> stack;
+  stack.push_back(node);
+  while (!stack.empty()) {
+    const auto& n = m_nodes[stack.back()];
+    stack.pop_back();
+    if (n.isLeaf()) {
+      results.push_back(n.id);
+    } else {
+      stack.push_back(n.child1);
+      stack.push_back(n.child2);
+    }
+  }
+}
+
+void SpatialIndex::queryFrustum(const Frustum& frustum, std::vector<ObjectId>& results) const {
+  if (m_root == NULL_NODE) {
+    return;
+  }
+  std::vector<int32_t> stack;
+  stack.push_back(m_root);
+  while (!stack.empty()) {
+    int32_t index = stack.back();
+    stack.pop_back();
+    const auto& node = m_nodes[index];
+    auto center = node.box.center();
+    auto extents = node.box.extents();
+    bool inside = true;
+    bool outside = false;
+    for (size_t i = 0; i < Frustum::PLANE_COUNT; i++) {
+      const auto& plane = frustum.plane(i);
+      glm::vec3 normal(plane);
+      float distance = glm::dot(normal, center) + plane.w;
+      float reach = glm::dot(glm::abs(normal), extents);
+      if (distance + reach < 0.f) {
+        outside = true;
+        break;
+      }
+      if (distance - reach < 0.f) {
+        inside = false;
+      }
+    }
+    if (outside) {
+      continue;
+    }
+    if (inside || node.isLeaf()) {
+      // Everything below a node that is entirely inside the frustum is visible without further tests.
+      collectLeaves(index, results);
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+void SpatialIndex::querySphere(const glm::vec3& center, float radius, std::vector<ObjectId>& results) const {
+  if (m_root == NULL_NODE) {
+    return;
+  }
+  float radiusSquared = radius * radius;
+  std::vector<int32_t> stack;
+  stack.push_back(m_root);
+  while (!stack.empty()) {
+    const auto& node = m_nodes[stack.back()];
+    stack.pop_back();
+    auto closest = glm::clamp(center, node.box.min(), node.box.max());
+    auto offset = closest - center;
+    if (glm::dot(offset, offset) > radiusSquared) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      results.push_back(node.id);
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+void SpatialIndex::queryBox(const BoundingBox& box, std::vector<ObjectId>& results) const {
+  if (m_root == NULL_NODE) {
+    return;
+  }
+  std::vector<int32_t> stack;
+  stack.push_back(m_root);
+  while (!stack.empty()) {
+    const auto& node = m_nodes[stack.back()];
+    stack.pop_back();
+    if (!node.box.intersects(box)) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      results.push_back(node.id);
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+void SpatialIndex::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                            std::vector<ObjectId>& results) const {
+  if (m_root == NULL_NODE) {
+    return;
+  }
+  // Division by zero components gives infinities, which the slab test below handles correctly.
+  glm::vec3 inverse = 1.f / direction;
+  std::vector<int32_t> stack;
+  stack.push_back(m_root);
+  while (!stack.empty()) {
+    const auto& node = m_nodes[stack.back()];
+    stack.pop_back();
+    auto t0 = (node.box.min() - origin) * inverse;
+    auto t1 = (node.box.max() - origin) * inverse;
+    auto tNear = glm::min(t0, t1);
+    auto tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    if (enter > exit) {
+      continue;
+    }
+    if (node.isLeaf()) {
+      results.push_back(node.id);
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+} // namespace stock
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "transform/BoundingBox.hpp"
+#include "glm/vec3.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace stock {
+
+class Frustum;
+class Transform;
+
+// SpatialIndex is a dynamic bounding volume hierarchy of objects identified by ID. Each object is stored with a
+// box enlarged by a margin, so small movements only update the stored bounds and the tree is restructured only when
+// an object leaves its enlarged box. Insertion picks the sibling with the lowest surface area cost and rotations keep
+// the tree balanced.
+
+class SpatialIndex {
+
+public:
+  using ObjectId = uint32_t;
+
+  struct Options {
+    // Distance added to each side of an object's box when it is stored.
+    float margin = 0.1f;
+  };
+
+  SpatialIndex();
+
+  explicit SpatialIndex(Options options);
+
+  // Add an object with the given world-space bounds; if the ID is already present its bounds are updated.
+  void insert(ObjectId id, const BoundingBox& box);
+
+  // Remove an object; returns false if the ID was not present.
+  bool remove(ObjectId id);
+
+  // Set the world-space bounds of an object; returns true if the tree was restructured.
+  bool update(ObjectId id, const BoundingBox& box);
+
+  // Set the bounds of an object from its bounds in local space and the Transform placing it in the world.
+  bool update(ObjectId id, const BoundingBox& localBox, const Transform& transform);
+
+  // Returns true if the ID is present.
+  bool contains(ObjectId id) const;
+
+  // Get the number of objects.
+  size_t size() const { return m_leaves.size(); }
+
+  // Remove all objects.
+  void clear();
+
+  // Append the IDs of objects whose boxes may be visible in the frustum to 'results'.
+  void queryFrustum(const Frustum& frustum, std::vector<ObjectId>& results) const;
+
+  // Append the IDs of objects whose boxes intersect the sphere to 'results'.
+  void querySphere(const glm::vec3& center, float radius, std::vector<ObjectId>& results) const;
+
+  // Append the IDs of objects whose boxes intersect the box to 'results'.
+  void queryBox(const BoundingBox& box, std::vector<ObjectId>& results) const;
+
+  // Append the IDs of objects whose boxes are hit by the ray within 'maxDistance' to 'results'; the direction does
+  // not need to be normalized, distances are measured in multiples of its length.
+  void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                std::vector<ObjectId>& results) const;
+
+  // Get the height of the tree; a tree with a single object has height 0.
+  int32_t height() const;
+
+private:
+  static constexpr int32_t NULL_NODE = -1;
+
+  struct Node {
+    BoundingBox box;
+    ObjectId id = 0;
+    int32_t parent = NULL_NODE;
+    int32_t child1 = NULL_NODE;
+    int32_t child2 = NULL_NODE;
+    int32_t height = 0;
+    bool isLeaf() const { return child1 == NULL_NODE; }
+  };
+
+  int32_t allocateNode();
+  void freeNode(int32_t node);
+  void insertLeaf(int32_t leaf);
+  void removeLeaf(int32_t leaf);
+  int32_t balance(int32_t node);
+  void collectLeaves(int32_t node, std::vector<ObjectId>& results) const;
+
+  std::vector<Node> m_nodes;
+  std::unordered_map<ObjectId, int32_t> m_leaves;
+  int32_t m_root = NULL_NODE;
+  int32_t m_freeList = NULL_NODE;
+  Options m_options;
+};
+
+} // namespace stock
@@ -0,0 +1,77 @@
+#include "catch.hpp"
+#include "FakeGl.hpp"
+#include "gl/CommandBuffer.hpp"
+#include "gl/RenderState.hpp"
+#include "gl/ShaderProgram.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <string>
+#include <vector>
+
+using namespace stock;
+
+TEST_CASE("Command buffer replays recorded commands in order", "[CommandBuffer]") {
+  FakeGl gl;
+  RenderState rs;
+  CommandBuffer buffer;
+
+  SECTION("State changes are replayed in recording order with their values") {
+    buffer.depthFunc(GL_LEQUAL);
+    buffer.blending(GL_TRUE);
+    buffer.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    buffer.depthMask(GL_FALSE);
+    buffer.colorMask(GL_TRUE, GL_FALSE, GL_TRUE, GL_FALSE);
+    buffer.clearColor(.25f, .5f, .75f, 1.f);
+    buffer.scissor(1, 2, 30, 40);
+    buffer.clear(GL_COLOR_BUFFER_BIT);
+    buffer.depthFunc(GL_EQUAL);
+    CHECK(buffer.size() == 9);
+
+    buffer.execute(rs);
+    std::vector<std::string> expected = {
+        "glDepthFunc " + std::to_string(GL_LEQUAL),
+        "glEnable " + std::to_string(GL_BLEND),
+        "glBlendFunc " + std::to_string(GL_ONE) + " " + std::to_string(GL_ONE_MINUS_SRC_ALPHA) + " " +
+            std::to_string(GL_ONE) + " " + std::to_string(GL_ONE_MINUS_SRC_ALPHA),
+        "glDepthMask 0",
+        "glColorMask 1 0 1 0",
+        "glClearColor 0.25 0.5 0.75 1",
+        "glScissor 1 2 30 40",
+        "glClear " + std::to_string(GL_COLOR_BUFFER_BIT),
+        "glDepthFunc " + std::to_string(GL_EQUAL),
+    };
+    CHECK(FakeGl::calls == expected);
+  }
+
+  SECTION("Uniform values are packed and unpacked by type") {
+    ShaderProgram program("", "");
+    UniformLocation a("u_a"), b("u_b"), c("u_c"), d("u_d");
+    buffer.uniform(program, a, 7);
+    buffer.uniform(program, b, 1.5f);
+    buffer.uniform(program, c, glm::vec3(1.f, 2.f, 3.f));
+    buffer.uniform(program, d, glm::translate(glm::mat4(2.f), glm::vec3(4.f, 5.f, 6.f)));
+    buffer.uniform(program, a, 8);
+
+    buffer.execute(rs);
+    std::vector<std::string> expected = {
+        "glUseProgram 3",
+        "glUniform1i 0 7",
+        "glUniform1f 1 1.5",
+        "glUniform3f 2 1 2 3",
+        "glUniformMatrix4fv 3 2 2 8 10 12",
+        "glUniform1i 0 8",
+    };
+    CHECK(FakeGl::callsTo({"glUseProgram", "glUniform"}) == expected);
+    program.dispose(rs);
+  }
+
+  SECTION("Reset removes the recorded commands") {
+    ShaderProgram program("", "");
+    UniformLocation a("u_a");
+    buffer.depthFunc(GL_LESS);
+    buffer.uniform(program, a, 1.f);
+    buffer.reset();
+    CHECK(buffer.empty());
+    buffer.execute(rs);
+    CHECK(FakeGl::calls.empty());
+  }
+}
@@ -0,0 +1,53 @@
+#include "catch.hpp"
+#include "debug/DebugDraw.hpp"
+
+using namespace stock;
+
+TEST_CASE("Debug shapes are removed when their lifetime ends", "[DebugDraw]") {
+  using Lifetime = DebugDraw::Lifetime;
+  auto start = DebugDraw::Clock::now();
+  auto later = [&](float seconds) {
+    return start + std::chrono::duration_cast<DebugDraw::Clock::duration>(std::chrono::duration<float>(seconds));
+  };
+  DebugDraw::clear();
+
+  SECTION("A shape with the default lifetime is removed after one flush") {
+    DebugDraw::point(glm::vec3(0.f));
+    DebugDraw::removeExpired(later(1.f));
+    CHECK(DebugDraw::shapeCount() == 0);
+  }
+
+  SECTION("A shape with a frame count is removed after that many flushes") {
+    DebugDraw::point(glm::vec3(0.f), Lifetime::frames(3));
+    DebugDraw::removeExpired(later(1.f));
+    DebugDraw::removeExpired(later(1.f));
+    CHECK(DebugDraw::shapeCount() == 1);
+    DebugDraw::removeExpired(later(1.f));
+    CHECK(DebugDraw::shapeCount() == 0);
+  }
+
+  SECTION("A shape with a duration is kept through any number of flushes until it expires") {
+    DebugDraw::point(glm::vec3(0.f), Lifetime::seconds(10.f));
+    for (int i = 0; i < 5; i++) {
+      DebugDraw::removeExpired(later(1.f));
+    }
+    CHECK(DebugDraw::shapeCount() == 1);
+    DebugDraw::removeExpired(later(11.f));
+    CHECK(DebugDraw::shapeCount() == 0);
+  }
+
+  SECTION("A shape with both a frame count and a duration is kept until both have passed") {
+    Lifetime lifetime = Lifetime::seconds(10.f);
+    lifetime.frameCount = 3;
+    DebugDraw::point(glm::vec3(0.f), lifetime);
+    DebugDraw::removeExpired(later(11.f));
+    CHECK(DebugDraw::shapeCount() == 1);
+    DebugDraw::removeExpired(later(1.f));
+    DebugDraw::removeExpired(later(1.f));
+    CHECK(DebugDraw::shapeCount() == 1);
+    DebugDraw::removeExpired(later(11.f));
+    CHECK(DebugDraw::shapeCount() == 0);
+  }
+
+  DebugDraw::clear();
+}
@@ -0,0 +1,86 @@
+#include "catch.hpp"
+#include "FakeGl.hpp"
+#include "gl/DeletionQueue.hpp"
+#include "gl/DynamicResolution.hpp"
+#include "gl/Extensions.hpp"
+#include "gl/RenderState.hpp"
+#include <string>
+#include <vector>
+
+using namespace stock;
+
+TEST_CASE("Deletion queue deletes handles once the frames that enqueued them retire", "[DeletionQueue]") {
+  FakeGl gl;
+  RenderState rs;
+  DeletionQueue queue;
+
+  SECTION("With fences, batches are deleted in order when their fence is signaled") {
+    Extensions::sync = true;
+    queue.enqueue(DeletionQueue::HandleType::TEXTURE, 5);
+    queue.enqueue(DeletionQueue::HandleType::BUFFER, 6);
+    queue.endFrame(rs);
+    queue.enqueue(DeletionQueue::HandleType::PROGRAM, 7);
+    queue.enqueue(DeletionQueue::HandleType::SHADER, 0);
+    queue.endFrame(rs);
+    CHECK(FakeGl::calls == std::vector<std::string>{"glFenceSync 1", "glFenceSync 2"});
+
+    // Without a signal, nothing is deleted however many frames pass.
+    for (uint64_t i = 0; i < DeletionQueue::FRAME_DELAY * 2; i++) {
+      queue.endFrame(rs);
+    }
+    CHECK(FakeGl::callsTo({"glDelete"}).empty());
+
+    FakeGl::signaledFence = 1;
+    queue.endFrame(rs);
+    CHECK(FakeGl::callsTo({"glDelete"}) ==
+          std::vector<std::string>{"glDeleteSync 1", "glDeleteTextures 5", "glDeleteBuffers 6"});
+
+    FakeGl::calls.clear();
+    FakeGl::signaledFence = 2;
+    queue.endFrame(rs);
+    CHECK(FakeGl::callsTo({"glDelete"}) == std::vector<std::string>{"glDeleteSync 2", "glDeleteProgram 7"});
+  }
+
+  SECTION("Without fences, batches are deleted after a fixed number of frames") {
+    queue.enqueue(DeletionQueue::HandleType::RENDERBUFFER, 3);
+    queue.endFrame(rs);
+    queue.enqueue(DeletionQueue::HandleType::FRAMEBUFFER, 4);
+    queue.endFrame(rs);
+    queue.endFrame(rs);
+    CHECK(FakeGl::calls.empty());
+
+    queue.endFrame(rs);
+    CHECK(FakeGl::calls == std::vector<std::string>{"glDeleteRenderbuffers 3"});
+    queue.endFrame(rs);
+    CHECK(FakeGl::calls == std::vector<std::string>{"glDeleteRenderbuffers 3", "glDeleteFramebuffers 4"});
+  }
+
+  SECTION("Deleted handles are cleared from the render state bindings") {
+    rs.shaderProgram(7);
+    rs.vertexBuffer(6);
+    rs.texture(GL_TEXTURE_2D, 0, 5);
+    queue.enqueue(DeletionQueue::HandleType::PROGRAM, 7);
+    queue.enqueue(DeletionQueue::HandleType::BUFFER, 6);
+    queue.enqueue(DeletionQueue::HandleType::TEXTURE, 5);
+    queue.dispose(rs);
+
+    // The GL may reuse the names, so binding them again must reach the GL.
+    CHECK_FALSE(rs.shaderProgram(7));
+    CHECK_FALSE(rs.vertexBuffer(6));
+    CHECK_FALSE(rs.texture(GL_TEXTURE_2D, 0, 5));
+  }
+
+  SECTION("Dynamic resolution hands the framebuffer replaced on resize to the queue") {
+    DynamicResolution resolution;
+    resolution.setDeletionQueue(&queue);
+    resolution.bind(rs, 64, 64);
+    resolution.bind(rs, 128, 128);
+    CHECK(FakeGl::callsTo({"glDeleteFramebuffers"}).empty());
+
+    for (uint64_t i = 0; i <= DeletionQueue::FRAME_DELAY; i++) {
+      queue.endFrame(rs);
+    }
+    CHECK(FakeGl::callsTo({"glDeleteFramebuffers"}).size() == 1);
+    resolution.dispose(rs);
+  }
+}
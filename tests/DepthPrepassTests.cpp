@@ -0,0 +1,39 @@
+#include "catch.hpp"
+#include "gl/DepthPrepass.hpp"
+#include "gl/ShaderProgram.hpp"
+#include <new>
+
+using namespace stock;
+
+TEST_CASE("Depth pre-pass variants keep the vertex shader of their program", "[DepthPrepass]") {
+  ShaderProgram a("void main() { gl_FragColor = vec4(1.); }", "void main() { gl_Position = vec4(0.); }");
+  ShaderProgram b("void main() { gl_FragColor = vec4(1.); }", "void main() { gl_Position = vec4(1.); }");
+  DepthPrepass prepass;
+
+  auto& variant = prepass.depthOnlyProgram(a);
+  CHECK(&variant != &a);
+  CHECK(variant.getVertexShaderSource() == a.getVertexShaderSource());
+  CHECK(variant.getFragmentShaderSource() != a.getFragmentShaderSource());
+
+  // Variants are created once per program.
+  CHECK(&prepass.depthOnlyProgram(a) == &variant);
+  CHECK(&prepass.depthOnlyProgram(b) != &variant);
+
+  // Outside of the depth pass, programs are drawn as they are.
+  CHECK_FALSE(prepass.isDepthPass());
+  CHECK(&prepass.program(a) == &a);
+}
+
+TEST_CASE("Depth pre-pass variants follow a new program at the address of a destroyed one", "[DepthPrepass]") {
+  DepthPrepass prepass;
+  alignas(ShaderProgram) unsigned char storage[sizeof(ShaderProgram)];
+
+  auto* first = new (storage) ShaderProgram("", "void main() { gl_Position = vec4(0.); }");
+  CHECK(prepass.depthOnlyProgram(*first).getVertexShaderSource() == first->getVertexShaderSource());
+  first->~ShaderProgram();
+
+  auto* second = new (storage) ShaderProgram("", "void main() { gl_Position = vec4(1.); }");
+  REQUIRE(static_cast<void*>(second) == static_cast<void*>(first));
+  CHECK(prepass.depthOnlyProgram(*second).getVertexShaderSource() == second->getVertexShaderSource());
+  second->~ShaderProgram();
+}
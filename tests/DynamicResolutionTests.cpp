@@ -0,0 +1,52 @@
+#include "catch.hpp"
+#include "gl/DynamicResolution.hpp"
+
+using namespace stock;
+
+TEST_CASE("Dynamic resolution scales with GPU frame time", "[DynamicResolution]") {
+  DynamicResolution::Options options;
+  options.targetMilliseconds = 10.;
+  options.settleFrames = 2;
+  DynamicResolution resolution(options);
+  REQUIRE(resolution.scale() == Approx(1.f));
+
+  SECTION("A single slow frame doesn't change the scale") {
+    CHECK_FALSE(resolution.update(20.));
+    CHECK_FALSE(resolution.update(8.));
+    CHECK_FALSE(resolution.update(20.));
+    CHECK(resolution.scale() == Approx(1.f));
+  }
+
+  SECTION("Consecutive slow frames drop the scale toward the target, within the limits") {
+    CHECK_FALSE(resolution.update(20.));
+    CHECK_FALSE(resolution.update(20.));
+    CHECK(resolution.update(20.));
+    // Half of the pixels should take 10 ms, and the middle of the thresholds is 8 ms.
+    CHECK(resolution.scale() == Approx(.65f));
+
+    // Timings from before the change are ignored.
+    CHECK_FALSE(resolution.update(100.));
+    CHECK_FALSE(resolution.update(100.));
+    for (int i = 0; i < options.framesToDecrease; i++) {
+      resolution.update(100.);
+    }
+    CHECK(resolution.scale() == Approx(options.minScale));
+  }
+
+  SECTION("The scale rises one step after many fast frames") {
+    resolution.setScale(.6f);
+    for (int i = 0; i < options.framesToIncrease - 1; i++) {
+      CHECK_FALSE(resolution.update(2.));
+    }
+    CHECK(resolution.update(2.));
+    CHECK(resolution.scale() == Approx(.65f));
+  }
+
+  SECTION("Frame times between the thresholds keep the scale") {
+    resolution.setScale(.8f);
+    for (int i = 0; i < 100; i++) {
+      CHECK_FALSE(resolution.update(8.));
+    }
+    CHECK(resolution.scale() == Approx(.8f));
+  }
+}
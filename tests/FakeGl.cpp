@@ -0,0 +1,8 @@
+#include "FakeGl.hpp"
+
+std::vector<std::string> FakeGl::calls;
+uintptr_t FakeGl::signaledFence = 0;
+std::map<std::string, GLint> FakeGl::uniformLocations;
+std::map<std::string, GLint> FakeGl::attributeLocations;
+GLuint FakeGl::lastHandle = 0;
+uintptr_t FakeGl::lastFence = 0;
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "gl/Extensions.hpp"
+#include "gl/GL.hpp"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// FakeGl replaces the GL functions that the library calls with stubs that log their calls, so code that renders can
+// be tested without a GL context. Objects get increasing handles, shaders always compile, framebuffers are always
+// complete, and all extensions are reported as unsupported until a test enables them. The previous functions and
+// extension flags are restored on destruction.
+struct FakeGl {
+  static std::vector<std::string> calls;
+
+  // Fences with an ID up to this one are reported as signaled.
+  static uintptr_t signaledFence;
+
+  static std::map<std::string, GLint> uniformLocations;
+  static std::map<std::string, GLint> attributeLocations;
+  static GLuint lastHandle;
+  static uintptr_t lastFence;
+
+  template <typename... Args>
+  static void log(const char* name, Args... args) {
+    std::ostringstream stream;
+    stream << name;
+    for (auto value : {static_cast<double>(args)...}) {
+      stream << ' ' << value;
+    }
+    calls.push_back(stream.str());
+  }
+
+  // Get the logged calls to functions whose names start with any of 'prefixes'.
+  static std::vector<std::string> callsTo(std::initializer_list<const char*> prefixes) {
+    std::vector<std::string> result;
+    for (const auto& call : calls) {
+      for (auto prefix : prefixes) {
+        if (call.compare(0, std::string(prefix).size(), prefix) == 0) {
+          result.push_back(call);
+          break;
+        }
+      }
+    }
+    return result;
+  }
+
+  static GLint location(std::map<std::string, GLint>& locations, const GLchar* name) {
+    auto it = locations.find(name);
+    if (it == locations.end()) {
+      it = locations.emplace(name, static_cast<GLint>(locations.size())).first;
+    }
+    return it->second;
+  }
+
+  static void generate(const char* name, GLsizei n, GLuint* handles) {
+    for (GLsizei i = 0; i < n; i++) {
+      handles[i] = ++lastHandle;
+      log(name, handles[i]);
+    }
+  }
+
+  static void remove(const char* name, GLsizei n, const GLuint* handles) {
+    for (GLsizei i = 0; i < n; i++) {
+      log(name, handles[i]);
+    }
+  }
+
+  // Errors, state, and drawing.
+  static GLenum APIENTRY getError() { return GL_NO_ERROR; }
+  static void APIENTRY getIntegerv(GLenum, GLint* value) { *value = 0; }
+  static void APIENTRY enable(GLenum cap) { log("glEnable", cap); }
+  static void APIENTRY disable(GLenum cap) { log("glDisable", cap); }
+  static void APIENTRY blendFuncSeparate(GLenum a, GLenum b, GLenum c, GLenum d) { log("glBlendFunc", a, b, c, d); }
+  static void APIENTRY blendEquation(GLenum mode) { log("glBlendEquation", mode); }
+  static void APIENTRY depthFunc(GLenum func) { log("glDepthFunc", func); }
+  static void APIENTRY depthMask(GLboolean flag) { log("glDepthMask", flag); }
+  static void APIENTRY colorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) { log("glColorMask", r, g, b, a); }
+  static void APIENTRY clearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) { log("glClearColor", r, g, b, a); }
+  static void APIENTRY scissor(GLint x, GLint y, GLsizei w, GLsizei h) { log("glScissor", x, y, w, h); }
+  static void APIENTRY viewport(GLint x, GLint y, GLsizei w, GLsizei h) { log("glViewport", x, y, w, h); }
+  static void APIENTRY clear(GLbitfield mask) { log("glClear", mask); }
+  static void APIENTRY drawArrays(GLenum mode, GLint first, GLsizei count) { log("glDrawArrays", mode, first, count); }
+  static void APIENTRY drawElements(GLenum mode, GLsizei count, GLenum type, const void*) {
+    log("glDrawElements", mode, count, type);
+  }
+
+  // Shaders and uniforms.
+  static GLuint APIENTRY createShader(GLenum) { return ++lastHandle; }
+  static void APIENTRY shaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) {}
+  static void APIENTRY compileShader(GLuint) {}
+  static void APIENTRY getShaderiv(GLuint, GLenum, GLint* value) { *value = GL_TRUE; }
+  static GLuint APIENTRY createProgram() { return ++lastHandle; }
+  static void APIENTRY attachShader(GLuint, GLuint) {}
+  static void APIENTRY linkProgram(GLuint) {}
+  static void APIENTRY getProgramiv(GLuint, GLenum, GLint* value) { *value = GL_TRUE; }
+  static void APIENTRY deleteShader(GLuint shader) { log("glDeleteShader", shader); }
+  static void APIENTRY deleteProgram(GLuint program) { log("glDeleteProgram", program); }
+  static void APIENTRY useProgram(GLuint program) { log("glUseProgram", program); }
+  static GLint APIENTRY getUniformLocation(GLuint, const GLchar* name) { return location(uniformLocations, name); }
+  static GLint APIENTRY getAttribLocation(GLuint, const GLchar* name) { return location(attributeLocations, name); }
+  static void APIENTRY uniform1i(GLint location, GLint v0) { log("glUniform1i", location, v0); }
+  static void APIENTRY uniform1f(GLint location, GLfloat v0) { log("glUniform1f", location, v0); }
+  static void APIENTRY uniform2f(GLint location, GLfloat v0, GLfloat v1) { log("glUniform2f", location, v0, v1); }
+  static void APIENTRY uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+    log("glUniform3f", location, v0, v1, v2);
+  }
+  static void APIENTRY uniformMatrix4fv(GLint location, GLsizei, GLboolean, const GLfloat* v) {
+    log("glUniformMatrix4fv", location, v[0], v[5], v[12], v[13], v[14]);
+  }
+
+  // Buffers and vertex attributes.
+  static void APIENTRY genBuffers(GLsizei n, GLuint* buffers) { generate("glGenBuffers", n, buffers); }
+  static void APIENTRY deleteBuffers(GLsizei n, const GLuint* buffers) { remove("glDeleteBuffers", n, buffers); }
+  static void APIENTRY bindBuffer(GLenum target, GLuint buffer) { log("glBindBuffer", target, buffer); }
+  static void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void*, GLenum) {
+    log("glBufferData", target, size);
+  }
+  static void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void*) {
+    log("glBufferSubData", target, offset, size);
+  }
+  static void APIENTRY enableVertexAttribArray(GLuint index) { log("glEnableVertexAttribArray", index); }
+  static void APIENTRY disableVertexAttribArray(GLuint index) { log("glDisableVertexAttribArray", index); }
+  static void APIENTRY vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean, GLsizei, const void*) {
+    log("glVertexAttribPointer", index, size, type);
+  }
+
+  // Textures, renderbuffers, and framebuffers.
+  static void APIENTRY genTextures(GLsizei n, GLuint* textures) { generate("glGenTextures", n, textures); }
+  static void APIENTRY deleteTextures(GLsizei n, const GLuint* textures) { remove("glDeleteTextures", n, textures); }
+  static void APIENTRY activeTexture(GLenum unit) { log("glActiveTexture", unit); }
+  static void APIENTRY bindTexture(GLenum target, GLuint texture) { log("glBindTexture", target, texture); }
+  static void APIENTRY texParameteri(GLenum, GLenum, GLint) {}
+  static void APIENTRY texImage2D(GLenum, GLint, GLint format, GLsizei width, GLsizei height, GLint, GLenum, GLenum,
+                                  const void*) {
+    log("glTexImage2D", format, width, height);
+  }
+  static void APIENTRY genRenderbuffers(GLsizei n, GLuint* buffers) { generate("glGenRenderbuffers", n, buffers); }
+  static void APIENTRY deleteRenderbuffers(GLsizei n, const GLuint* buffers) {
+    remove("glDeleteRenderbuffers", n, buffers);
+  }
+  static void APIENTRY bindRenderbuffer(GLenum, GLuint buffer) { log("glBindRenderbuffer", buffer); }
+  static void APIENTRY renderbufferStorage(GLenum, GLenum format, GLsizei width, GLsizei height) {
+    log("glRenderbufferStorage", format, width, height);
+  }
+  static void APIENTRY genFramebuffers(GLsizei n, GLuint* buffers) { generate("glGenFramebuffers", n, buffers); }
+  static void APIENTRY deleteFramebuffers(GLsizei n, const GLuint* buffers) {
+    remove("glDeleteFramebuffers", n, buffers);
+  }
+  static void APIENTRY bindFramebuffer(GLenum, GLuint buffer) { log("glBindFramebuffer", buffer); }
+  static void APIENTRY framebufferTexture2D(GLenum, GLenum attachment, GLenum, GLuint texture, GLint) {
+    log("glFramebufferTexture2D", attachment, texture);
+  }
+  static void APIENTRY framebufferRenderbuffer(GLenum, GLenum attachment, GLenum, GLuint buffer) {
+    log("glFramebufferRenderbuffer", attachment, buffer);
+  }
+  static GLenum APIENTRY checkFramebufferStatus(GLenum) { return GL_FRAMEBUFFER_COMPLETE; }
+
+  // Queries and fences from extensions.
+  static void APIENTRY deleteQueries(GLsizei n, const GLuint* queries) { remove("glDeleteQueries", n, queries); }
+  static GLsync APIENTRY fenceSync(GLenum, GLbitfield) {
+    log("glFenceSync", lastFence + 1);
+    return reinterpret_cast<GLsync>(++lastFence);
+  }
+  static GLenum APIENTRY clientWaitSync(GLsync sync, GLbitfield, GLuint64) {
+    return reinterpret_cast<uintptr_t>(sync) <= signaledFence ? GL_ALREADY_SIGNALED_APPLE : GL_TIMEOUT_EXPIRED_APPLE;
+  }
+  static void APIENTRY deleteSync(GLsync sync) { log("glDeleteSync", reinterpret_cast<uintptr_t>(sync)); }
+
+  FakeGl() {
+    calls.clear();
+    uniformLocations.clear();
+    attributeLocations.clear();
+    lastHandle = 0;
+    lastFence = 0;
+    signaledFence = 0;
+
+    swap(glad_glGetError, getError);
+    swap(glad_glGetIntegerv, getIntegerv);
+    swap(glad_glEnable, enable);
+    swap(glad_glDisable, disable);
+    swap(glad_glBlendFuncSeparate, blendFuncSeparate);
+    swap(glad_glBlendEquation, blendEquation);
+    swap(glad_glDepthFunc, depthFunc);
+    swap(glad_glDepthMask, depthMask);
+    swap(glad_glColorMask, colorMask);
+    swap(glad_glClearColor, clearColor);
+    swap(glad_glScissor, scissor);
+    swap(glad_glViewport, viewport);
+    swap(glad_glClear, clear);
+    swap(glad_glDrawArrays, drawArrays);
+    swap(glad_glDrawElements, drawElements);
+
+    swap(glad_glCreateShader, createShader);
+    swap(glad_glShaderSource, shaderSource);
+    swap(glad_glCompileShader, compileShader);
+    swap(glad_glGetShaderiv, getShaderiv);
+    swap(glad_glCreateProgram, createProgram);
+    swap(glad_glAttachShader, attachShader);
+    swap(glad_glLinkProgram, linkProgram);
+    swap(glad_glGetProgramiv, getProgramiv);
+    swap(glad_glDeleteShader, deleteShader);
+    swap(glad_glDeleteProgram, deleteProgram);
+    swap(glad_glUseProgram, useProgram);
+    swap(glad_glGetUniformLocation, getUniformLocation);
+    swap(glad_glGetAttribLocation, getAttribLocation);
+    swap(glad_glUniform1i, uniform1i);
+    swap(glad_glUniform1f, uniform1f);
+    swap(glad_glUniform2f, uniform2f);
+    swap(glad_glUniform3f, uniform3f);
+    swap(glad_glUniformMatrix4fv, uniformMatrix4fv);
+
+    swap(glad_glGenBuffers, genBuffers);
+    swap(glad_glDeleteBuffers, deleteBuffers);
+    swap(glad_glBindBuffer, bindBuffer);
+    swap(glad_glBufferData, bufferData);
+    swap(glad_glBufferSubData, bufferSubData);
+    swap(glad_glEnableVertexAttribArray, enableVertexAttribArray);
+    swap(glad_glDisableVertexAttribArray, disableVertexAttribArray);
+    swap(glad_glVertexAttribPointer, vertexAttribPointer);
+
+    swap(glad_glGenTextures, genTextures);
+    swap(glad_glDeleteTextures, deleteTextures);
+    swap(glad_glActiveTexture, activeTexture);
+    swap(glad_glBindTexture, bindTexture);
+    swap(glad_glTexParameteri, texParameteri);
+    swap(glad_glTexImage2D, texImage2D);
+    swap(glad_glGenRenderbuffers, genRenderbuffers);
+    swap(glad_glDeleteRenderbuffers, deleteRenderbuffers);
+    swap(glad_glBindRenderbuffer, bindRenderbuffer);
+    swap(glad_glRenderbufferStorage, renderbufferStorage);
+    swap(glad_glGenFramebuffers, genFramebuffers);
+    swap(glad_glDeleteFramebuffers, deleteFramebuffers);
+    swap(glad_glBindFramebuffer, bindFramebuffer);
+    swap(glad_glFramebufferTexture2D, framebufferTexture2D);
+    swap(glad_glFramebufferRenderbuffer, framebufferRenderbuffer);
+    swap(glad_glCheckFramebufferStatus, checkFramebufferStatus);
+
+    swap(stock_glDeleteQueriesEXT, deleteQueries);
+    swap(stock_glFenceSyncAPPLE, fenceSync);
+    swap(stock_glClientWaitSyncAPPLE, clientWaitSync);
+    swap(stock_glDeleteSyncAPPLE, deleteSync);
+
+    using stock::Extensions;
+    for (bool* flag : {&Extensions::timerQuery, &Extensions::occlusionQuery, &Extensions::sync,
+                       &Extensions::multisampledRenderToTexture, &Extensions::framebufferBlit,
+                       &Extensions::appleFramebufferMultisample, &Extensions::packedDepthStencil,
+                       &Extensions::depthTexture, &Extensions::discardFramebuffer, &Extensions::pixelBufferObject,
+                       &Extensions::instancedArrays}) {
+      swap(*flag, false);
+    }
+    swap(Extensions::maxSamples, 0);
+  }
+
+  ~FakeGl() {
+    for (auto it = m_restore.rbegin(); it != m_restore.rend(); ++it) {
+      (*it)();
+    }
+  }
+
+  template <typename T>
+  void swap(T& value, T fake) {
+    T previous = value;
+    value = fake;
+    m_restore.push_back([&value, previous]() { value = previous; });
+  }
+
+  std::vector<std::function<void()>> m_restore;
+};
@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "FramePacer.hpp"
+
+using namespace stock;
+
+TEST_CASE("Frame pacer schedules frames at the target rate", "[FramePacer]") {
+  FramePacer::Options options;
+  options.targetFrameRate = 200.;
+  using Clock = FramePacer::Clock;
+
+  SECTION("Consecutive frames start no sooner than one interval apart") {
+    options.lowLatency = false;
+    FramePacer pacer(options);
+    pacer.waitForNextFrame();
+    auto start = Clock::now();
+    for (int i = 0; i < 4; i++) {
+      pacer.endFrame();
+      pacer.waitForNextFrame();
+    }
+    CHECK(Clock::now() - start >= std::chrono::milliseconds(15));
+  }
+
+  SECTION("Low latency mode starts frames just in time to finish at their deadlines") {
+    FramePacer pacer(options);
+    pacer.waitForNextFrame();
+    auto start = Clock::now();
+    pacer.endFrame(2.);
+    CHECK(pacer.predictedMilliseconds() >= 2.);
+    double lead = pacer.predictedMilliseconds() + options.marginMilliseconds;
+    pacer.waitForNextFrame();
+    // The second frame is due one interval after the first started, and starts when its predicted time is left.
+    std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+    CHECK(elapsed.count() >= 5. - lead - 0.5);
+  }
+
+  SECTION("Waits end at the requested time") {
+    auto time = Clock::now() + std::chrono::milliseconds(3);
+    FramePacer::waitUntil(time, 1.);
+    CHECK(Clock::now() >= time);
+  }
+}
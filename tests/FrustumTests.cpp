@@ -0,0 +1,78 @@
+#include "catch.hpp"
+#include "view/Camera.hpp"
+#include "view/Frustum.hpp"
+#include <random>
+#include <vector>
+
+using namespace stock;
+
+TEST_CASE("Perspective camera frustum contains points in front of the camera", "[Frustum]") {
+  Camera camera(800.f, 600.f, Camera::Options());
+  auto frustum = camera.frustum();
+
+  // The camera looks along Transform::FORWARD from the origin.
+  CHECK(frustum.intersectsSphere({0.f, 10.f, 0.f}, 1.f));
+  CHECK(frustum.intersectsSphere({0.f, 999.f, 0.f}, 0.5f));
+
+  CHECK_FALSE(frustum.intersectsSphere({0.f, -10.f, 0.f}, 1.f));
+  CHECK_FALSE(frustum.intersectsSphere({0.f, 1100.f, 0.f}, 1.f));
+  CHECK_FALSE(frustum.intersectsSphere({100.f, 10.f, 0.f}, 1.f));
+  CHECK_FALSE(frustum.intersectsSphere({0.f, 10.f, 100.f}, 1.f));
+
+  CHECK(frustum.intersectsBox(BoundingBox({-1.f, 5.f, -1.f}, {1.f, 6.f, 1.f})));
+  CHECK(frustum.intersectsBox(BoundingBox({-100.f, -5.f, -100.f}, {100.f, 5.f, 100.f})));
+  CHECK_FALSE(frustum.intersectsBox(BoundingBox({-1.f, -6.f, -1.f}, {1.f, -5.f, 1.f})));
+}
+
+TEST_CASE("Orthographic camera frustum is bounded by the camera size", "[Frustum]") {
+  Camera::Options options;
+  options.type = Camera::Type::ORTHOGRAPHIC;
+  Camera camera(100.f, 50.f, options);
+  auto frustum = camera.frustum();
+
+  CHECK(frustum.intersectsSphere({45.f, 10.f, 0.f}, 1.f));
+  CHECK(frustum.intersectsSphere({-45.f, 10.f, 20.f}, 1.f));
+  CHECK_FALSE(frustum.intersectsSphere({55.f, 10.f, 0.f}, 1.f));
+  CHECK_FALSE(frustum.intersectsSphere({0.f, 10.f, 30.f}, 1.f));
+
+  CHECK(frustum.intersectsBox(BoundingBox({49.f, 10.f, 0.f}, {52.f, 11.f, 1.f})));
+  CHECK_FALSE(frustum.intersectsBox(BoundingBox({51.f, 10.f, 0.f}, {52.f, 11.f, 1.f})));
+}
+
+TEST_CASE("Batch visibility tests match single tests", "[Frustum]") {
+  Camera camera(800.f, 600.f, Camera::Options());
+  camera.transform().position() = {3.f, -20.f, 5.f};
+  camera.lookAt({0.f, 0.f, 0.f});
+  auto frustum = camera.frustum();
+
+  // Use a count that is not a multiple of the SIMD width to cover the remainder loop.
+  const size_t count = 1001;
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> position(-100.f, 100.f), size(0.f, 10.f);
+  std::vector<float> x(count), y(count), z(count), r(count), maxX(count), maxY(count), maxZ(count);
+  for (size_t i = 0; i < count; i++) {
+    x[i] = position(random);
+    y[i] = position(random);
+    z[i] = position(random);
+    r[i] = size(random);
+    maxX[i] = x[i] + size(random);
+    maxY[i] = y[i] + size(random);
+    maxZ[i] = z[i] + size(random);
+  }
+
+  SECTION("Spheres") {
+    std::vector<uint8_t> visible(count);
+    frustum.testSpheres(x.data(), y.data(), z.data(), r.data(), count, visible.data());
+    for (size_t i = 0; i < count; i++) {
+      CHECK(visible[i] == frustum.intersectsSphere({x[i], y[i], z[i]}, r[i]));
+    }
+  }
+
+  SECTION("Boxes") {
+    std::vector<uint8_t> visible(count);
+    frustum.testBoxes(x.data(), y.data(), z.data(), maxX.data(), maxY.data(), maxZ.data(), count, visible.data());
+    for (size_t i = 0; i < count; i++) {
+      CHECK(visible[i] == frustum.intersectsBox(BoundingBox({x[i], y[i], z[i]}, {maxX[i], maxY[i], maxZ[i]})));
+    }
+  }
+}
@@ -0,0 +1,56 @@
+#include "catch.hpp"
+#include "FakeGl.hpp"
+#include "ImGuiImpl.hpp"
+#include "gl/RenderState.hpp"
+#include "imgui.h"
+
+using namespace stock;
+
+TEST_CASE("Cached UI rendering redraws only when the draw data changes", "[ImGuiImpl]") {
+  FakeGl gl;
+  RenderState rs;
+  ImGui::CreateContext();
+  ImGui::GetIO().IniFilename = nullptr;
+  ImGui::GetIO().DisplaySize = ImVec2(64.f, 64.f);
+  ImGuiImpl::CreateDeviceObjects(rs);
+  ImGuiImpl::SetCachedRendering(true);
+
+  ImDrawList list(ImGui::GetDrawListSharedData());
+  list.PushClipRect(ImVec2(0.f, 0.f), ImVec2(64.f, 64.f));
+  list.AddRectFilled(ImVec2(4.f, 4.f), ImVec2(20.f, 20.f), IM_COL32(255, 0, 0, 255));
+  ImDrawList* lists[] = {&list};
+  ImDrawData data;
+  data.Valid = true;
+  data.CmdLists = lists;
+  data.CmdListsCount = 1;
+  auto render = [&]() {
+    data.TotalVtxCount = list.VtxBuffer.Size;
+    data.TotalIdxCount = list.IdxBuffer.Size;
+    FakeGl::calls.clear();
+    ImGuiImpl::RenderDrawData(rs, &data);
+  };
+
+  // The first frame draws the UI into the cache and composites it.
+  render();
+  CHECK_FALSE(FakeGl::callsTo({"glBufferSubData"}).empty());
+  CHECK(FakeGl::callsTo({"glDrawElements"}).size() == 1);
+  CHECK(FakeGl::callsTo({"glDrawArrays"}).size() == 1);
+
+  SECTION("An unchanged draw list only composites the cache") {
+    render();
+    CHECK(FakeGl::callsTo({"glBufferSubData", "glDrawElements"}).empty());
+    CHECK(FakeGl::callsTo({"glDrawArrays"}).size() == 1);
+  }
+
+  SECTION("A changed draw list is uploaded and drawn again") {
+    list.AddRectFilled(ImVec2(24.f, 4.f), ImVec2(40.f, 20.f), IM_COL32(0, 255, 0, 255));
+    render();
+    CHECK_FALSE(FakeGl::callsTo({"glBufferSubData"}).empty());
+    CHECK(FakeGl::callsTo({"glDrawElements"}).size() == 1);
+    CHECK(FakeGl::callsTo({"glDrawArrays"}).size() == 1);
+  }
+
+  ImGuiImpl::SetCachedRendering(false);
+  ImGuiImpl::InvalidateDeviceObjects(rs);
+  ImGui::DestroyContext();
+}
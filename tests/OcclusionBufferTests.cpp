@@ -0,0 +1,64 @@
+#include "catch.hpp"
+#include "view/Camera.hpp"
+#include "view/OcclusionBuffer.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <vector>
+
+using namespace stock;
+
+// A 20x20 wall facing the camera, 10 units in front of it.
+static const std::vector<glm::vec3> wallPositions = {
+    {-10.f, 10.f, -10.f}, {10.f, 10.f, -10.f}, {10.f, 10.f, 10.f}, {-10.f, 10.f, 10.f}};
+static const std::vector<uint16_t> wallIndices = {0, 1, 2, 0, 2, 3};
+
+TEST_CASE("Occlusion buffer hides boxes behind occluders", "[OcclusionBuffer]") {
+  Camera camera(800.f, 600.f, Camera::Options());
+  OcclusionBuffer buffer;
+  buffer.begin(camera.viewProjectionMatrix());
+  buffer.addOccluder(wallPositions, wallIndices, glm::mat4(1.f));
+  buffer.render();
+  CHECK(buffer.triangleCount() == 2);
+
+  // The camera looks along Transform::FORWARD from the origin.
+  CHECK_FALSE(buffer.isVisible(BoundingBox({-1.f, 20.f, -1.f}, {1.f, 22.f, 1.f})));
+  CHECK(buffer.isVisible(BoundingBox({-1.f, 5.f, -1.f}, {1.f, 7.f, 1.f})));
+  CHECK(buffer.isVisible(BoundingBox({-1.f, 5.f, -1.f}, {1.f, 22.f, 1.f})));
+
+  // Boxes crossing the near plane are always visible.
+  CHECK(buffer.isVisible(BoundingBox({-1.f, -1.f, -1.f}, {1.f, 1.f, 1.f})));
+
+  // Moving the occluder aside reveals the box.
+  buffer.begin(camera.viewProjectionMatrix());
+  buffer.addOccluder(wallPositions, wallIndices, glm::translate(glm::mat4(1.f), glm::vec3(30.f, 0.f, 0.f)));
+  buffer.render();
+  CHECK(buffer.isVisible(BoundingBox({-1.f, 20.f, -1.f}, {1.f, 22.f, 1.f})));
+}
+
+TEST_CASE("Occlusion buffer rasterizes the same depth with and without worker threads", "[OcclusionBuffer]") {
+  Camera camera(800.f, 600.f, Camera::Options());
+  camera.transform().position() = {3.f, -20.f, 5.f};
+  camera.lookAt({0.f, 0.f, 0.f});
+
+  OcclusionBuffer::Options options;
+  options.numberOfThreads = 0;
+  OcclusionBuffer single(options);
+  options.numberOfThreads = 4;
+  OcclusionBuffer threaded(options);
+
+  for (auto* buffer : {&single, &threaded}) {
+    buffer->begin(camera.viewProjectionMatrix());
+    for (int i = 0; i < 8; i++) {
+      auto model = glm::rotate(glm::translate(glm::mat4(1.f), glm::vec3(i * 3.f - 12.f, i * 2.f, 0.f)), i * .4f,
+                               glm::vec3(0.f, 0.f, 1.f));
+      buffer->addOccluder(wallPositions, wallIndices, model);
+    }
+    buffer->render();
+  }
+
+  size_t covered = 0;
+  for (uint32_t i = 0; i < single.width() * single.height(); i++) {
+    CHECK(single.depth()[i] == threaded.depth()[i]);
+    covered += single.depth()[i] < 1.f;
+  }
+  CHECK(covered > 0);
+}
@@ -0,0 +1,44 @@
+#include "catch.hpp"
+#include "gl/Pixmap.hpp"
+#include <cstdlib>
+#include <cstring>
+
+using namespace stock;
+
+static Pixmap makeGradient(uint32_t width, uint32_t height, Pixmap::PixelFormat format, uint32_t components) {
+  auto pixels = static_cast<uint8_t*>(std::malloc(width * height * components));
+  for (uint32_t i = 0; i < width * height * components; i++) {
+    pixels[i] = static_cast<uint8_t>(i * 7 + i / 13);
+  }
+  return Pixmap(width, height, pixels, format);
+}
+
+TEST_CASE("Pixmap encodes PNG images that decode to the same pixels", "[Pixmap]") {
+  // The larger image needs more than one uncompressed deflate block.
+  for (uint32_t size : {3u, 200u}) {
+    INFO("size: " << size);
+    auto source = makeGradient(size, size + 1, Pixmap::PixelFormat::RGBA, 4);
+
+    auto png = source.encodePng();
+    REQUIRE_FALSE(png.empty());
+
+    Pixmap decoded(png);
+    REQUIRE(decoded.pixels() != nullptr);
+    CHECK(decoded.width() == source.width());
+    CHECK(decoded.height() == source.height());
+    CHECK(decoded.format() == Pixmap::PixelFormat::RGBA);
+    CHECK(std::memcmp(decoded.pixels(), source.pixels(), size * (size + 1) * 4) == 0);
+
+    decoded.dispose();
+    source.dispose();
+  }
+}
+
+TEST_CASE("Pixmap doesn't encode depth formats as PNG", "[Pixmap]") {
+  Pixmap depth(4, 4, nullptr, Pixmap::PixelFormat::DEPTH_COMPONENT, Pixmap::PixelType::UNSIGNED_INT);
+  CHECK(depth.encodePng().empty());
+
+  Pixmap depthStencil(4, 4, nullptr, Pixmap::PixelFormat::DEPTH_STENCIL, Pixmap::PixelType::UNSIGNED_INT_24_8);
+  CHECK(depthStencil.components() == 1);
+  CHECK(depthStencil.encodePng().empty());
+}
@@ -0,0 +1,99 @@
+#include "catch.hpp"
+#include "FakeGl.hpp"
+#include "gl/PostProcess.hpp"
+#include <sstream>
+
+using namespace stock;
+
+static const char* blur = "vec4 apply(vec2 uv) { return texture2D(u_input0, uv + u_texelSize0 * .5); }";
+static const char* composite = "vec4 apply(vec2 uv) { return texture2D(u_input0, uv) + texture2D(u_input1, uv); }";
+static const char* tonemap = "vec4 apply(vec4 color, vec2 uv) { return color / (color + 1.); }";
+static const char* vignette = "vec4 apply(vec4 color, vec2 uv) { return color * (1. - length(uv - .5)); }";
+
+TEST_CASE("Post-processing fuses color passes into the passes before them", "[PostProcess]") {
+  PostProcess chain;
+
+  SECTION("Color passes after a sampling pass share its draw") {
+    chain.addPass("blur", blur, .5f);
+    chain.addColorPass("tonemap", tonemap);
+    chain.addColorPass("vignette", vignette);
+    CHECK(chain.drawCount() == 1);
+    const auto& source = chain.drawSource(0);
+    CHECK(source.find("#define apply apply_0") != std::string::npos);
+    CHECK(source.find("color = apply_2(color, v_uv);") != std::string::npos);
+  }
+
+  SECTION("A chain of only color passes reads its input once") {
+    chain.addColorPass("tonemap", tonemap);
+    chain.addColorPass("vignette", vignette);
+    CHECK(chain.drawCount() == 1);
+    CHECK(chain.drawSource(0).find("vec4 color = texture2D(u_input0, v_uv);") != std::string::npos);
+  }
+
+  SECTION("Results read by later passes are not fused away") {
+    auto tonemapped = chain.addColorPass("tonemap", tonemap);
+    chain.addColorPass("vignette", vignette);
+    chain.addPass("composite", composite, 1.f, {tonemapped, tonemapped + 1});
+    CHECK(chain.drawCount() == 3);
+  }
+
+  SECTION("Fusing can be disabled") {
+    PostProcess::Options options;
+    options.fuseColorPasses = false;
+    PostProcess unfused(options);
+    unfused.addPass("blur", blur, .5f);
+    unfused.addColorPass("tonemap", tonemap);
+    CHECK(unfused.drawCount() == 2);
+  }
+}
+
+TEST_CASE("Post-processing passes ping-pong between render graph targets", "[PostProcess]") {
+  RenderGraph graph;
+  Framebuffer::Options sceneOptions;
+  sceneOptions.hasDepth = true;
+  auto scene = graph.createTarget("scene", 256, 256, sceneOptions);
+  graph.addPass("scene", {}, scene, nullptr);
+
+  // Bloom: blur at quarter resolution, then add it to the scene and tone map it into the backbuffer.
+  PostProcess chain;
+  auto down = chain.addPass("down", blur, .25f, {PostProcess::INPUT});
+  chain.addPass("blur 1", blur, .25f);
+  chain.addPass("blur 2", blur, .25f);
+  chain.addPass("blur 3", blur, .25f);
+  chain.addPass("composite", composite, 1.f, {PostProcess::INPUT, down + 3});
+  chain.addColorPass("tonemap", tonemap);
+  chain.addTo(graph, scene, RenderGraph::BACKBUFFER, 256, 256);
+
+  REQUIRE(graph.compile());
+  CHECK(graph.order().size() == 6);
+  // The scene, plus two quarter-resolution targets for the blurs.
+  CHECK(graph.framebufferCount() == 3);
+}
+
+TEST_CASE("Post-processing passes get the texel size of each input", "[PostProcess]") {
+  FakeGl gl;
+  RenderState rs;
+  RenderGraph graph;
+  graph.setBackbufferSize(400, 300);
+  auto scene = graph.createTarget("scene", 400, 300, Framebuffer::Options());
+  graph.addPass("scene", {}, scene, nullptr);
+
+  PostProcess chain;
+  chain.addPass("down", blur, .5f, {PostProcess::INPUT});
+  chain.addPass("blur", blur, .5f);
+  chain.addTo(graph, scene, RenderGraph::BACKBUFFER, 400, 300);
+  graph.execute(rs);
+
+  // Each pass reads a non-square target, so swapped or repeated dimensions show up in its texel size.
+  auto texelSize = FakeGl::uniformLocations.at("u_texelSize0");
+  std::ostringstream input, down;
+  input << "glUniform2f " << texelSize << ' ' << 1.f / 400.f << ' ' << 1.f / 300.f;
+  down << "glUniform2f " << texelSize << ' ' << 1.f / 200.f << ' ' << 1.f / 150.f;
+  auto texelSizes = FakeGl::callsTo({"glUniform2f"});
+  REQUIRE(texelSizes.size() == 2);
+  CHECK(texelSizes[0] == input.str());
+  CHECK(texelSizes[1] == down.str());
+
+  chain.dispose(rs);
+  graph.dispose(rs);
+}
@@ -0,0 +1,95 @@
+#include "catch.hpp"
+#include "gl/RenderGraph.hpp"
+
+using namespace stock;
+
+TEST_CASE("Render graph culls unused passes and orders the rest", "[RenderGraph]") {
+  RenderGraph graph;
+  Framebuffer::Options options;
+  auto scene = graph.createTarget("scene", 512, 512, options);
+  auto bloom = graph.createTarget("bloom", 512, 512, options);
+  auto picking = graph.createTarget("picking", 512, 512, options);
+
+  // Add passes out of order; the graph should run each pass after the passes it reads from.
+  auto composite = graph.addPass("composite", {scene, bloom}, RenderGraph::BACKBUFFER, nullptr);
+  auto bloomPass = graph.addPass("bloom", {scene}, bloom, nullptr);
+  auto scenePass = graph.addPass("scene", {}, scene, nullptr);
+  auto pickingPass = graph.addPass("picking", {}, picking, nullptr);
+  auto ui = graph.addPass("ui", {}, RenderGraph::BACKBUFFER, nullptr);
+
+  REQUIRE(graph.compile());
+  CHECK(graph.isCulled(pickingPass));
+  CHECK(graph.order() == std::vector<RenderGraph::PassId>{scenePass, bloomPass, composite, ui});
+
+  SECTION("Retained passes are not culled") {
+    graph.retain(pickingPass);
+    REQUIRE(graph.compile());
+    CHECK_FALSE(graph.isCulled(pickingPass));
+    CHECK(graph.order().size() == 5);
+  }
+}
+
+TEST_CASE("Render graph shares framebuffers between targets with disjoint lifetimes", "[RenderGraph]") {
+  RenderGraph graph;
+  Framebuffer::Options options;
+  Framebuffer::Options depthOptions;
+  depthOptions.hasDepth = true;
+
+  // A chain of post-processing passes, each reading only the previous target.
+  auto scene = graph.createTarget("scene", 256, 256, depthOptions);
+  auto a = graph.createTarget("a", 256, 256, options);
+  auto b = graph.createTarget("b", 256, 256, options);
+  auto c = graph.createTarget("c", 256, 256, options);
+  auto small = graph.createTarget("small", 128, 128, options);
+  graph.addPass("scene", {}, scene, nullptr);
+  graph.addPass("a", {scene}, a, nullptr);
+  graph.addPass("b", {a}, b, nullptr);
+  graph.addPass("small", {b}, small, nullptr);
+  graph.addPass("c", {small}, c, nullptr);
+  graph.addPass("present", {c}, RenderGraph::BACKBUFFER, nullptr);
+
+  REQUIRE(graph.compile());
+
+  // A target can't share with a target read by the pass writing it, but 'c' can reuse the framebuffer of 'a'.
+  CHECK(graph.framebufferIndex(a) != graph.framebufferIndex(b));
+  CHECK(graph.framebufferIndex(c) == graph.framebufferIndex(a));
+  CHECK(graph.framebufferIndex(scene) != graph.framebufferIndex(a));
+  CHECK(graph.framebufferCount() == 4);
+}
+
+TEST_CASE("Render graph rejects cycles and reads of unwritten targets", "[RenderGraph]") {
+  RenderGraph graph;
+  Framebuffer::Options options;
+  auto a = graph.createTarget("a", 64, 64, options);
+  auto b = graph.createTarget("b", 64, 64, options);
+  graph.addPass("a", {b}, a, nullptr);
+  graph.addPass("present", {a}, RenderGraph::BACKBUFFER, nullptr);
+  CHECK_FALSE(graph.compile());
+
+  graph.addPass("b", {a}, b, nullptr);
+  CHECK_FALSE(graph.compile());
+
+  graph.reset();
+  auto c = graph.createTarget("c", 64, 64, options);
+  graph.addPass("c", {}, c, nullptr);
+  graph.addPass("present", {c}, RenderGraph::BACKBUFFER, nullptr);
+  CHECK(graph.compile());
+}
+
+TEST_CASE("Render graph doesn't share framebuffers between targets with different sample counts", "[RenderGraph]") {
+  RenderGraph graph;
+  Framebuffer::Options options;
+  Framebuffer::Options multisampleOptions;
+  multisampleOptions.samples = 4;
+  auto scene = graph.createTarget("scene", 64, 64, multisampleOptions);
+  auto a = graph.createTarget("a", 64, 64, options);
+  auto b = graph.createTarget("b", 64, 64, options);
+  graph.addPass("scene", {}, scene, nullptr);
+  graph.addPass("a", {scene}, a, nullptr);
+  graph.addPass("b", {a}, b, nullptr);
+  graph.addPass("present", {b}, RenderGraph::BACKBUFFER, nullptr);
+
+  REQUIRE(graph.compile());
+  CHECK(graph.framebufferIndex(b) != graph.framebufferIndex(scene));
+  CHECK(graph.framebufferCount() == 3);
+}
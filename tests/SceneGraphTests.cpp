@@ -0,0 +1,84 @@
+#include "catch.hpp"
+#include "transform/SceneGraph.hpp"
+#include "glm/gtc/epsilon.hpp"
+#include "glm/vector_relational.hpp"
+
+using namespace stock;
+
+static bool approxEqual(const glm::vec3& a, const glm::vec3& b) {
+  return glm::all(glm::epsilonEqual(a, b, 1e-4f));
+}
+
+static glm::vec3 worldPoint(const SceneGraph& graph, SceneGraph::NodeId node, const glm::vec3& point) {
+  return glm::vec3(graph.worldMatrix(node) * glm::vec4(point, 1.f));
+}
+
+TEST_CASE("Scene graph world matrices compose local transforms", "[SceneGraph]") {
+  SceneGraph graph;
+  auto root = graph.create();
+  auto child = graph.create(root);
+
+  Transform rootTransform;
+  rootTransform.position() = {10.f, 0.f, 0.f};
+  rootTransform.rotate(Transform::UP, 1.5708f);
+  rootTransform.scale() = {2.f, 2.f, 2.f};
+  graph.setTransform(root, rootTransform);
+
+  Transform childTransform;
+  childTransform.position() = {0.f, 5.f, 1.f};
+  childTransform.rotate(Transform::RIGHT, 0.3f);
+  graph.setTransform(child, childTransform);
+
+  CHECK(graph.update() == 2);
+
+  glm::vec3 point(1.f, 2.f, 3.f);
+  CHECK(approxEqual(worldPoint(graph, root, point), rootTransform.convertLocalPointToWorld(point)));
+  auto expected = rootTransform.convertLocalPointToWorld(childTransform.convertLocalPointToWorld(point));
+  CHECK(approxEqual(worldPoint(graph, child, point), expected));
+}
+
+TEST_CASE("Scene graph only recomputes changed subtrees", "[SceneGraph]") {
+  SceneGraph graph;
+  auto a = graph.create();
+  auto b = graph.create();
+  auto a1 = graph.create(a);
+  auto a2 = graph.create(a);
+  auto a11 = graph.create(a1);
+  auto b1 = graph.create(b);
+
+  CHECK(graph.update() == 6);
+  CHECK(graph.update() == 0);
+
+  graph.setPosition(a1, {0.f, 0.f, 1.f});
+  CHECK(graph.update() == 2);
+  CHECK(approxEqual(worldPoint(graph, a11, glm::vec3(0.f)), {0.f, 0.f, 1.f}));
+
+  graph.setPosition(a, {1.f, 0.f, 0.f});
+  CHECK(graph.update() == 4);
+  CHECK(approxEqual(worldPoint(graph, a11, glm::vec3(0.f)), {1.f, 0.f, 1.f}));
+  CHECK(approxEqual(worldPoint(graph, a2, glm::vec3(0.f)), {1.f, 0.f, 0.f}));
+  CHECK(approxEqual(worldPoint(graph, b1, glm::vec3(0.f)), {0.f, 0.f, 0.f}));
+
+  SECTION("Reparenting moves the subtree") {
+    graph.setPosition(b, {0.f, 3.f, 0.f});
+    CHECK(graph.setParent(a1, b));
+    CHECK_FALSE(graph.setParent(b, a11));
+    CHECK(graph.update() == 4);
+    CHECK(graph.parent(a1) == b);
+    CHECK(approxEqual(worldPoint(graph, a11, glm::vec3(0.f)), {0.f, 3.f, 1.f}));
+  }
+
+  SECTION("Destroying a node destroys its descendants") {
+    graph.destroy(a1);
+    CHECK_FALSE(graph.isValid(a1));
+    CHECK_FALSE(graph.isValid(a11));
+    CHECK(graph.isValid(a2));
+    CHECK(graph.size() == 4);
+
+    auto c = graph.create(a2);
+    graph.setPosition(c, {0.f, 1.f, 0.f});
+    CHECK(graph.update() == 1);
+    CHECK(approxEqual(worldPoint(graph, c, glm::vec3(0.f)), {1.f, 1.f, 0.f}));
+    CHECK(approxEqual(worldPoint(graph, a2, glm::vec3(0.f)), {1.f, 0.f, 0.f}));
+  }
+}
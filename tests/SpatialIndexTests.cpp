@@ -0,0 +1,118 @@
+#include "catch.hpp"
+#include "transform/Transform.hpp"
+#include "view/Camera.hpp"
+#include "view/Frustum.hpp"
+#include "view/SpatialIndex.hpp"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace stock;
+
+TEST_CASE("Spatial index queries match brute force tests", "[SpatialIndex]") {
+  const uint32_t count = 500;
+  std::mt19937 random(11);
+  std::uniform_real_distribution<float> position(-100.f, 100.f), size(0.f, 5.f);
+
+  SpatialIndex::Options options;
+  options.margin = 0.f;
+  SpatialIndex index(options);
+  std::vector<BoundingBox> boxes(count);
+  for (uint32_t id = 0; id < count; id++) {
+    glm::vec3 min(position(random), position(random), position(random));
+    boxes[id] = BoundingBox(min, min + glm::vec3(size(random), size(random), size(random)));
+    index.insert(id, boxes[id]);
+  }
+
+  // Move some objects and remove others so the queries run on a restructured tree.
+  for (uint32_t id = 0; id < count; id += 3) {
+    glm::vec3 offset(position(random), position(random), position(random));
+    boxes[id] = BoundingBox(boxes[id].min() + offset, boxes[id].max() + offset);
+    index.update(id, boxes[id]);
+  }
+  for (uint32_t id = 1; id < count; id += 5) {
+    CHECK(index.remove(id));
+  }
+  CHECK_FALSE(index.remove(1));
+  CHECK(index.size() == count - count / 5);
+
+  // A balanced tree of 400 objects should be far shallower than a list.
+  CHECK(index.height() < 20);
+
+  auto expect = [&](std::vector<SpatialIndex::ObjectId> results, std::function<bool(const BoundingBox&)> test) {
+    std::sort(results.begin(), results.end());
+    std::vector<SpatialIndex::ObjectId> expected;
+    for (uint32_t id = 0; id < count; id++) {
+      if (index.contains(id) && test(boxes[id])) {
+        expected.push_back(id);
+      }
+    }
+    CHECK(results == expected);
+  };
+
+  SECTION("Frustum") {
+    Camera camera(800.f, 600.f, Camera::Options());
+    camera.transform().position() = {10.f, -50.f, 20.f};
+    camera.lookAt({0.f, 0.f, 0.f});
+    auto frustum = camera.frustum();
+    std::vector<SpatialIndex::ObjectId> results;
+    index.queryFrustum(frustum, results);
+    expect(results, [&](const BoundingBox& box) { return frustum.intersectsBox(box); });
+  }
+
+  SECTION("Sphere") {
+    glm::vec3 center(5.f, -10.f, 20.f);
+    float radius = 40.f;
+    std::vector<SpatialIndex::ObjectId> results;
+    index.querySphere(center, radius, results);
+    expect(results, [&](const BoundingBox& box) {
+      auto offset = glm::clamp(center, box.min(), box.max()) - center;
+      return glm::dot(offset, offset) <= radius * radius;
+    });
+  }
+
+  SECTION("Box") {
+    BoundingBox query({-30.f, -30.f, -30.f}, {30.f, 10.f, 50.f});
+    std::vector<SpatialIndex::ObjectId> results;
+    index.queryBox(query, results);
+    expect(results, [&](const BoundingBox& box) { return box.intersects(query); });
+  }
+
+  SECTION("Ray") {
+    // The ray spans every object vertically, so it hits exactly the boxes containing its x and z coordinates.
+    glm::vec3 origin(boxes[0].center().x, -1000.f, boxes[0].center().z);
+    std::vector<SpatialIndex::ObjectId> results;
+    index.queryRay(origin, {0.f, 1.f, 0.f}, 2000.f, results);
+    CHECK(std::find(results.begin(), results.end(), 0u) != results.end());
+    expect(results, [&](const BoundingBox& box) {
+      return box.min().x <= origin.x && origin.x <= box.max().x && box.min().z <= origin.z && origin.z <= box.max().z;
+    });
+  }
+}
+
+TEST_CASE("Spatial index only restructures when an object leaves its enlarged box", "[SpatialIndex]") {
+  SpatialIndex::Options options;
+  options.margin = 1.f;
+  SpatialIndex index(options);
+  index.insert(7, BoundingBox({0.f, 0.f, 0.f}, {1.f, 1.f, 1.f}));
+  index.insert(8, BoundingBox({10.f, 0.f, 0.f}, {11.f, 1.f, 1.f}));
+
+  CHECK_FALSE(index.update(7, BoundingBox({0.5f, 0.f, 0.f}, {1.5f, 1.f, 1.f})));
+  CHECK(index.update(7, BoundingBox({5.f, 0.f, 0.f}, {6.f, 1.f, 1.f})));
+
+  Transform transform;
+  transform.position() = {20.f, 0.f, 0.f};
+  CHECK(index.update(8, BoundingBox({-.5f, -.5f, -.5f}, {.5f, .5f, .5f}), transform));
+
+  std::vector<SpatialIndex::ObjectId> results;
+  index.querySphere({20.f, 0.f, 0.f}, 0.1f, results);
+  CHECK(results == std::vector<SpatialIndex::ObjectId>{8});
+
+  index.clear();
+  CHECK(index.size() == 0);
+  results.clear();
+  index.queryBox(BoundingBox({-100.f, -100.f, -100.f}, {100.f, 100.f, 100.f}), results);
+  CHECK(results.empty());
+}
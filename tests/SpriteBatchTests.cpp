@@ -0,0 +1,33 @@
+#include "catch.hpp"
+#include "gl/SpriteBatch.hpp"
+#include "gl/Texture.hpp"
+
+using namespace stock;
+
+TEST_CASE("Sprite batch groups quads by layer and texture", "[SpriteBatch]") {
+  SpriteBatch batch;
+  Texture a, b;
+
+  SECTION("Quads with the same texture share a draw call") {
+    for (int i = 0; i < 10; i++) {
+      batch.draw(i % 2 ? a : b, glm::vec2(i, 0.f), glm::vec2(1.f));
+    }
+    CHECK(batch.size() == 10);
+    CHECK(batch.sort() == 2);
+  }
+
+  SECTION("Layers are drawn in order even when that splits up a texture") {
+    batch.draw(a, glm::vec2(0.f), glm::vec2(1.f), glm::vec4(0.f, 0.f, 1.f, 1.f), 0xffffffff, 2);
+    batch.draw(b, glm::vec2(0.f), glm::vec2(1.f), glm::vec4(0.f, 0.f, 1.f, 1.f), 0xffffffff, 1);
+    batch.draw(a, glm::vec2(0.f), glm::vec2(1.f), glm::vec4(0.f, 0.f, 1.f, 1.f), 0xffffffff, 0);
+    batch.draw(a, glm::vec2(0.f), glm::vec2(1.f), glm::vec4(0.f, 0.f, 1.f, 1.f), 0xffffffff, 2);
+    CHECK(batch.sort() == 3);
+  }
+
+  SECTION("Batches are split where the quad indices run out") {
+    for (size_t i = 0; i < SpriteBatch::MAX_SPRITES_PER_DRAW + 1; i++) {
+      batch.draw(a, glm::vec2(0.f), glm::vec2(1.f));
+    }
+    CHECK(batch.sort() == 2);
+  }
+}
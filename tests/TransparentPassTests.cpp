@@ -0,0 +1,102 @@
+#include "catch.hpp"
+#include "gl/TransparentPass.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace stock;
+
+static float viewDepth(const glm::mat4& view, const glm::vec3& p) {
+  return (view * glm::vec4(p, 1.f)).z;
+}
+
+static bool isBackToFront(const TransparentPass& pass, const glm::mat4& view, const std::vector<glm::vec3>& positions) {
+  const auto& order = pass.order();
+  for (size_t i = 1; i < order.size(); i++) {
+    if (viewDepth(view, positions[order[i - 1]]) > viewDepth(view, positions[order[i]])) {
+      return false;
+    }
+  }
+  return order.size() == positions.size();
+}
+
+TEST_CASE("Transparent pass sorts items back to front", "[TransparentPass]") {
+  // Scatter items deterministically through a box in front of the camera, including negative coordinates.
+  std::vector<glm::vec3> positions;
+  uint32_t seed = 1;
+  auto next = [&]() {
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24) * 200.f - 100.f;
+  };
+  for (int i = 0; i < 5003; i++) {
+    positions.emplace_back(next(), next(), next());
+  }
+
+  auto view = glm::lookAt(glm::vec3(0.f, 0.f, 300.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+
+  TransparentPass pass;
+  auto submitAll = [&]() {
+    pass.clear();
+    for (size_t i = 0; i < positions.size(); i++) {
+      pass.submit(positions[i], static_cast<uint32_t>(i));
+    }
+  };
+
+  submitAll();
+  pass.sort(view);
+  CHECK(pass.lastSortMethod() == TransparentPass::SortMethod::RADIX);
+  CHECK(isBackToFront(pass, view, positions));
+
+  SECTION("An unchanged view keeps the previous order without sorting") {
+    submitAll();
+    pass.sort(view);
+    CHECK(pass.lastSortMethod() == TransparentPass::SortMethod::NONE);
+    CHECK(isBackToFront(pass, view, positions));
+  }
+
+  SECTION("A small camera movement is fixed up from the previous order") {
+    auto moved = glm::lookAt(glm::vec3(.5f, 0.f, 300.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    submitAll();
+    pass.sort(moved);
+    CHECK(pass.lastSortMethod() == TransparentPass::SortMethod::INSERTION);
+    CHECK(isBackToFront(pass, moved, positions));
+  }
+
+  SECTION("A large camera movement falls back to a full sort") {
+    auto turned = glm::lookAt(glm::vec3(300.f, 0.f, 0.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    submitAll();
+    pass.sort(turned);
+    CHECK(pass.lastSortMethod() == TransparentPass::SortMethod::RADIX);
+    CHECK(isBackToFront(pass, turned, positions));
+  }
+
+  SECTION("An empty frame after a populated one sorts nothing") {
+    pass.clear();
+    pass.sort(view);
+    CHECK(pass.order().empty());
+    submitAll();
+    pass.sort(view);
+    CHECK(isBackToFront(pass, view, positions));
+  }
+
+  SECTION("Different items are sorted from scratch") {
+    positions.pop_back();
+    submitAll();
+    pass.sort(view);
+    CHECK(pass.lastSortMethod() == TransparentPass::SortMethod::RADIX);
+    CHECK(isBackToFront(pass, view, positions));
+  }
+}
+
+TEST_CASE("Transparent pass depth keys keep the order of depths", "[TransparentPass]") {
+  glm::mat4 view(1.f);
+  float z[] = {-5.f, -0.f, 0.f, 3.f, -1e30f, 1e30f, -2.5f, 2.5f, 1e-30f};
+  float zero[9] = {};
+  uint32_t keys[9];
+  TransparentPass::computeDepthKeys(view, zero, zero, z, 9, keys);
+  for (int a = 0; a < 9; a++) {
+    for (int b = 0; b < 9; b++) {
+      if (z[a] < z[b]) {
+        CHECK(keys[a] < keys[b]);
+      }
+    }
+  }
+}